@@ -0,0 +1,290 @@
+#!/usr/bin/env python3
+"""Benchmark every nfts action on a local single-node chain.
+
+The script deploys the contract to a fresh nodeos (or to the one given with
+--endpoint), runs a fixed workload through it and records, per action, the
+billed CPU time, the NET bytes of the transaction and the RAM delta of every
+account involved. The report is written as JSON.
+
+With --baseline the report is compared against an earlier one: any action
+whose RAM or NET grew, or whose CPU grew by more than --cpu-tolerance, is
+reported and the script exits with status 1.
+
+Requires nodeos and cleos on PATH, and the directory of eosio.token for the
+COME token that pays for sales. On chains that need protocol features for
+CDT 3 contracts, pass --boot-contract with the directory of eosio.boot.
+"""
+
+import argparse
+import json
+import os
+import shutil
+import subprocess
+import sys
+import tempfile
+import time
+import urllib.request
+
+# well known development key of eosio
+DEV_PUB = "EOS6MRyAjQq8ud7hVNYcfnVPJqcVpscN5So8BhtHuGYqET5GDW5CV"
+DEV_KEY = "5KQwrPbwdL6PhXujxW37FSSQZ1JiwsST4cqQzDeyXtP79zkvFD3"
+
+CONTRACT = "nfts"
+ISSUER = "issuer"
+CALLER = "caller"
+TOKEN = "come.token"
+ACCOUNTS = [CONTRACT, ISSUER, CALLER, TOKEN]
+
+EVENT = 7
+NFT_NAME = "vip"
+SELLER, RECEIVER, BUYER = 1, 2, 3
+BATCHES = [1, 10, 100]
+
+
+class Chain:
+    def __init__(self, endpoint):
+        self.endpoint = endpoint
+
+    def cleos(self, *args, check=True):
+        cmd = ["cleos", "-u", self.endpoint] + list(args)
+        res = subprocess.run(cmd, capture_output=True, text=True)
+        if check and res.returncode != 0:
+            raise RuntimeError("%s\n%s" % (" ".join(cmd), res.stderr))
+        return res.stdout
+
+    def post(self, path, body=None):
+        req = urllib.request.Request(self.endpoint + path, data=json.dumps(body or {}).encode())
+        with urllib.request.urlopen(req) as resp:
+            return json.loads(resp.read() or b"null")
+
+    def ram(self):
+        return {a: json.loads(self.cleos("get", "account", a, "--json"))["ram_usage"] for a in ACCOUNTS}
+
+    def push(self, action, data, auths, contract=CONTRACT):
+        perms = []
+        for a in auths:
+            perms += ["-p", a + "@active"]
+        out = self.cleos("push", "action", contract, action, json.dumps(data), "--json", *perms)
+        receipt = json.loads(out)["processed"]["receipt"]
+        return receipt["cpu_usage_us"], receipt["net_usage_words"] * 8
+
+    def owned(self, owner):
+        # byownercat is (owner << 64) | category, the whole range of the owner. NFTs not touched since
+        # they were issued are stored as ranges, only the others have their own row
+        def rows(table):
+            out = self.cleos("get", "table", CONTRACT, str(EVENT), table, "--index", "2", "--key-type", "i128",
+                             "-L", str(owner << 64), "-U", str((owner << 64) | (2**64 - 1)), "-l", "1000")
+            return json.loads(out)["rows"]
+        ids = [int(row["id"]) for row in rows("nftsv2")]
+        for r in rows("nftranges"):
+            ids += range(int(r["first_id"]), int(r["first_id"]) + int(r["count"]))
+        return sorted(ids)
+
+    def listed_in(self, nft_id):
+        # batch id of the ask the nft is listed in
+        out = self.cleos("get", "table", CONTRACT, str(EVENT), "nftsv2", "-L", str(nft_id), "-U", str(nft_id), "-l", "1")
+        return json.loads(out)["rows"][0]["listed_in"]
+
+
+class Node:
+    """Throwaway nodeos producing on its own, with a fresh wallet."""
+
+    def __init__(self, port):
+        self.port = port
+        self.dir = tempfile.mkdtemp(prefix="nfts-bench-")
+        self.proc = None
+
+    def __enter__(self):
+        log = open(os.path.join(self.dir, "nodeos.log"), "w")
+        self.proc = subprocess.Popen([
+            "nodeos", "-e", "-p", "eosio",
+            "--data-dir", os.path.join(self.dir, "data"),
+            "--config-dir", os.path.join(self.dir, "config"),
+            "--plugin", "eosio::producer_plugin",
+            "--plugin", "eosio::producer_api_plugin",
+            "--plugin", "eosio::chain_api_plugin",
+            "--plugin", "eosio::http_plugin",
+            "--http-server-address", "127.0.0.1:%d" % self.port,
+            "--http-validate-host", "false",
+            "--max-transaction-time", "1000",
+            "--abi-serializer-max-time-ms", "1000",
+        ], stdout=log, stderr=subprocess.STDOUT)
+        return "http://127.0.0.1:%d" % self.port
+
+    def __exit__(self, *exc):
+        self.proc.terminate()
+        self.proc.wait()
+        shutil.rmtree(self.dir, ignore_errors=True)
+
+
+def wait_for(chain, timeout=30):
+    deadline = time.time() + timeout
+    while time.time() < deadline:
+        try:
+            chain.post("/v1/chain/get_info")
+            return
+        except OSError:
+            time.sleep(0.5)
+    raise RuntimeError("node at %s did not come up" % chain.endpoint)
+
+
+def activate_features(chain, boot_dir):
+    features = chain.post("/v1/producer/get_supported_protocol_features")
+    codename = lambda f: next(s["value"] for s in f["specification"] if s["name"] == "builtin_feature_codename")
+    preactivate = next(f["feature_digest"] for f in features if codename(f) == "PREACTIVATE_FEATURE")
+    chain.post("/v1/producer/schedule_protocol_feature_activations", {"protocol_features_to_activate": [preactivate]})
+    time.sleep(1)
+    chain.cleos("set", "contract", "eosio", boot_dir, "-p", "eosio@active")
+    for f in features:
+        if codename(f) != "PREACTIVATE_FEATURE":
+            chain.cleos("push", "action", "eosio", "activate", json.dumps([f["feature_digest"]]), "-p", "eosio@active")
+    time.sleep(1)
+
+
+def setup(chain, wasm, abi, token_dir, boot_dir):
+    wallet = "nfts-bench-%d" % os.getpid()
+    chain.cleos("wallet", "create", "-n", wallet, "--to-console")
+    chain.cleos("wallet", "import", "-n", wallet, "--private-key", DEV_KEY)
+    if boot_dir:
+        activate_features(chain, boot_dir)
+    for account in ACCOUNTS:
+        chain.cleos("create", "account", "eosio", account, DEV_PUB)
+    chain.cleos("set", "contract", CONTRACT, os.path.dirname(wasm), wasm, abi, "-p", CONTRACT + "@active")
+    # withdrawals are inline transfers of the contract
+    chain.cleos("set", "account", "permission", CONTRACT, "active", "--add-code", "-p", CONTRACT + "@active")
+
+    # COME for the caller, who deposits it for the buyers
+    chain.cleos("set", "contract", TOKEN, token_dir, "-p", TOKEN + "@active")
+    chain.cleos("push", "action", TOKEN, "create", json.dumps([TOKEN, "1000000000.00 COME"]), "-p", TOKEN + "@active")
+    chain.cleos("push", "action", TOKEN, "issue", json.dumps([TOKEN, "1000000.00 COME", ""]), "-p", TOKEN + "@active")
+    chain.cleos("push", "action", TOKEN, "transfer", json.dumps([TOKEN, CALLER, "1000000.00 COME", ""]), "-p", TOKEN + "@active")
+
+
+class Workload:
+    def __init__(self, chain):
+        self.chain = chain
+        self.results = []
+
+    def run(self, label, action, data, auths, contract=CONTRACT):
+        before = self.chain.ram()
+        cpu, net = self.chain.push(action, data, auths, contract)
+        after = self.chain.ram()
+        ram = sum(after[a] - before[a] for a in ACCOUNTS)
+        self.results.append({"label": label, "action": action, "cpu_us": cpu, "net_bytes": net, "ram_bytes": ram})
+        print("%-24s cpu=%6d us  net=%5d B  ram=%+7d B" % (label, cpu, net, ram))
+
+    def __call__(self):
+        run = self.run
+        come = lambda amount: "%d.%02d COME" % (amount // 100, amount % 100)
+        run("setconfig", "setconfig", ["1", TOKEN], [CONTRACT])
+        for user in (SELLER, RECEIVER, BUYER):
+            run("createacc", "createacc", [user, "0" * 64, CALLER], [CALLER])
+        run("deposit", "transfer", [CALLER, CONTRACT, come(100000000), str(BUYER)], [CALLER], TOKEN)
+        run("createnft", "createnft", [ISSUER, EVENT, NFT_NAME, True, True, True, come(100), 255, 1000,
+                                       "https://example.com/", "1000000 CTT"], [ISSUER])
+
+        # 222 nfts for the seller: 111 to transfer, 111 to sell
+        for quantity in [1, 10, 100, 111]:
+            run("issue/%d" % quantity, "issue", [SELLER, EVENT, NFT_NAME, "%d CTT" % quantity, "", "bench"], [ISSUER])
+
+        drop = [{"first": RECEIVER, "second": 5}, {"first": BUYER, "second": 5}]
+        run("issuemany/2", "issuemany", [EVENT, NFT_NAME, drop, "", "bench"], [ISSUER])
+
+        ids = self.chain.owned(SELLER)
+        for n in BATCHES:
+            batch, ids = ids[:n], ids[n:]
+            run("transfer/%d" % n, "transfer", [SELLER, RECEIVER, batch, "bench"], [ISSUER])
+
+        for n in BATCHES:
+            batch, ids = ids[:n], ids[n:]
+            run("listsale/%d" % n, "listsale", [SELLER, EVENT, NFT_NAME, batch, come(100 * n)], [ISSUER])
+            run("buy/%d" % n, "buy", [BUYER, self.chain.listed_in(batch[0]), "bench"], [CONTRACT, ISSUER])
+
+        owned = self.chain.owned(RECEIVER)
+        run("listsale/closesale", "listsale", [RECEIVER, EVENT, NFT_NAME, owned[:1], come(100)], [ISSUER])
+        run("closesale", "closesale", [RECEIVER, self.chain.listed_in(owned[0])], [ISSUER])
+        run("share", "share", [RECEIVER, owned[1], BUYER], [ISSUER])
+        run("unshare", "unshare", [owned[1]], [ISSUER])
+        drop = [{"first": SELLER, "second": owned[5:10]}, {"first": BUYER, "second": owned[10:15]}]
+        run("transfermany/10", "transfermany", [RECEIVER, drop, "bench"], [ISSUER])
+
+        # auctions: one won by a bid, one cancelled, one settled by the crank without bids
+        expiration = time.strftime("%Y-%m-%dT%H:%M:%S", time.gmtime(time.time() + 5))
+        for nft_id in owned[2:5]:
+            run("createauctn", "createauctn", [RECEIVER, EVENT, nft_id, come(10000), come(100), expiration], [CONTRACT])
+        run("bid", "bid", [owned[2], BUYER, come(500)], [CONTRACT])
+        run("closeauctn", "closeauctn", [RECEIVER, owned[3]], [CONTRACT])
+        # shares: ten ending with the auctions, cleared by the sweep, and ten revoked at once
+        run("sharemany/10", "sharemany", [RECEIVER, owned[15:25], BUYER, expiration], [ISSUER])
+        run("sharemany/open/10", "sharemany", [RECEIVER, owned[25:35], BUYER], [ISSUER])
+        run("unsharemany/10", "unsharemany", [owned[25:35]], [ISSUER])
+        time.sleep(7)
+        run("finalize", "finalize", [owned[2], RECEIVER], [CONTRACT, ISSUER])
+        run("settleauctns", "settleauctns", [10], [CONTRACT, ISSUER])
+        run("sweepshares", "sweepshares", [10], [CALLER])
+
+        # proceeds of every sale above are withdrawn at once
+        run("withdraw", "withdraw", [SELLER, CALLER, come(100), "bench"], [CONTRACT])
+        run("claimroyalty", "claimroyalty", [ISSUER, come(1)], [ISSUER])
+        return self.results
+
+
+def compare(report, baseline, cpu_tolerance):
+    base = {r["label"]: r for r in baseline["actions"]}
+    failures = []
+    for r in report["actions"]:
+        b = base.get(r["label"])
+        if b is None:
+            continue
+        if r["ram_bytes"] > b["ram_bytes"]:
+            failures.append("%s: ram %d -> %d bytes" % (r["label"], b["ram_bytes"], r["ram_bytes"]))
+        if r["net_bytes"] > b["net_bytes"]:
+            failures.append("%s: net %d -> %d bytes" % (r["label"], b["net_bytes"], r["net_bytes"]))
+        if r["cpu_us"] > b["cpu_us"] * (1 + cpu_tolerance):
+            failures.append("%s: cpu %d -> %d us" % (r["label"], b["cpu_us"], r["cpu_us"]))
+    return failures
+
+
+def main():
+    parser = argparse.ArgumentParser(description=__doc__.splitlines()[0])
+    parser.add_argument("--wasm", required=True, help="compiled nfts.wasm")
+    parser.add_argument("--abi", required=True, help="generated nfts.abi")
+    parser.add_argument("--token-contract", required=True, help="directory of eosio.token, deployed for COME")
+    parser.add_argument("--report", default="bench-report.json", help="where to write the JSON report")
+    parser.add_argument("--baseline", help="earlier report to check the run against")
+    parser.add_argument("--cpu-tolerance", type=float, default=0.25,
+                        help="allowed relative CPU growth over the baseline (default 0.25)")
+    parser.add_argument("--endpoint", help="use a running node instead of starting one")
+    parser.add_argument("--port", type=int, default=18888, help="http port of the node started by the script")
+    parser.add_argument("--boot-contract", help="directory of eosio.boot, to activate protocol features")
+    args = parser.parse_args()
+
+    def bench(endpoint):
+        chain = Chain(endpoint)
+        wait_for(chain)
+        setup(chain, os.path.abspath(args.wasm), os.path.abspath(args.abi), args.token_contract, args.boot_contract)
+        return Workload(chain)()
+
+    if args.endpoint:
+        results = bench(args.endpoint)
+    else:
+        with Node(args.port) as endpoint:
+            results = bench(endpoint)
+
+    report = {"contract": os.path.abspath(args.wasm), "time": int(time.time()), "actions": results}
+    with open(args.report, "w") as f:
+        json.dump(report, f, indent=2)
+    print("report written to %s" % args.report)
+
+    if args.baseline:
+        with open(args.baseline) as f:
+            failures = compare(report, json.load(f), args.cpu_tolerance)
+        for failure in failures:
+            print("REGRESSION " + failure)
+        if failures:
+            return 1
+    return 0
+
+
+if __name__ == "__main__":
+    sys.exit(main())
@@ -1,7 +1,12 @@
 #include <eosio/eosio.hpp>
 #include <eosio/asset.hpp>
+#include <eosio/crypto.hpp>
 #include <eosio/singleton.hpp>
 
+#include <algorithm>
+#include <array>
+#include <map>
+
 using namespace std;
 using namespace eosio;
 
@@ -10,8 +15,17 @@ CONTRACT nfts : public contract {
     using contract::contract;
 
     const int WEEK_SEC = 3600*24*7;
+    static constexpr symbol COME_SYMBOL = symbol( symbol_code("COME"), 2 ); // prices, sales and bids
+    static constexpr symbol_code CTT_CODE = symbol_code("CTT"); // nft quantities and supplies
+    static constexpr uint16_t BPS_DENOMINATOR = 10000; // royalties are in basis points of the sale price
+
+    // bits of nft::flags
+    static constexpr uint8_t NFT_LISTED = 0x01; // part of an ask, the price lives in the ask row
+    static constexpr uint8_t NFT_SHARED = 0x02; // has a row in the sharednfts table
+    static constexpr uint8_t NFT_AUCTIONED = 0x04; // has a row in the auctions table
+    static constexpr uint8_t NFT_LOCKED = NFT_LISTED | NFT_AUCTIONED; // cannot be moved, shared or listed again
 
-    ACTION setconfig(string version);
+    ACTION setconfig(string version, binary_extension<name> token_contract);
 
     ACTION createacc(uint64_t id, checksum256 signature, name caller);
 
@@ -23,7 +37,7 @@ CONTRACT nfts : public contract {
                 bool transferable,
                 asset price,
                 uint8_t max_per_account,
-                double sale_split,
+                uint16_t royalty_bps,
                 string base_uri,
                 asset max_supply);
 
@@ -38,32 +52,85 @@ CONTRACT nfts : public contract {
                string relative_uri,
                string memo);
 
+    ACTION issuemany(uint64_t event,
+               name nft_name,
+               vector<pair<uint64_t, uint64_t>> recipients_and_counts,
+               string relative_uri,
+               string memo);
+
     ACTION transfer(uint64_t from, uint64_t to, vector<uint64_t> nft_ids, string memo);
 
+    ACTION transfermany(uint64_t from, vector<pair<uint64_t, vector<uint64_t>>> recipients_and_ids, string memo);
+
+    ACTION setdrop(uint64_t event, name nft_name, uint64_t drop_id, checksum256 merkle_root, uint64_t leaf_count);
+
+    ACTION claim(uint64_t drop_id, uint64_t leaf_index, uint64_t to, uint64_t count, vector<checksum256> proof, name payer);
+
     ACTION listsale(uint64_t seller, uint64_t event, name nft_name, vector<uint64_t> nft_ids, asset net_sale_price);
 
     ACTION closesale(uint64_t seller, uint64_t batch_id);
 
-    ACTION share(uint64_t from, uint64_t nft_id, uint64_t to);
+    [[eosio::action]] uint64_t sweepasks(uint64_t max_rows);
+
+    ACTION share(uint64_t from, uint64_t nft_id, uint64_t to, binary_extension<time_point_sec> expiration);
 
     ACTION unshare(uint64_t nft_id);
 
-    ACTION buy(uint64_t to, uint64_t batch_id,  string memo);
+    ACTION sharemany(uint64_t from, vector<uint64_t> nft_ids, uint64_t to, binary_extension<time_point_sec> expiration);
+
+    ACTION unsharemany(vector<uint64_t> nft_ids);
+
+    [[eosio::action]] uint64_t sweepshares(uint64_t max_rows);
+
+    // Split of a sale price between the seller and the issuer of the nfts sold, see split_sale
+    struct sale_payout {
+      uint64_t seller;
+      name issuer;
+      asset proceeds; // to the seller
+      asset royalty; // to the issuer
+    };
+
+    [[eosio::action]] sale_payout buy(uint64_t to, uint64_t batch_id,  string memo, binary_extension<vector<uint64_t>> nft_ids);
+
+    [[eosio::action]] uint64_t buybest(uint64_t to, uint64_t event, name nft_name, asset max_unit_price, uint64_t count);
 
     ACTION createauctn(uint64_t seller, uint64_t event, uint64_t nft_id, asset target_price, asset min_bid_price, time_point_sec expiration);
 
     ACTION closeauctn(uint64_t seller, uint64_t nft_id);
 
-    ACTION bid(uint64_t nft_id, uint64_t bidder, asset bid_price);
+    [[eosio::action]] std::optional<sale_payout> bid(uint64_t nft_id, uint64_t bidder, asset bid_price);
+
+    [[eosio::action]] std::optional<sale_payout> finalize(uint64_t nft_id, uint64_t seller);
+
+    [[eosio::action]] uint64_t settleauctns(uint64_t max_rows);
+
+    ACTION migratenfts(uint64_t max_rows);
+
+    ACTION migratelocks(uint64_t max_rows);
 
-    ACTION finalize(uint64_t nft_id, uint64_t seller);
+    ACTION migratescope(uint64_t max_rows);
+
+    ACTION migratesplit(uint64_t event);
+
+    ACTION initmarket(uint64_t event);
+
+    // COME sent to the contract with a user id as memo is credited to that user
+    [[eosio::on_notify("*::transfer")]] void deposit(name from, name to, asset quantity, string memo);
+
+    ACTION withdraw(uint64_t user, name to, asset quantity, string memo);
+
+    ACTION claimroyalty(name issuer, asset quantity);
 
     nfts(name receiver, name code, datastream<const char*> ds): contract(receiver, code, ds) {}
+    ~nfts();
 
     TABLE tokenconfigs {
         name standard;
         string version;
         uint64_t nft_category_id;
+        binary_extension<uint64_t> next_nft_id; // next unreserved nft id, absent on configs created before batch minting
+        binary_extension<name> token_contract; // contract of the COME token, deposits from any other are ignored, empty until configured
+        binary_extension<uint64_t> next_batch_id; // next ask batch id, absent until the first listing after asks stopped using nft ids
      };
 
     // Table with events for which redeemable NFTs exists
@@ -88,8 +155,9 @@ CONTRACT nfts : public contract {
       asset max_supply;
       asset current_supply;
       asset issued_supply;
-      double sale_split;
+      double sale_split; // superseded by royalty_bps, zero once migratesplit converted it and kept for the row layout
       string base_uri;
+      binary_extension<uint16_t> royalty_bps; // issuer share of every sale, absent until migratesplit converts sale_split
 
       uint64_t primary_key() const { return nft_name.value; }
      };
@@ -102,8 +170,44 @@ CONTRACT nfts : public contract {
       uint64_t primary_key() const { return id;}
     };
 
-    // scope is self
+    // scope is event, see nfts_in
+    // Compact NFT row, the category data is reached through nft_category_id
     TABLE nft {
+      uint64_t id;
+      uint64_t serial_number;
+      uint64_t owner;
+      uint64_t nft_category_id;
+      uint8_t flags; // NFT_* bits
+      std::optional<string> relative_uri; // only kept when it differs from the category base_uri
+      binary_extension<uint64_t> listed_in; // batch id of the ask while NFT_LISTED, written with the flag
+
+      uint64_t primary_key() const { return id; }
+      uint128_t get_byownercat() const { return (uint128_t(owner) << 64) | nft_category_id; }
+    };
+    EOSLIB_SERIALIZE( nft, (id)(serial_number)(owner)(nft_category_id)(flags)(relative_uri)(listed_in) )
+
+    // scope is event
+    // NFTs issued together to one owner and never touched since, stored as one row. The nft of an id
+    // gets its own row, and the range is split around it, the first time it is moved, shared, listed or auctioned
+    TABLE nft_range {
+      uint64_t first_id;
+      uint64_t count;
+      uint64_t first_serial;
+      uint64_t owner;
+      uint64_t nft_category_id;
+      std::optional<string> relative_uri;
+
+      uint64_t primary_key() const { return first_id; }
+      uint128_t get_byownercat() const { return (uint128_t(owner) << 64) | nft_category_id; }
+
+      nft member(const uint64_t& nft_id) const {
+        return nft{ nft_id, first_serial + (nft_id - first_id), owner, nft_category_id, 0, relative_uri, {} };
+      }
+    };
+
+    // scope is self
+    // Layout of the "nfts" table before the compact format, rows are converted by migratenfts
+    TABLE nft_v1 {
       uint64_t id;
       uint64_t serial_number;
       uint64_t event;
@@ -118,7 +222,48 @@ CONTRACT nfts : public contract {
       uint64_t get_byeve() const { return event;}
       uint64_t get_byshare() const { return shared_with; }
     };
-    EOSLIB_SERIALIZE( nft, (id)(serial_number)(event)(owner)(nft_name)(resale_price)(shared_with)(relative_uri) )
+    EOSLIB_SERIALIZE( nft_v1, (id)(serial_number)(event)(owner)(nft_name)(resale_price)(shared_with)(relative_uri) )
+
+    // scope is self
+    // Block of consecutive nft ids stored in the scope of one event
+    TABLE id_range {
+      uint64_t first_id;
+      uint64_t count;
+      uint64_t event;
+
+      uint64_t primary_key() const { return first_id; }
+    };
+
+    // scope is self
+    // Only the NFTs that are currently shared, so unshared tokens pay for no share index
+    TABLE shared_nft {
+      uint64_t nft_id;
+      uint64_t shared_with;
+      binary_extension<time_point_sec> expiration; // only on shares that end, mirrored in shareexpiry
+
+      uint64_t primary_key() const { return nft_id; }
+      uint64_t get_byshare() const { return shared_with; }
+    };
+
+    // scope is self
+    // Ends of the shares that have one, walked by sweepshares, so open-ended shares pay for no expiry index
+    TABLE share_expiry {
+      uint64_t nft_id;
+      time_point_sec expiration;
+
+      uint64_t primary_key() const { return nft_id; }
+      uint64_t get_byexpiry() const { return expiration.sec_since_epoch(); }
+    };
+
+    // scope is self
+    // Maps the global nft_category_id to its nft_stat row
+    TABLE category {
+      uint64_t nft_category_id;
+      uint64_t event;
+      name nft_name;
+
+      uint64_t primary_key() const { return nft_category_id; }
+    };
 
     // scope is owner
     TABLE account {
@@ -137,13 +282,87 @@ CONTRACT nfts : public contract {
       uint64_t seller;
       asset ask_price; 
       time_point_sec expiration;
+      binary_extension<uint64_t> nft_category_id; // absent on asks listed before buybest
+      binary_extension<asset> unit_price; // absent on asks listed before partial fills
 
       uint64_t primary_key() const { return batch_id; }
       uint64_t get_byevent() const { return event; }
       uint64_t get_byprice() const { return ask_price.amount; }
+      uint64_t get_byexpiry() const { return expiration.sec_since_epoch(); }
+      uint64_t get_unit_price() const { return unit_price.has_value() ? unit_price->amount : ask_price.amount / nft_ids.size(); }
+      uint128_t get_byeventprice() const { return (uint128_t(event) << 64) | get_unit_price(); }
+
+    };
+
+    // scope is self
+    // Allow-list drop of a category, built by tools/merkledrop. Leaf i of the tree is
+    // sha256(0x00 | i | user id | nft_category_id | count), a node is sha256(0x01 | left | right)
+    // and the last node of an odd level is paired with itself
+    TABLE drop {
+      uint64_t drop_id;
+      uint64_t nft_category_id;
+      checksum256 merkle_root;
+      uint64_t leaf_count;
+
+      uint64_t primary_key() const { return drop_id; }
+    };
+
+    // scope is drop_id
+    // Bitmap of the claimed leaves of a drop, bit i of row word is leaf 64 * word + i
+    TABLE drop_claims {
+      uint64_t word;
+      uint64_t bits;
+
+      uint64_t primary_key() const { return word; }
+    };
+
+    // scope is self
+    // COME of a user: deposits, sale proceeds and outbid refunds, less purchases, open bids and withdrawals
+    TABLE user_funds {
+      uint64_t user;
+      asset balance;
+
+      uint64_t primary_key() const { return user; }
+    };
+
+    // scope is self
+    // COME royalties of an issuer, withdrawn with claimroyalty
+    TABLE issuer_funds {
+      name issuer;
+      asset balance;
 
+      uint64_t primary_key() const { return issuer.value; }
     };
 
+    // scope is self
+    // Progress of the purge of a deleted event, erased when the purge is done
+    TABLE purge_state {
+      uint64_t event;
+      uint8_t stage; // PURGE_* stage the next call starts at
+      uint64_t erased; // rows erased by all calls so far, not counting balances and locks
+      uint64_t next_id; // first id block the PURGE_IDS stage has not looked at
+
+      uint64_t primary_key() const { return event; }
+    };
+
+    static constexpr uint8_t PURGE_ASKS = 0;
+    static constexpr uint8_t PURGE_NFTS = 1;
+    static constexpr uint8_t PURGE_RANGES = 2;
+    static constexpr uint8_t PURGE_LEGACY = 3;
+    static constexpr uint8_t PURGE_IDS = 4;
+    static constexpr uint8_t PURGE_STATS = 5;
+    static constexpr uint8_t PURGE_DONE = 6;
+
+    struct purge_progress {
+      uint8_t stage;
+      uint64_t erased; // by this call
+      uint64_t total_erased;
+      bool done;
+    };
+
+    [[eosio::action]] purge_progress purgeevent(uint64_t event, uint64_t max_rows);
+
+    // Lock rows written before the lock state moved into nft::flags, drained by migratelocks
     TABLE lockednft {
       uint64_t nft_id;
 
@@ -159,27 +378,292 @@ CONTRACT nfts : public contract {
       asset current_price; // the current winning bid
       uint64_t bidder; // the eos id of the current winning bidder
       time_point_sec expiration;
+      binary_extension<bool> escrowed; // the current bid is held from the bidder's funds, absent on bids placed before the ledger
 
       uint64_t primary_key() const { return nft_id; }
       uint64_t get_seller() const { return seller; }
       uint64_t get_bidder() const { return bidder; }
+      uint64_t get_byexpiry() const { return expiration.sec_since_epoch(); }
+    };
+
+    // scope is self
+    // Market of an event for its pages, updated in place by every listing, sale and auction action.
+    // Created with the event, or by initmarket for events created before it; asks count until they are closed or swept
+    TABLE market {
+      uint64_t event;
+      uint64_t active_asks;
+      uint64_t listed_units;
+      asset floor_price; // lowest unit price of the active asks, zero without asks
+      uint64_t floor_batch_id; // ask with the floor price, the price index is only read when it goes away
+      uint64_t open_auctions;
+      asset highest_bid; // highest standing bid of the open auctions, zero without bids
+      uint64_t highest_bid_nft_id;
+      uint64_t sales; // nfts sold through asks and auctions
+      asset volume; // COME paid for them
+
+      uint64_t primary_key() const { return event; }
+    };
+
+    // scope is event
+    // Standing bids of the open auctions of an event, by price, to find the next highest bid
+    TABLE live_bid {
+      uint64_t nft_id;
+      asset bid_price;
+
+      uint64_t primary_key() const { return nft_id; }
+      uint64_t get_byprice() const { return bid_price.amount; }
+    };
+
+    // rows created and erased, estimated RAM and action calls counted since deployment. Every counter has
+    // a row of its own, so an action only rewrites the counters it changed
+    // scope is event
+    TABLE table_counter {
+      name table;
+      uint64_t created = 0;
+      uint64_t erased = 0;
+      int64_t billed_bytes = 0; // estimated, see row_bytes
+
+      uint64_t primary_key() const { return table.value; }
+    };
+
+    // scope is self
+    // calls of the actions that write, read-only queries cannot save theirs
+    TABLE action_counter {
+      name action;
+      uint64_t calls = 0;
+
+      uint64_t primary_key() const { return action.value; }
+    };
+
+    // one row per payer, payers are not known in advance and claims can bring any number of them
+    TABLE payer_metrics {
+      name payer;
+      int64_t billed_bytes = 0; // estimated, see row_bytes
+
+      uint64_t primary_key() const { return payer.value; }
+    };
+
+    // scope is self
+    // events with table counters, written once per event
+    TABLE event_metrics {
+      uint64_t event;
+
+      uint64_t primary_key() const { return event; }
     };
 
+    struct metrics {
+      vector<table_counter> tables;
+      vector<action_counter> actions;
+    };
+
+    struct event_report {
+      uint64_t event;
+      vector<table_counter> tables;
+      int64_t billed_bytes = 0;
+    };
+
+    struct metrics_snapshot {
+      metrics totals;
+      vector<event_report> events;
+    };
+
+    [[eosio::action, eosio::read_only]] metrics_snapshot getmetrics(uint64_t from_event, uint32_t limit);
+
+    [[eosio::action, eosio::read_only]] vector<payer_metrics> getpayers(name from_payer, uint32_t limit);
+
+    // Pages returned by the read-only queries, next is the cursor of the following page if there is one
+    struct inventory_item {
+      uint64_t nft_id;
+      uint64_t serial_number;
+      uint64_t event;
+      name nft_name;
+      string base_uri;
+      std::optional<string> relative_uri;
+      uint8_t flags;
+      std::optional<asset> auction_price; // current price of the auction the nft is in
+    };
+
+    struct inventory_cursor {
+      uint64_t nft_category_id;
+      uint64_t nft_id;
+    };
+
+    struct inventory_page {
+      vector<inventory_item> items;
+      std::optional<inventory_cursor> next;
+    };
+
+    struct ask_item {
+      uint64_t batch_id;
+      uint64_t seller;
+      vector<uint64_t> nft_ids;
+      name nft_name;
+      asset ask_price;
+      asset unit_price;
+      time_point_sec expiration;
+    };
+
+    struct ask_cursor {
+      uint64_t unit_price;
+      uint64_t batch_id;
+    };
+
+    struct ask_page {
+      vector<ask_item> items;
+      std::optional<ask_cursor> next;
+    };
+
+    struct bid_item {
+      nfts::auction auction;
+      uint64_t serial_number;
+      name nft_name;
+    };
+
+    struct bid_page {
+      vector<bid_item> items;
+      std::optional<uint64_t> next; // from_nft_id
+    };
+
+    [[eosio::action, eosio::read_only]] inventory_page getinventory(uint64_t owner, uint64_t from_category, uint64_t from_id, uint32_t limit, binary_extension<uint64_t> event);
+
+    [[eosio::action, eosio::read_only]] ask_page getasks(uint64_t event, uint64_t from_unit_price, uint64_t from_batch_id, uint32_t limit);
+
+    [[eosio::action, eosio::read_only]] std::optional<ask_item> getnftask(uint64_t nft_id);
+
+    [[eosio::action, eosio::read_only]] bid_page getbids(uint64_t bidder, uint64_t from_nft_id, uint32_t limit);
+
     using config_index = eosio::singleton<"tokenconfigs"_n, tokenconfigs>;
     using event_index = eosio::multi_index<"events"_n, event>;
     using stat_index = eosio::multi_index<"nftstats"_n, nft_stat>;
     using user_index = eosio::multi_index<"users"_n, user>;
     using account_index = eosio::multi_index<"accounts"_n, account>;
-    using nft_index = eosio::multi_index<"nfts"_n, nft, indexed_by<"byowner"_n, const_mem_fun<nft, uint64_t, &nft::get_owner>>, indexed_by<"byeve"_n, const_mem_fun<nft, uint64_t, &nft::get_byeve>>, indexed_by<"byshare"_n, const_mem_fun<nft, uint64_t, &nft::get_byshare>>>;
-    using ask_index = eosio::multi_index<"asks"_n, ask, indexed_by<"byevent"_n, const_mem_fun<ask, uint64_t, &ask::get_byevent>>, indexed_by<"byprice"_n, const_mem_fun< ask, uint64_t, &ask::get_byprice>>>;
+    using nft_index = eosio::multi_index<"nftsv2"_n, nft, indexed_by<"byownercat"_n, const_mem_fun<nft, uint128_t, &nft::get_byownercat>>>;
+    using legacy_nft_index = eosio::multi_index<"nfts"_n, nft_v1, indexed_by<"byowner"_n, const_mem_fun<nft_v1, uint64_t, &nft_v1::get_owner>>, indexed_by<"byeve"_n, const_mem_fun<nft_v1, uint64_t, &nft_v1::get_byeve>>, indexed_by<"byshare"_n, const_mem_fun<nft_v1, uint64_t, &nft_v1::get_byshare>>>;
+    using shared_index = eosio::multi_index<"sharednfts"_n, shared_nft, indexed_by<"byshare"_n, const_mem_fun<shared_nft, uint64_t, &shared_nft::get_byshare>>>;
+    using share_expiry_index = eosio::multi_index<"shareexpiry"_n, share_expiry, indexed_by<"byexpiry"_n, const_mem_fun<share_expiry, uint64_t, &share_expiry::get_byexpiry>>>;
+    using category_index = eosio::multi_index<"categories"_n, category>;
+    using nft_range_index = eosio::multi_index<"nftranges"_n, nft_range, indexed_by<"byownercat"_n, const_mem_fun<nft_range, uint128_t, &nft_range::get_byownercat>>>;
+    using range_index = eosio::multi_index<"idranges"_n, id_range>;
+    using ask_index = eosio::multi_index<"asks"_n, ask, indexed_by<"byevent"_n, const_mem_fun<ask, uint64_t, &ask::get_byevent>>, indexed_by<"byprice"_n, const_mem_fun< ask, uint64_t, &ask::get_byprice>>, indexed_by<"byexpiry"_n, const_mem_fun<ask, uint64_t, &ask::get_byexpiry>>, indexed_by<"byeventprice"_n, const_mem_fun<ask, uint128_t, &ask::get_byeventprice>>>;
     using lock_index = eosio::multi_index<"lockednfts"_n, lockednft>;
-    using auction_index = eosio::multi_index<"auctions"_n, auction, indexed_by<"byseller"_n, const_mem_fun<auction, uint64_t, &auction::get_seller>>, indexed_by<"bybidder"_n, const_mem_fun<auction, uint64_t, &auction::get_bidder>>>;
+    using purge_index = eosio::multi_index<"purges"_n, purge_state>;
+    using drop_index = eosio::multi_index<"drops"_n, drop>;
+    using claim_index = eosio::multi_index<"dropclaims"_n, drop_claims>;
+    using user_funds_index = eosio::multi_index<"userfunds"_n, user_funds>;
+    using issuer_funds_index = eosio::multi_index<"royalties"_n, issuer_funds>;
+    using table_counter_index = eosio::multi_index<"tablecounts"_n, table_counter>;
+    using action_counter_index = eosio::multi_index<"actioncounts"_n, action_counter>;
+    using event_metrics_index = eosio::multi_index<"eventmetrics"_n, event_metrics>;
+    using payer_metrics_index = eosio::multi_index<"payermetrics"_n, payer_metrics>;
+    using market_index = eosio::multi_index<"markets"_n, market>;
+    using live_bid_index = eosio::multi_index<"livebids"_n, live_bid, indexed_by<"byprice"_n, const_mem_fun<live_bid, uint64_t, &live_bid::get_byprice>>>;
+    using auction_index = eosio::multi_index<"auctions"_n, auction, indexed_by<"byseller"_n, const_mem_fun<auction, uint64_t, &auction::get_seller>>, indexed_by<"bybidder"_n, const_mem_fun<auction, uint64_t, &auction::get_bidder>>, indexed_by<"byexpiry"_n, const_mem_fun<auction, uint64_t, &auction::get_byexpiry>>>;
     
   private:
+    // Category and stat rows already read by the running action, keyed by nft category id
+    struct category_stats {
+      category nft_category;
+      nft_stat stats;
+    };
+    std::map<uint64_t, category_stats> category_cache;
+    vector<name> authorized_issuers;
+
+    // NFTs are stored in the scope of their event, ids minted before that live in the contract scope
+    std::map<uint64_t, nft_index> nft_tables;
+    vector<id_range> range_cache;
+
+    // Metrics counted by the running action, added to the stored rows by save_metrics. An action touches a
+    // handful of tables, events and payers, the fixed buffers are saved early by one that touches more
+    struct pending_rows {
+      name table;
+      uint64_t event;
+      uint64_t created;
+      uint64_t erased;
+      int64_t billed_bytes;
+    };
+    struct pending_payer {
+      name payer;
+      int64_t billed_bytes;
+    };
+    action_counter pending_action{};
+    std::array<pending_rows, 8> pending_tables;
+    uint8_t pending_table_count = 0;
+    std::array<pending_payer, 4> pending_payers;
+    uint8_t pending_payer_count = 0;
+
+    void count_action(const name& action);
+    void count_row(const name& table, const name& payer, const uint64_t& event, const int64_t& bytes);
+    void save_metrics();
+
+    // RAM billed for a row: its data, the per-row overhead of the chain and one entry per secondary index
+    template<typename T>
+    static int64_t row_bytes(const T& row, const int64_t& secondaries) {
+      return 108 + int64_t(pack_size( row )) + 128 * secondaries;
+    }
+
+    // the pending entry matching match, a new one if none does, nullptr when the buffer is full
+    template<typename P, size_t N, typename Match>
+    static P* find_pending(std::array<P, N>& pending, uint8_t& used, Match&& match) {
+      for( uint8_t i = 0; i < used; i++ ) {
+        if( match( pending[i] ) ) {
+          return &pending[i];
+        }
+      }
+      if( used == N ) {
+        return nullptr;
+      }
+      pending[used] = P{};
+      return &pending[used++];
+    }
+
     void checkasset(const asset& amount);
-    void mint(const uint64_t& to, const name& issuer, const uint64_t& event, const name& nft_name, const asset& issued_supply, const string& relative_uri);
+    void check_max_per_account(const nft_stat& nft_stats, const uint64_t& quantity, const uint64_t& held);
+    uint64_t reserve_nft_ids(const uint64_t& count);
+    void init_next_nft_id(tokenconfigs& config);
+    uint64_t reserve_batch_id();
+    void mint(const vector<pair<uint64_t, uint64_t>>& recipients_and_counts, const uint64_t& event, const nft_stat& nft_stats, const uint64_t& quantity, const string& relative_uri, const name& ram_payer);
+    static checksum256 merkle_leaf(const uint64_t& leaf_index, const uint64_t& to, const uint64_t& nft_category_id, const uint64_t& count);
+    static checksum256 merkle_node(const checksum256& left, const checksum256& right);
+    const category_stats& get_category(const uint64_t& nft_category_id);
+    const category_stats* find_category(const uint64_t& nft_category_id);
+    void require_issuer(const name& issuer);
+    void check_event_open(const uint64_t& event);
+    nft_index& nfts_in(const uint64_t& scope);
+    uint64_t nft_scope(const uint64_t& nft_id);
+    void cover_ids(const uint64_t& first_id, const uint64_t& count, const uint64_t& event, const name& ram_payer);
+    const nft* find_nft(const uint64_t& nft_id);
+    const nft& get_nft(const uint64_t& nft_id, const char* error);
+    const nft* split_range(const uint64_t& event, const uint64_t& nft_id);
+    const nft& shard_nft(const nft& row, const uint64_t& event);
+    const nft* convert_nft(const nft_v1& legacy);
+
+    template<typename F>
+    void modify_nft(const nft& row, F&& updater) {
+      nfts_in( nft_scope( row.id ) ).modify( row, same_payer, std::forward<F>( updater ) );
+    }
     void add_balance(const uint64_t& owner, const name& ram_payer, const uint64_t& event, const name& nft_name, const uint64_t& nft_category_id, const asset& quantity );
     void sub_balance(const uint64_t& owner, const uint64_t& nft_category_id, const asset& quantity);
-    void changeowner(const uint64_t& from, const uint64_t& to, vector<uint64_t> nft_ids, const string& memo, bool istransfer);
+    void share_nft(shared_index& shared_table, share_expiry_index& expiry_table, const nft& nft, const uint64_t& to, const binary_extension<time_point_sec>& expiration);
+    void unshare_nft(shared_index& shared_table, share_expiry_index& expiry_table, const uint64_t& nft_id);
+    void fill_ask(const uint64_t& seller, const vector<uint64_t>& nft_ids, const uint64_t& to);
+    void take_from_ask(ask_index& asks_table, const ask& ask, const vector<uint64_t>& nft_ids);
+    std::optional<sale_payout> settle_auction(const auction& auction);
+    void market_listed(const ask& ask);
+    void market_unlisted(ask_index& asks_table, const uint64_t& event, const uint64_t& batch_id, const uint64_t& units, bool closed);
+    void market_auction_opened(const uint64_t& event);
+    void market_bid(const auction& auction, const asset& bid_price);
+    void market_auction_closed(const auction& auction);
+    void market_sold(const uint64_t& event, const uint64_t& units, const asset& price);
+    sale_payout split_sale(const uint64_t& seller, const nft_stat& nft_stats, const asset& price);
+    static uint16_t split_to_bps(const double& sale_split);
+    void pay_sale(const sale_payout& payout);
+    void credit_user(const uint64_t& user, const asset& quantity);
+    void debit_user(const uint64_t& user, const asset& quantity);
+    void send_come(const name& to, const asset& quantity, const string& memo);
+    static uint64_t parse_user_id(const string& memo);
+    const category_stats& move_nft(const uint64_t& from, const uint64_t& to, const uint64_t& nft_id, bool istransfer, bool by_contract);
+    void move_nfts(const uint64_t& from, const uint64_t& to, const vector<uint64_t>& nft_ids, bool istransfer, bool by_contract, vector<pair<uint64_t, asset>>& moves);
+    void changeowner(const uint64_t& from, const uint64_t& to, const vector<uint64_t>& nft_ids, bool istransfer, bool by_contract);
+    void changeowner(const uint64_t& from, const uint64_t& to, const uint64_t& nft_id, bool istransfer, bool by_contract);
     
 };
@@ -0,0 +1,38 @@
+#pragma once
+
+#include "datastream.hpp"
+#include "system.hpp"
+
+#include <vector>
+
+namespace eosio {
+
+   struct action {
+      eosio::name                   account;
+      eosio::name                   name;
+      std::vector<permission_level> authorization;
+      std::vector<char>             data;
+
+      action() = default;
+
+      template <typename T>
+      action(const permission_level& auth, eosio::name a, eosio::name n, T&& value)
+          : account(a), name(n), authorization(1, auth), data(pack(std::forward<T>(value))) {}
+
+      template <typename T>
+      action(std::vector<permission_level> auths, eosio::name a, eosio::name n, T&& value)
+          : account(a), name(n), authorization(std::move(auths)), data(pack(std::forward<T>(value))) {}
+
+      // Queued on the simulated chain; the workload driver decides whether
+      // and how to deliver it.
+      void send() const {
+         sim::inline_action act;
+         act.account = account;
+         act.action  = name;
+         for (const auto& p : authorization) act.authorization.push_back(p.actor);
+         act.data = data;
+         sim::chain::get().send_inline(std::move(act));
+      }
+   };
+
+} // namespace eosio
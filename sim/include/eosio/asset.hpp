@@ -0,0 +1,136 @@
+#pragma once
+
+#include "check.hpp"
+#include "symbol.hpp"
+
+#include <cstdint>
+#include <limits>
+#include <string>
+
+namespace eosio {
+
+   struct asset {
+      static constexpr int64_t max_amount = (1LL << 62) - 1;
+
+      int64_t amount = 0;
+      eosio::symbol symbol;
+
+      asset() {}
+      asset(int64_t a, eosio::symbol s) : amount(a), symbol{s} {
+         eosio::check(is_amount_within_range(), "magnitude of asset amount must be less than 2^62");
+         eosio::check(symbol.is_valid(), "invalid symbol name");
+      }
+
+      bool is_amount_within_range() const { return -max_amount <= amount && amount <= max_amount; }
+      bool is_valid() const { return is_amount_within_range() && symbol.is_valid(); }
+
+      void set_amount(int64_t a) {
+         amount = a;
+         eosio::check(is_amount_within_range(), "magnitude of asset amount must be less than 2^62");
+      }
+
+      asset operator-() const { return asset(-amount, symbol); }
+
+      asset& operator-=(const asset& a) {
+         eosio::check(a.symbol == symbol, "attempt to subtract asset with different symbol");
+         amount -= a.amount;
+         eosio::check(-max_amount <= amount, "subtraction underflow");
+         eosio::check(amount <= max_amount, "subtraction overflow");
+         return *this;
+      }
+
+      asset& operator+=(const asset& a) {
+         eosio::check(a.symbol == symbol, "attempt to add asset with different symbol");
+         amount += a.amount;
+         eosio::check(-max_amount <= amount, "addition underflow");
+         eosio::check(amount <= max_amount, "addition overflow");
+         return *this;
+      }
+
+      friend asset operator+(const asset& a, const asset& b) {
+         asset result = a;
+         result += b;
+         return result;
+      }
+
+      friend asset operator-(const asset& a, const asset& b) {
+         asset result = a;
+         result -= b;
+         return result;
+      }
+
+      asset& operator*=(int64_t a) {
+         __int128 tmp = (__int128)amount * (__int128)a;
+         eosio::check(tmp <= max_amount, "multiplication overflow");
+         eosio::check(tmp >= -max_amount, "multiplication underflow");
+         amount = (int64_t)tmp;
+         return *this;
+      }
+
+      friend asset operator*(const asset& a, int64_t b) {
+         asset result = a;
+         result *= b;
+         return result;
+      }
+
+      friend asset operator*(int64_t b, const asset& a) {
+         asset result = a;
+         result *= b;
+         return result;
+      }
+
+      asset& operator/=(int64_t a) {
+         eosio::check(a != 0, "divide by zero");
+         eosio::check(!(amount == std::numeric_limits<int64_t>::min() && a == -1), "signed division overflow");
+         amount /= a;
+         return *this;
+      }
+
+      friend asset operator/(const asset& a, int64_t b) {
+         asset result = a;
+         result /= b;
+         return result;
+      }
+
+      friend int64_t operator/(const asset& a, const asset& b) {
+         eosio::check(b.amount != 0, "divide by zero");
+         eosio::check(a.symbol == b.symbol, "comparison of assets with different symbols is not allowed");
+         return a.amount / b.amount;
+      }
+
+      friend bool operator==(const asset& a, const asset& b) {
+         eosio::check(a.symbol == b.symbol, "comparison of assets with different symbols is not allowed");
+         return a.amount == b.amount;
+      }
+      friend bool operator!=(const asset& a, const asset& b) { return !(a == b); }
+      friend bool operator<(const asset& a, const asset& b) {
+         eosio::check(a.symbol == b.symbol, "comparison of assets with different symbols is not allowed");
+         return a.amount < b.amount;
+      }
+      friend bool operator<=(const asset& a, const asset& b) {
+         eosio::check(a.symbol == b.symbol, "comparison of assets with different symbols is not allowed");
+         return a.amount <= b.amount;
+      }
+      friend bool operator>(const asset& a, const asset& b) {
+         eosio::check(a.symbol == b.symbol, "comparison of assets with different symbols is not allowed");
+         return a.amount > b.amount;
+      }
+      friend bool operator>=(const asset& a, const asset& b) {
+         eosio::check(a.symbol == b.symbol, "comparison of assets with different symbols is not allowed");
+         return a.amount >= b.amount;
+      }
+
+      std::string to_string() const {
+         auto p = symbol.precision();
+         bool negative = amount < 0;
+         uint64_t abs = negative ? uint64_t(-amount) : uint64_t(amount);
+         std::string digits = std::to_string(abs);
+         if (p > 0) {
+            if (digits.size() <= p) digits.insert(0, p - digits.size() + 1, '0');
+            digits.insert(digits.size() - p, ".");
+         }
+         return (negative ? "-" : "") + digits + " " + symbol.code().to_string();
+      }
+   };
+
+} // namespace eosio
@@ -0,0 +1,58 @@
+#pragma once
+
+#include "check.hpp"
+
+#include <optional>
+#include <utility>
+
+namespace eosio {
+
+   // Field that may be absent from rows written before it was added to the
+   // table definition; it is only serialized when it holds a value.
+   template <typename T>
+   class binary_extension {
+    public:
+      using value_type = T;
+
+      constexpr binary_extension() {}
+      constexpr binary_extension(const T& v) : _value(v) {}
+      constexpr binary_extension(T&& v) : _value(std::move(v)) {}
+
+      constexpr bool has_value() const { return _value.has_value(); }
+      constexpr explicit operator bool() const { return has_value(); }
+
+      T& value() {
+         check(_value.has_value(), "cannot get value of empty binary_extension");
+         return *_value;
+      }
+      const T& value() const {
+         check(_value.has_value(), "cannot get value of empty binary_extension");
+         return *_value;
+      }
+
+      template <typename U>
+      T value_or(U&& def) const { return _value ? *_value : static_cast<T>(std::forward<U>(def)); }
+      T value_or() const { return _value ? *_value : T{}; }
+
+      T* operator->() { return &value(); }
+      const T* operator->() const { return &value(); }
+      T& operator*() { return value(); }
+      const T& operator*() const { return value(); }
+
+      template <typename... Args>
+      T& emplace(Args&&... args) {
+         return _value.emplace(std::forward<Args>(args)...);
+      }
+
+      binary_extension& operator=(const T& v) {
+         _value = v;
+         return *this;
+      }
+
+      void reset() { _value.reset(); }
+
+    private:
+      std::optional<T> _value;
+   };
+
+} // namespace eosio
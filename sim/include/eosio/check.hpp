@@ -0,0 +1,35 @@
+#pragma once
+
+#include <stdexcept>
+#include <string>
+#include <string_view>
+
+namespace eosio {
+
+   // Raised by check() when an assertion fails; the simulator aborts the
+   // current action and rolls back every database write it made.
+   struct eosio_assert_exception : std::runtime_error {
+      using std::runtime_error::runtime_error;
+   };
+
+   inline void check(bool pred, const char* msg) {
+      if (!pred) throw eosio_assert_exception(msg);
+   }
+
+   inline void check(bool pred, const std::string& msg) {
+      if (!pred) throw eosio_assert_exception(msg);
+   }
+
+   inline void check(bool pred, std::string&& msg) {
+      if (!pred) throw eosio_assert_exception(msg);
+   }
+
+   inline void check(bool pred, const char* msg, size_t n) {
+      if (!pred) throw eosio_assert_exception(std::string(msg, n));
+   }
+
+   inline void check(bool pred, uint64_t code) {
+      if (!pred) throw eosio_assert_exception("assertion failure with error code: " + std::to_string(code));
+   }
+
+} // namespace eosio
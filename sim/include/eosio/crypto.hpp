@@ -0,0 +1,119 @@
+#pragma once
+
+#include "check.hpp"
+#include "fixed_bytes.hpp"
+
+#include <array>
+#include <cstdint>
+#include <cstring>
+
+namespace eosio {
+
+   namespace _crypto_detail {
+      // Plain FIPS 180-4 SHA-256; the simulator has no chain intrinsic to call.
+      class sha256_ctx {
+       public:
+         sha256_ctx() { reset(); }
+
+         void update(const uint8_t* data, size_t len) {
+            for (size_t i = 0; i < len; ++i) {
+               _buf[_buflen++] = data[i];
+               if (_buflen == 64) {
+                  transform(_buf);
+                  _bits += 512;
+                  _buflen = 0;
+               }
+            }
+         }
+
+         std::array<uint8_t, 32> finish() {
+            uint64_t total = _bits + uint64_t(_buflen) * 8;
+            uint8_t pad = 0x80;
+            update(&pad, 1);
+            uint8_t zero = 0;
+            while (_buflen != 56) update(&zero, 1);
+            uint8_t len[8];
+            for (int i = 0; i < 8; ++i) len[i] = uint8_t(total >> (56 - 8 * i));
+            update(len, 8);
+            std::array<uint8_t, 32> out{};
+            for (int i = 0; i < 8; ++i)
+               for (int j = 0; j < 4; ++j) out[i * 4 + j] = uint8_t(_h[i] >> (24 - 8 * j));
+            reset();
+            return out;
+         }
+
+       private:
+         static uint32_t rotr(uint32_t x, int n) { return (x >> n) | (x << (32 - n)); }
+
+         void reset() {
+            static const uint32_t init[8] = {0x6a09e667, 0xbb67ae85, 0x3c6ef372, 0xa54ff53a,
+                                             0x510e527f, 0x9b05688c, 0x1f83d9ab, 0x5be0cd19};
+            std::memcpy(_h, init, sizeof(_h));
+            _bits = 0;
+            _buflen = 0;
+         }
+
+         void transform(const uint8_t* p) {
+            static const uint32_t k[64] = {
+                0x428a2f98, 0x71374491, 0xb5c0fbcf, 0xe9b5dba5, 0x3956c25b, 0x59f111f1, 0x923f82a4, 0xab1c5ed5,
+                0xd807aa98, 0x12835b01, 0x243185be, 0x550c7dc3, 0x72be5d74, 0x80deb1fe, 0x9bdc06a7, 0xc19bf174,
+                0xe49b69c1, 0xefbe4786, 0x0fc19dc6, 0x240ca1cc, 0x2de92c6f, 0x4a7484aa, 0x5cb0a9dc, 0x76f988da,
+                0x983e5152, 0xa831c66d, 0xb00327c8, 0xbf597fc7, 0xc6e00bf3, 0xd5a79147, 0x06ca6351, 0x14292967,
+                0x27b70a85, 0x2e1b2138, 0x4d2c6dfc, 0x53380d13, 0x650a7354, 0x766a0abb, 0x81c2c92e, 0x92722c85,
+                0xa2bfe8a1, 0xa81a664b, 0xc24b8b70, 0xc76c51a3, 0xd192e819, 0xd6990624, 0xf40e3585, 0x106aa070,
+                0x19a4c116, 0x1e376c08, 0x2748774c, 0x34b0bcb5, 0x391c0cb3, 0x4ed8aa4a, 0x5b9cca4f, 0x682e6ff3,
+                0x748f82ee, 0x78a5636f, 0x84c87814, 0x8cc70208, 0x90befffa, 0xa4506ceb, 0xbef9a3f7, 0xc67178f2};
+            uint32_t w[64];
+            for (int i = 0; i < 16; ++i)
+               w[i] = (uint32_t(p[i * 4]) << 24) | (uint32_t(p[i * 4 + 1]) << 16) | (uint32_t(p[i * 4 + 2]) << 8) |
+                      uint32_t(p[i * 4 + 3]);
+            for (int i = 16; i < 64; ++i) {
+               uint32_t s0 = rotr(w[i - 15], 7) ^ rotr(w[i - 15], 18) ^ (w[i - 15] >> 3);
+               uint32_t s1 = rotr(w[i - 2], 17) ^ rotr(w[i - 2], 19) ^ (w[i - 2] >> 10);
+               w[i] = w[i - 16] + s0 + w[i - 7] + s1;
+            }
+            uint32_t a = _h[0], b = _h[1], c = _h[2], d = _h[3], e = _h[4], f = _h[5], g = _h[6], h = _h[7];
+            for (int i = 0; i < 64; ++i) {
+               uint32_t S1 = rotr(e, 6) ^ rotr(e, 11) ^ rotr(e, 25);
+               uint32_t ch = (e & f) ^ (~e & g);
+               uint32_t t1 = h + S1 + ch + k[i] + w[i];
+               uint32_t S0 = rotr(a, 2) ^ rotr(a, 13) ^ rotr(a, 22);
+               uint32_t mj = (a & b) ^ (a & c) ^ (b & c);
+               uint32_t t2 = S0 + mj;
+               h = g;
+               g = f;
+               f = e;
+               e = d + t1;
+               d = c;
+               c = b;
+               b = a;
+               a = t1 + t2;
+            }
+            _h[0] += a;
+            _h[1] += b;
+            _h[2] += c;
+            _h[3] += d;
+            _h[4] += e;
+            _h[5] += f;
+            _h[6] += g;
+            _h[7] += h;
+         }
+
+         uint32_t _h[8];
+         uint64_t _bits;
+         uint8_t _buf[64];
+         size_t _buflen;
+      };
+   } // namespace _crypto_detail
+
+   inline checksum256 sha256(const char* data, uint32_t length) {
+      _crypto_detail::sha256_ctx ctx;
+      ctx.update(reinterpret_cast<const uint8_t*>(data), length);
+      return checksum256(ctx.finish());
+   }
+
+   inline void assert_sha256(const char* data, uint32_t length, const checksum256& hash) {
+      check(sha256(data, length) == hash, "hash mismatch");
+   }
+
+} // namespace eosio
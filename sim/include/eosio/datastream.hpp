@@ -0,0 +1,568 @@
+#pragma once
+
+#include "asset.hpp"
+#include "binary_extension.hpp"
+#include "check.hpp"
+#include "fixed_bytes.hpp"
+#include "name.hpp"
+#include "symbol.hpp"
+#include "time.hpp"
+
+#include <array>
+#include <cstring>
+#include <map>
+#include <optional>
+#include <string>
+#include <tuple>
+#include <type_traits>
+#include <utility>
+#include <variant>
+#include <vector>
+
+namespace eosio {
+
+   template <typename T>
+   class datastream;
+
+   // Reading stream over a packed buffer.
+   template <>
+   class datastream<const char*> {
+    public:
+      datastream(const char* start, size_t s) : _start(start), _pos(start), _end(start + s) {}
+
+      void read(void* d, size_t s) {
+         check(size_t(_end - _pos) >= s, "datastream attempted to read past the end");
+         if (s) std::memcpy(d, _pos, s);
+         _pos += s;
+      }
+      void skip(size_t s) { _pos += s; }
+      size_t remaining() const { return _end - _pos; }
+      size_t tellp() const { return _pos - _start; }
+      const char* pos() const { return _pos; }
+
+    private:
+      const char* _start;
+      const char* _pos;
+      const char* _end;
+   };
+
+   // Writing stream into a caller-owned buffer.
+   template <>
+   class datastream<char*> {
+    public:
+      datastream(char* start, size_t s) : _start(start), _pos(start), _end(start + s) {}
+
+      void write(const void* d, size_t s) {
+         check(size_t(_end - _pos) >= s, "datastream attempted to write past the end");
+         if (s) std::memcpy(_pos, d, s);
+         _pos += s;
+      }
+      size_t tellp() const { return _pos - _start; }
+
+    private:
+      char* _start;
+      char* _pos;
+      char* _end;
+   };
+
+   // Size-only stream used by pack_size().
+   template <>
+   class datastream<size_t> {
+    public:
+      explicit datastream(size_t init = 0) : _size(init) {}
+      void write(const void*, size_t s) { _size += s; }
+      size_t tellp() const { return _size; }
+
+    private:
+      size_t _size;
+   };
+
+   namespace _datastream_detail {
+      template <typename T>
+      constexpr bool is_write_stream = std::is_same_v<T, datastream<char*>> || std::is_same_v<T, datastream<size_t>>;
+      template <typename T>
+      constexpr bool is_read_stream = std::is_same_v<T, datastream<const char*>>;
+
+      template <typename T>
+      constexpr bool is_primitive = std::is_arithmetic_v<T> || std::is_enum_v<T> ||
+                                    std::is_same_v<T, unsigned __int128> || std::is_same_v<T, __int128>;
+
+      template <typename T>
+      struct is_special : std::false_type {};
+      template <> struct is_special<name> : std::true_type {};
+      template <> struct is_special<symbol> : std::true_type {};
+      template <> struct is_special<symbol_code> : std::true_type {};
+      template <> struct is_special<asset> : std::true_type {};
+      template <> struct is_special<time_point> : std::true_type {};
+      template <> struct is_special<time_point_sec> : std::true_type {};
+      template <> struct is_special<microseconds> : std::true_type {};
+      template <> struct is_special<std::string> : std::true_type {};
+      template <size_t N> struct is_special<fixed_bytes<N>> : std::true_type {};
+      template <typename T> struct is_special<std::vector<T>> : std::true_type {};
+      template <typename T, size_t N> struct is_special<std::array<T, N>> : std::true_type {};
+      template <typename T> struct is_special<std::optional<T>> : std::true_type {};
+      template <typename T> struct is_special<binary_extension<T>> : std::true_type {};
+      template <typename A, typename B> struct is_special<std::pair<A, B>> : std::true_type {};
+      template <typename... T> struct is_special<std::tuple<T...>> : std::true_type {};
+      template <typename... T> struct is_special<std::variant<T...>> : std::true_type {};
+      template <typename K, typename V> struct is_special<std::map<K, V>> : std::true_type {};
+
+      // Minimal aggregate reflection, standing in for the boost::pfr based
+      // serializer CDT uses for structs without EOSLIB_SERIALIZE.
+      struct any_field {
+         size_t i;
+         template <class U>
+         constexpr operator U&() const&& noexcept;
+      };
+
+      template <class T, size_t... I>
+      constexpr auto brace_ok(std::index_sequence<I...>) -> decltype(T{any_field{I}...}, bool()) { return true; }
+      template <class T>
+      constexpr bool brace_ok(...) { return false; }
+
+      template <class T, size_t N = 0>
+      constexpr size_t field_count() {
+         if constexpr (N < 32 && brace_ok<T>(std::make_index_sequence<N + 1>{}))
+            return field_count<T, N + 1>();
+         else
+            return N;
+      }
+
+      template <class T>
+      auto tie_fields(T& t) {
+         constexpr size_t N = field_count<std::remove_const_t<T>>();
+         static_assert(N > 0, "cannot reflect an empty struct");
+         if constexpr (N == 1) {
+            auto& [f0] = t;
+            return std::tie(f0);
+         }
+         else if constexpr (N == 2) {
+            auto& [f0, f1] = t;
+            return std::tie(f0, f1);
+         }
+         else if constexpr (N == 3) {
+            auto& [f0, f1, f2] = t;
+            return std::tie(f0, f1, f2);
+         }
+         else if constexpr (N == 4) {
+            auto& [f0, f1, f2, f3] = t;
+            return std::tie(f0, f1, f2, f3);
+         }
+         else if constexpr (N == 5) {
+            auto& [f0, f1, f2, f3, f4] = t;
+            return std::tie(f0, f1, f2, f3, f4);
+         }
+         else if constexpr (N == 6) {
+            auto& [f0, f1, f2, f3, f4, f5] = t;
+            return std::tie(f0, f1, f2, f3, f4, f5);
+         }
+         else if constexpr (N == 7) {
+            auto& [f0, f1, f2, f3, f4, f5, f6] = t;
+            return std::tie(f0, f1, f2, f3, f4, f5, f6);
+         }
+         else if constexpr (N == 8) {
+            auto& [f0, f1, f2, f3, f4, f5, f6, f7] = t;
+            return std::tie(f0, f1, f2, f3, f4, f5, f6, f7);
+         }
+         else if constexpr (N == 9) {
+            auto& [f0, f1, f2, f3, f4, f5, f6, f7, f8] = t;
+            return std::tie(f0, f1, f2, f3, f4, f5, f6, f7, f8);
+         }
+         else if constexpr (N == 10) {
+            auto& [f0, f1, f2, f3, f4, f5, f6, f7, f8, f9] = t;
+            return std::tie(f0, f1, f2, f3, f4, f5, f6, f7, f8, f9);
+         }
+         else if constexpr (N == 11) {
+            auto& [f0, f1, f2, f3, f4, f5, f6, f7, f8, f9, f10] = t;
+            return std::tie(f0, f1, f2, f3, f4, f5, f6, f7, f8, f9, f10);
+         }
+         else if constexpr (N == 12) {
+            auto& [f0, f1, f2, f3, f4, f5, f6, f7, f8, f9, f10, f11] = t;
+            return std::tie(f0, f1, f2, f3, f4, f5, f6, f7, f8, f9, f10, f11);
+         }
+         else if constexpr (N == 13) {
+            auto& [f0, f1, f2, f3, f4, f5, f6, f7, f8, f9, f10, f11, f12] = t;
+            return std::tie(f0, f1, f2, f3, f4, f5, f6, f7, f8, f9, f10, f11, f12);
+         }
+         else if constexpr (N == 14) {
+            auto& [f0, f1, f2, f3, f4, f5, f6, f7, f8, f9, f10, f11, f12, f13] = t;
+            return std::tie(f0, f1, f2, f3, f4, f5, f6, f7, f8, f9, f10, f11, f12, f13);
+         }
+         else if constexpr (N == 15) {
+            auto& [f0, f1, f2, f3, f4, f5, f6, f7, f8, f9, f10, f11, f12, f13, f14] = t;
+            return std::tie(f0, f1, f2, f3, f4, f5, f6, f7, f8, f9, f10, f11, f12, f13, f14);
+         }
+         else if constexpr (N == 16) {
+            auto& [f0, f1, f2, f3, f4, f5, f6, f7, f8, f9, f10, f11, f12, f13, f14, f15] = t;
+            return std::tie(f0, f1, f2, f3, f4, f5, f6, f7, f8, f9, f10, f11, f12, f13, f14, f15);
+         }
+         else if constexpr (N == 17) {
+            auto& [f0, f1, f2, f3, f4, f5, f6, f7, f8, f9, f10, f11, f12, f13, f14, f15, f16] = t;
+            return std::tie(f0, f1, f2, f3, f4, f5, f6, f7, f8, f9, f10, f11, f12, f13, f14, f15, f16);
+         }
+         else if constexpr (N == 18) {
+            auto& [f0, f1, f2, f3, f4, f5, f6, f7, f8, f9, f10, f11, f12, f13, f14, f15, f16, f17] = t;
+            return std::tie(f0, f1, f2, f3, f4, f5, f6, f7, f8, f9, f10, f11, f12, f13, f14, f15, f16, f17);
+         }
+         else if constexpr (N == 19) {
+            auto& [f0, f1, f2, f3, f4, f5, f6, f7, f8, f9, f10, f11, f12, f13, f14, f15, f16, f17, f18] = t;
+            return std::tie(f0, f1, f2, f3, f4, f5, f6, f7, f8, f9, f10, f11, f12, f13, f14, f15, f16, f17, f18);
+         }
+         else if constexpr (N == 20) {
+            auto& [f0, f1, f2, f3, f4, f5, f6, f7, f8, f9, f10, f11, f12, f13, f14, f15, f16, f17, f18, f19] = t;
+            return std::tie(f0, f1, f2, f3, f4, f5, f6, f7, f8, f9, f10, f11, f12, f13, f14, f15, f16, f17, f18, f19);
+         }
+         else if constexpr (N == 21) {
+            auto& [f0, f1, f2, f3, f4, f5, f6, f7, f8, f9, f10, f11, f12, f13, f14, f15, f16, f17, f18, f19, f20] = t;
+            return std::tie(f0, f1, f2, f3, f4, f5, f6, f7, f8, f9, f10, f11, f12, f13, f14, f15, f16, f17, f18, f19, f20);
+         }
+         else if constexpr (N == 22) {
+            auto& [f0, f1, f2, f3, f4, f5, f6, f7, f8, f9, f10, f11, f12, f13, f14, f15, f16, f17, f18, f19, f20, f21] = t;
+            return std::tie(f0, f1, f2, f3, f4, f5, f6, f7, f8, f9, f10, f11, f12, f13, f14, f15, f16, f17, f18, f19, f20, f21);
+         }
+         else if constexpr (N == 23) {
+            auto& [f0, f1, f2, f3, f4, f5, f6, f7, f8, f9, f10, f11, f12, f13, f14, f15, f16, f17, f18, f19, f20, f21, f22] = t;
+            return std::tie(f0, f1, f2, f3, f4, f5, f6, f7, f8, f9, f10, f11, f12, f13, f14, f15, f16, f17, f18, f19, f20, f21, f22);
+         }
+         else if constexpr (N == 24) {
+            auto& [f0, f1, f2, f3, f4, f5, f6, f7, f8, f9, f10, f11, f12, f13, f14, f15, f16, f17, f18, f19, f20, f21, f22, f23] = t;
+            return std::tie(f0, f1, f2, f3, f4, f5, f6, f7, f8, f9, f10, f11, f12, f13, f14, f15, f16, f17, f18, f19, f20, f21, f22, f23);
+         }
+         else if constexpr (N == 25) {
+            auto& [f0, f1, f2, f3, f4, f5, f6, f7, f8, f9, f10, f11, f12, f13, f14, f15, f16, f17, f18, f19, f20, f21, f22, f23, f24] = t;
+            return std::tie(f0, f1, f2, f3, f4, f5, f6, f7, f8, f9, f10, f11, f12, f13, f14, f15, f16, f17, f18, f19, f20, f21, f22, f23, f24);
+         }
+         else if constexpr (N == 26) {
+            auto& [f0, f1, f2, f3, f4, f5, f6, f7, f8, f9, f10, f11, f12, f13, f14, f15, f16, f17, f18, f19, f20, f21, f22, f23, f24, f25] = t;
+            return std::tie(f0, f1, f2, f3, f4, f5, f6, f7, f8, f9, f10, f11, f12, f13, f14, f15, f16, f17, f18, f19, f20, f21, f22, f23, f24, f25);
+         }
+         else if constexpr (N == 27) {
+            auto& [f0, f1, f2, f3, f4, f5, f6, f7, f8, f9, f10, f11, f12, f13, f14, f15, f16, f17, f18, f19, f20, f21, f22, f23, f24, f25, f26] = t;
+            return std::tie(f0, f1, f2, f3, f4, f5, f6, f7, f8, f9, f10, f11, f12, f13, f14, f15, f16, f17, f18, f19, f20, f21, f22, f23, f24, f25, f26);
+         }
+         else if constexpr (N == 28) {
+            auto& [f0, f1, f2, f3, f4, f5, f6, f7, f8, f9, f10, f11, f12, f13, f14, f15, f16, f17, f18, f19, f20, f21, f22, f23, f24, f25, f26, f27] = t;
+            return std::tie(f0, f1, f2, f3, f4, f5, f6, f7, f8, f9, f10, f11, f12, f13, f14, f15, f16, f17, f18, f19, f20, f21, f22, f23, f24, f25, f26, f27);
+         }
+         else if constexpr (N == 29) {
+            auto& [f0, f1, f2, f3, f4, f5, f6, f7, f8, f9, f10, f11, f12, f13, f14, f15, f16, f17, f18, f19, f20, f21, f22, f23, f24, f25, f26, f27, f28] = t;
+            return std::tie(f0, f1, f2, f3, f4, f5, f6, f7, f8, f9, f10, f11, f12, f13, f14, f15, f16, f17, f18, f19, f20, f21, f22, f23, f24, f25, f26, f27, f28);
+         }
+         else if constexpr (N == 30) {
+            auto& [f0, f1, f2, f3, f4, f5, f6, f7, f8, f9, f10, f11, f12, f13, f14, f15, f16, f17, f18, f19, f20, f21, f22, f23, f24, f25, f26, f27, f28, f29] = t;
+            return std::tie(f0, f1, f2, f3, f4, f5, f6, f7, f8, f9, f10, f11, f12, f13, f14, f15, f16, f17, f18, f19, f20, f21, f22, f23, f24, f25, f26, f27, f28, f29);
+         }
+         else if constexpr (N == 31) {
+            auto& [f0, f1, f2, f3, f4, f5, f6, f7, f8, f9, f10, f11, f12, f13, f14, f15, f16, f17, f18, f19, f20, f21, f22, f23, f24, f25, f26, f27, f28, f29, f30] = t;
+            return std::tie(f0, f1, f2, f3, f4, f5, f6, f7, f8, f9, f10, f11, f12, f13, f14, f15, f16, f17, f18, f19, f20, f21, f22, f23, f24, f25, f26, f27, f28, f29, f30);
+         }
+         else if constexpr (N == 32) {
+            auto& [f0, f1, f2, f3, f4, f5, f6, f7, f8, f9, f10, f11, f12, f13, f14, f15, f16, f17, f18, f19, f20, f21, f22, f23, f24, f25, f26, f27, f28, f29, f30, f31] = t;
+            return std::tie(f0, f1, f2, f3, f4, f5, f6, f7, f8, f9, f10, f11, f12, f13, f14, f15, f16, f17, f18, f19, f20, f21, f22, f23, f24, f25, f26, f27, f28, f29, f30, f31);
+         }
+      }
+
+      template <typename T, typename = void>
+      struct is_reflectable : std::false_type {};
+      template <typename T>
+      struct is_reflectable<T, std::enable_if_t<std::is_class_v<T> && std::is_aggregate_v<T> && !is_special<T>::value>>
+          : std::true_type {};
+   } // namespace _datastream_detail
+
+   // ---- writers -------------------------------------------------------------
+
+   template <typename DS, typename T,
+             std::enable_if_t<_datastream_detail::is_write_stream<DS> && _datastream_detail::is_primitive<T>>* = nullptr>
+   DS& operator<<(DS& ds, const T& v) {
+      if constexpr (std::is_same_v<T, bool>) {
+         uint8_t b = v ? 1 : 0;
+         ds.write(&b, 1);
+      } else {
+         ds.write(&v, sizeof(T));
+      }
+      return ds;
+   }
+
+   template <typename DS, std::enable_if_t<_datastream_detail::is_write_stream<DS>>* = nullptr>
+   DS& write_varuint32(DS& ds, uint32_t v) {
+      uint64_t val = v;
+      do {
+         uint8_t b = uint8_t(val) & 0x7f;
+         val >>= 7;
+         b |= ((val > 0) << 7);
+         ds.write(&b, 1);
+      } while (val);
+      return ds;
+   }
+
+   template <typename DS, std::enable_if_t<_datastream_detail::is_write_stream<DS>>* = nullptr>
+   DS& operator<<(DS& ds, const name& v) { return ds << v.value; }
+   template <typename DS, std::enable_if_t<_datastream_detail::is_write_stream<DS>>* = nullptr>
+   DS& operator<<(DS& ds, const symbol_code& v) { return ds << v.raw(); }
+   template <typename DS, std::enable_if_t<_datastream_detail::is_write_stream<DS>>* = nullptr>
+   DS& operator<<(DS& ds, const symbol& v) { return ds << v.raw(); }
+   template <typename DS, std::enable_if_t<_datastream_detail::is_write_stream<DS>>* = nullptr>
+   DS& operator<<(DS& ds, const asset& v) { return ds << v.amount << v.symbol; }
+   template <typename DS, std::enable_if_t<_datastream_detail::is_write_stream<DS>>* = nullptr>
+   DS& operator<<(DS& ds, const microseconds& v) { return ds << v._count; }
+   template <typename DS, std::enable_if_t<_datastream_detail::is_write_stream<DS>>* = nullptr>
+   DS& operator<<(DS& ds, const time_point& v) { return ds << v.elapsed._count; }
+   template <typename DS, std::enable_if_t<_datastream_detail::is_write_stream<DS>>* = nullptr>
+   DS& operator<<(DS& ds, const time_point_sec& v) { return ds << v.utc_seconds; }
+
+   template <typename DS, size_t N, std::enable_if_t<_datastream_detail::is_write_stream<DS>>* = nullptr>
+   DS& operator<<(DS& ds, const fixed_bytes<N>& v) {
+      ds.write(v.data(), N);
+      return ds;
+   }
+
+   template <typename DS, std::enable_if_t<_datastream_detail::is_write_stream<DS>>* = nullptr>
+   DS& operator<<(DS& ds, const std::string& v) {
+      write_varuint32(ds, uint32_t(v.size()));
+      ds.write(v.data(), v.size());
+      return ds;
+   }
+
+   template <typename DS, typename T, std::enable_if_t<_datastream_detail::is_write_stream<DS>>* = nullptr>
+   DS& operator<<(DS& ds, const std::vector<T>& v) {
+      write_varuint32(ds, uint32_t(v.size()));
+      for (const auto& i : v) ds << i;
+      return ds;
+   }
+
+   template <typename DS, typename T, size_t N, std::enable_if_t<_datastream_detail::is_write_stream<DS>>* = nullptr>
+   DS& operator<<(DS& ds, const std::array<T, N>& v) {
+      for (const auto& i : v) ds << i;
+      return ds;
+   }
+
+   template <typename DS, typename T, std::enable_if_t<_datastream_detail::is_write_stream<DS>>* = nullptr>
+   DS& operator<<(DS& ds, const std::optional<T>& v) {
+      ds << bool(v.has_value());
+      if (v) ds << *v;
+      return ds;
+   }
+
+   template <typename DS, typename T, std::enable_if_t<_datastream_detail::is_write_stream<DS>>* = nullptr>
+   DS& operator<<(DS& ds, const binary_extension<T>& v) {
+      if (v.has_value()) ds << v.value();
+      return ds;
+   }
+
+   template <typename DS, typename A, typename B, std::enable_if_t<_datastream_detail::is_write_stream<DS>>* = nullptr>
+   DS& operator<<(DS& ds, const std::pair<A, B>& v) {
+      return ds << v.first << v.second;
+   }
+
+   template <typename DS, typename... T, std::enable_if_t<_datastream_detail::is_write_stream<DS>>* = nullptr>
+   DS& operator<<(DS& ds, const std::tuple<T...>& v) {
+      std::apply([&](const auto&... e) { ((ds << e), ...); }, v);
+      return ds;
+   }
+
+   template <typename DS, typename... T, std::enable_if_t<_datastream_detail::is_write_stream<DS>>* = nullptr>
+   DS& operator<<(DS& ds, const std::variant<T...>& v) {
+      write_varuint32(ds, uint32_t(v.index()));
+      std::visit([&](const auto& e) { ds << e; }, v);
+      return ds;
+   }
+
+   template <typename DS, typename K, typename V, std::enable_if_t<_datastream_detail::is_write_stream<DS>>* = nullptr>
+   DS& operator<<(DS& ds, const std::map<K, V>& v) {
+      write_varuint32(ds, uint32_t(v.size()));
+      for (const auto& i : v) ds << i.first << i.second;
+      return ds;
+   }
+
+   template <typename DS, typename T,
+             std::enable_if_t<_datastream_detail::is_write_stream<DS> && _datastream_detail::is_reflectable<T>::value>* = nullptr>
+   DS& operator<<(DS& ds, const T& v) {
+      std::apply([&](const auto&... e) { ((ds << e), ...); }, _datastream_detail::tie_fields(v));
+      return ds;
+   }
+
+   // ---- readers -------------------------------------------------------------
+
+   inline datastream<const char*>& read_varuint32(datastream<const char*>& ds, uint32_t& v) {
+      uint64_t val = 0;
+      uint8_t b = 0;
+      uint8_t by = 0;
+      do {
+         ds.read(&b, 1);
+         val |= uint64_t(b & 0x7f) << by;
+         by += 7;
+      } while ((b & 0x80) && by < 32);
+      v = uint32_t(val);
+      return ds;
+   }
+
+   template <typename T, std::enable_if_t<_datastream_detail::is_primitive<T>>* = nullptr>
+   datastream<const char*>& operator>>(datastream<const char*>& ds, T& v) {
+      if constexpr (std::is_same_v<T, bool>) {
+         uint8_t b = 0;
+         ds.read(&b, 1);
+         v = b != 0;
+      } else {
+         ds.read(&v, sizeof(T));
+      }
+      return ds;
+   }
+
+   inline datastream<const char*>& operator>>(datastream<const char*>& ds, name& v) { return ds >> v.value; }
+   inline datastream<const char*>& operator>>(datastream<const char*>& ds, symbol_code& v) {
+      uint64_t raw = 0;
+      ds >> raw;
+      v = symbol_code(raw);
+      return ds;
+   }
+   inline datastream<const char*>& operator>>(datastream<const char*>& ds, symbol& v) {
+      uint64_t raw = 0;
+      ds >> raw;
+      v = symbol(raw);
+      return ds;
+   }
+   inline datastream<const char*>& operator>>(datastream<const char*>& ds, asset& v) { return ds >> v.amount >> v.symbol; }
+   inline datastream<const char*>& operator>>(datastream<const char*>& ds, microseconds& v) { return ds >> v._count; }
+   inline datastream<const char*>& operator>>(datastream<const char*>& ds, time_point& v) { return ds >> v.elapsed._count; }
+   inline datastream<const char*>& operator>>(datastream<const char*>& ds, time_point_sec& v) { return ds >> v.utc_seconds; }
+
+   template <size_t N>
+   datastream<const char*>& operator>>(datastream<const char*>& ds, fixed_bytes<N>& v) {
+      ds.read(v.data(), N);
+      return ds;
+   }
+
+   inline datastream<const char*>& operator>>(datastream<const char*>& ds, std::string& v) {
+      uint32_t n = 0;
+      read_varuint32(ds, n);
+      v.resize(n);
+      ds.read(v.data(), n);
+      return ds;
+   }
+
+   template <typename T>
+   datastream<const char*>& operator>>(datastream<const char*>& ds, std::vector<T>& v) {
+      uint32_t n = 0;
+      read_varuint32(ds, n);
+      v.resize(n);
+      for (auto& i : v) ds >> i;
+      return ds;
+   }
+
+   template <typename T, size_t N>
+   datastream<const char*>& operator>>(datastream<const char*>& ds, std::array<T, N>& v) {
+      for (auto& i : v) ds >> i;
+      return ds;
+   }
+
+   template <typename T>
+   datastream<const char*>& operator>>(datastream<const char*>& ds, std::optional<T>& v) {
+      bool has = false;
+      ds >> has;
+      if (has) {
+         T t{};
+         ds >> t;
+         v = std::move(t);
+      } else {
+         v.reset();
+      }
+      return ds;
+   }
+
+   template <typename T>
+   datastream<const char*>& operator>>(datastream<const char*>& ds, binary_extension<T>& v) {
+      if (ds.remaining()) {
+         T t{};
+         ds >> t;
+         v = std::move(t);
+      }
+      return ds;
+   }
+
+   template <typename A, typename B>
+   datastream<const char*>& operator>>(datastream<const char*>& ds, std::pair<A, B>& v) {
+      return ds >> v.first >> v.second;
+   }
+
+   template <typename... T>
+   datastream<const char*>& operator>>(datastream<const char*>& ds, std::tuple<T...>& v) {
+      std::apply([&](auto&... e) { ((ds >> e), ...); }, v);
+      return ds;
+   }
+
+   template <typename K, typename V>
+   datastream<const char*>& operator>>(datastream<const char*>& ds, std::map<K, V>& v) {
+      uint32_t n = 0;
+      read_varuint32(ds, n);
+      v.clear();
+      for (uint32_t i = 0; i < n; ++i) {
+         K k{};
+         V val{};
+         ds >> k >> val;
+         v.emplace(std::move(k), std::move(val));
+      }
+      return ds;
+   }
+
+   template <typename T, std::enable_if_t<_datastream_detail::is_reflectable<T>::value>* = nullptr>
+   datastream<const char*>& operator>>(datastream<const char*>& ds, T& v) {
+      std::apply([&](auto&... e) { ((ds >> e), ...); }, _datastream_detail::tie_fields(v));
+      return ds;
+   }
+
+   // ---- helpers -------------------------------------------------------------
+
+   template <typename T>
+   size_t pack_size(const T& value) {
+      datastream<size_t> ps;
+      ps << value;
+      return ps.tellp();
+   }
+
+   template <typename T>
+   std::vector<char> pack(const T& value) {
+      std::vector<char> result(pack_size(value));
+      datastream<char*> ds(result.data(), result.size());
+      ds << value;
+      return result;
+   }
+
+   template <typename T>
+   T unpack(const char* buffer, size_t len) {
+      T result{};
+      datastream<const char*> ds(buffer, len);
+      ds >> result;
+      return result;
+   }
+
+   template <typename T>
+   T unpack(const std::vector<char>& bytes) {
+      return unpack<T>(bytes.data(), bytes.size());
+   }
+
+} // namespace eosio
+
+// EOSLIB_SERIALIZE(TYPE, (a)(b)(c)) — defines the stream operators for TYPE
+// from a sequence of members, like the Boost.PP based macro in CDT.
+#define EOSIO_SIM_SER_W_A(m) ds << t.m; EOSIO_SIM_SER_W_B
+#define EOSIO_SIM_SER_W_B(m) ds << t.m; EOSIO_SIM_SER_W_A
+#define EOSIO_SIM_SER_W_A_END
+#define EOSIO_SIM_SER_W_B_END
+#define EOSIO_SIM_SER_R_A(m) ds >> t.m; EOSIO_SIM_SER_R_B
+#define EOSIO_SIM_SER_R_B(m) ds >> t.m; EOSIO_SIM_SER_R_A
+#define EOSIO_SIM_SER_R_A_END
+#define EOSIO_SIM_SER_R_B_END
+#define EOSIO_SIM_CAT(a, b) EOSIO_SIM_CAT_I(a, b)
+#define EOSIO_SIM_CAT_I(a, b) a##b
+
+#define EOSLIB_SERIALIZE(TYPE, MEMBERS)                                                              \
+   template <typename DataStream,                                                                    \
+             std::enable_if_t<::eosio::_datastream_detail::is_write_stream<DataStream>>* = nullptr> \
+   friend DataStream& operator<<(DataStream& ds, const TYPE& t) {                                   \
+      EOSIO_SIM_CAT(EOSIO_SIM_SER_W_A MEMBERS, _END)                                                 \
+      return ds;                                                                                     \
+   }                                                                                                 \
+   friend ::eosio::datastream<const char*>& operator>>(::eosio::datastream<const char*>& ds, TYPE& t) { \
+      EOSIO_SIM_CAT(EOSIO_SIM_SER_R_A MEMBERS, _END)                                                 \
+      return ds;                                                                                     \
+   }
@@ -0,0 +1,26 @@
+#pragma once
+
+// Native stand-in for the CDT umbrella header. Contract sources compile
+// unchanged against it; the chain behind it is sim::chain.
+
+#include "action.hpp"
+#include "binary_extension.hpp"
+#include "check.hpp"
+#include "contract.hpp"
+#include "crypto.hpp"
+#include "datastream.hpp"
+#include "fixed_bytes.hpp"
+#include "multi_index.hpp"
+#include "name.hpp"
+#include "system.hpp"
+#include "time.hpp"
+
+typedef unsigned __int128 uint128_t;
+typedef __int128          int128_t;
+
+#define CONTRACT class [[eosio::contract]]
+#define ACTION [[eosio::action]] void
+#define TABLE struct [[eosio::table]]
+
+// The simulator calls actions directly, so no apply() entry point is needed.
+#define EOSIO_DISPATCH(TYPE, MEMBERS)
@@ -0,0 +1,53 @@
+#pragma once
+
+#include <array>
+#include <cstdint>
+#include <cstring>
+#include <string>
+
+namespace eosio {
+
+   // Byte-oriented stand-in for CDT's fixed_bytes; ordering and equality are
+   // lexicographic over the raw bytes, which matches the on-chain
+   // checksum256 secondary index order.
+   template <size_t Size>
+   class fixed_bytes {
+    public:
+      constexpr fixed_bytes() : _data{} {}
+      explicit fixed_bytes(const std::array<uint8_t, Size>& arr) : _data(arr) {}
+      explicit fixed_bytes(const uint8_t* bytes) { std::memcpy(_data.data(), bytes, Size); }
+
+      static constexpr size_t size() { return Size; }
+
+      const uint8_t* data() const { return _data.data(); }
+      uint8_t* data() { return _data.data(); }
+
+      std::array<uint8_t, Size> extract_as_byte_array() const { return _data; }
+
+      std::string to_hex() const {
+         static const char* digits = "0123456789abcdef";
+         std::string out;
+         out.reserve(Size * 2);
+         for (auto b : _data) {
+            out.push_back(digits[b >> 4]);
+            out.push_back(digits[b & 0xf]);
+         }
+         return out;
+      }
+
+      friend bool operator==(const fixed_bytes& a, const fixed_bytes& b) { return a._data == b._data; }
+      friend bool operator!=(const fixed_bytes& a, const fixed_bytes& b) { return a._data != b._data; }
+      friend bool operator<(const fixed_bytes& a, const fixed_bytes& b) { return a._data < b._data; }
+      friend bool operator<=(const fixed_bytes& a, const fixed_bytes& b) { return a._data <= b._data; }
+      friend bool operator>(const fixed_bytes& a, const fixed_bytes& b) { return a._data > b._data; }
+      friend bool operator>=(const fixed_bytes& a, const fixed_bytes& b) { return a._data >= b._data; }
+
+    private:
+      std::array<uint8_t, Size> _data;
+   };
+
+   using checksum160 = fixed_bytes<20>;
+   using checksum256 = fixed_bytes<32>;
+   using checksum512 = fixed_bytes<64>;
+
+} // namespace eosio
@@ -0,0 +1,520 @@
+#pragma once
+
+#include "check.hpp"
+#include "datastream.hpp"
+#include "name.hpp"
+
+#include <sim/chain.hpp>
+
+#include <iterator>
+#include <map>
+#include <memory>
+#include <tuple>
+#include <type_traits>
+
+namespace eosio {
+
+   constexpr static inline name same_payer{};
+
+   template <name::raw IndexName, typename Extractor>
+   struct indexed_by {
+      enum constants { index_name = static_cast<uint64_t>(IndexName) };
+      typedef Extractor secondary_extractor_type;
+   };
+
+   template <class Class, typename Type, Type (Class::*PtrToMemberFunction)() const>
+   struct const_mem_fun {
+      typedef typename std::remove_reference<Type>::type result_type;
+      result_type operator()(const Class& x) const { return (x.*PtrToMemberFunction)(); }
+   };
+
+   namespace _multi_index_detail {
+      template <typename K>
+      sim::secondary_key to_key(const K& k) {
+         if constexpr (std::is_same_v<K, uint64_t> || std::is_same_v<K, unsigned __int128> ||
+                       std::is_same_v<K, double> || std::is_same_v<K, long double> ||
+                       std::is_same_v<K, checksum256>)
+            return sim::secondary_key(k);
+         else
+            static_assert(sizeof(K) == 0, "unsupported secondary key type");
+      }
+
+      inline int64_t key_bytes(const sim::secondary_key& k) {
+         switch (k.index()) {
+            case 0: return 8;
+            case 1: return 16;
+            case 2: return 8;
+            case 3: return 16;
+            default: return 32;
+         }
+      }
+
+      template <typename Name, typename... Indices>
+      struct index_number;
+      template <uint64_t Name, typename First, typename... Rest>
+      struct index_number<std::integral_constant<uint64_t, Name>, First, Rest...> {
+         static constexpr size_t value =
+             uint64_t(First::index_name) == Name
+                 ? 0
+                 : 1 + index_number<std::integral_constant<uint64_t, Name>, Rest...>::value;
+      };
+      template <uint64_t Name>
+      struct index_number<std::integral_constant<uint64_t, Name>> {
+         static constexpr size_t value = 0;
+      };
+   } // namespace _multi_index_detail
+
+   // In-memory multi_index with the CDT interface. Rows live packed in the
+   // simulated chain; each instance keeps its own cache of unpacked objects,
+   // so objects obtained from one instance cannot be modified or erased
+   // through another, exactly as on chain.
+   template <name::raw TableName, typename T, typename... Indices>
+   class multi_index {
+    public:
+      static constexpr size_t index_count = sizeof...(Indices);
+      using indices_type = std::tuple<Indices...>;
+
+      multi_index(name code, uint64_t scope)
+          : _code(code), _scope(scope), _store(&sim::chain::get().store(code, scope, name(TableName))) {
+         if (_store->secondaries.size() < index_count) _store->secondaries.resize(index_count);
+      }
+
+      multi_index(const multi_index&) = delete;
+      multi_index& operator=(const multi_index&) = delete;
+      multi_index(multi_index&&) = default;
+      multi_index& operator=(multi_index&&) = default;
+
+      name get_code() const { return _code; }
+      uint64_t get_scope() const { return _scope; }
+
+      struct const_iterator {
+         using iterator_category = std::bidirectional_iterator_tag;
+         using value_type        = const T;
+         using difference_type   = std::ptrdiff_t;
+         using pointer           = const T*;
+         using reference         = const T&;
+
+         const_iterator() = default;
+         const_iterator(const multi_index* m, const T* i) : _multidx(m), _item(i) {}
+
+         const T& operator*() const { return *_item; }
+         const T* operator->() const { return _item; }
+
+         const_iterator& operator++() {
+            check(_item != nullptr, "cannot increment end iterator");
+            _item = _multidx->next_of(_item->primary_key());
+            return *this;
+         }
+         const_iterator operator++(int) {
+            auto r = *this;
+            ++(*this);
+            return r;
+         }
+         const_iterator& operator--() {
+            _item = _multidx->prev_of(_item);
+            return *this;
+         }
+         const_iterator operator--(int) {
+            auto r = *this;
+            --(*this);
+            return r;
+         }
+
+         friend bool operator==(const const_iterator& a, const const_iterator& b) { return a._item == b._item; }
+         friend bool operator!=(const const_iterator& a, const const_iterator& b) { return a._item != b._item; }
+
+       private:
+         friend class multi_index;
+         const multi_index* _multidx = nullptr;
+         const T*           _item    = nullptr;
+      };
+      using const_reverse_iterator = std::reverse_iterator<const_iterator>;
+
+      template <size_t I, typename IndexDef>
+      class index {
+       public:
+         using extractor_type     = typename IndexDef::secondary_extractor_type;
+         using secondary_key_type = std::decay_t<decltype(extractor_type()(std::declval<const T&>()))>;
+
+         static constexpr uint64_t index_name = uint64_t(IndexDef::index_name);
+
+         struct const_iterator {
+            using iterator_category = std::bidirectional_iterator_tag;
+            using value_type        = const T;
+            using difference_type   = std::ptrdiff_t;
+            using pointer           = const T*;
+            using reference         = const T&;
+
+            const_iterator() = default;
+            const_iterator(const multi_index* m, const T* i) : _multidx(m), _item(i) {}
+
+            const T& operator*() const { return *_item; }
+            const T* operator->() const { return _item; }
+
+            const_iterator& operator++() {
+               check(_item != nullptr, "cannot increment end iterator");
+               auto& set = _multidx->_store->secondaries[I];
+               auto  pk  = _item->primary_key();
+               auto  itr = set.upper_bound({_multidx->stored_key(pk, I), pk});
+               sim::chain::get().count_read(eosio::name(TableName), 0);
+               _item = itr == set.end() ? nullptr : _multidx->load(itr->second);
+               return *this;
+            }
+            const_iterator operator++(int) {
+               auto r = *this;
+               ++(*this);
+               return r;
+            }
+            const_iterator& operator--() {
+               auto& set = _multidx->_store->secondaries[I];
+               typename std::decay_t<decltype(set)>::const_iterator itr;
+               if (_item == nullptr) {
+                  itr = set.end();
+               } else {
+                  auto pk = _item->primary_key();
+                  itr     = set.lower_bound({_multidx->stored_key(pk, I), pk});
+               }
+               check(itr != set.begin(), "cannot decrement iterator at beginning of index");
+               --itr;
+               sim::chain::get().count_read(eosio::name(TableName), 0);
+               _item = _multidx->load(itr->second);
+               return *this;
+            }
+            const_iterator operator--(int) {
+               auto r = *this;
+               --(*this);
+               return r;
+            }
+
+            friend bool operator==(const const_iterator& a, const const_iterator& b) { return a._item == b._item; }
+            friend bool operator!=(const const_iterator& a, const const_iterator& b) { return a._item != b._item; }
+
+          private:
+            friend class index;
+            const multi_index* _multidx = nullptr;
+            const T*           _item    = nullptr;
+         };
+         using const_reverse_iterator = std::reverse_iterator<const_iterator>;
+
+         explicit index(const multi_index* m) : _multidx(m) {}
+
+         constexpr static eosio::name name() { return eosio::name(index_name); }
+         constexpr static uint64_t number() { return I; }
+
+         const_iterator begin() const { return at(set().begin()); }
+         const_iterator cbegin() const { return begin(); }
+         const_iterator end() const { return const_iterator(_multidx, nullptr); }
+         const_iterator cend() const { return end(); }
+         const_reverse_iterator rbegin() const { return std::make_reverse_iterator(end()); }
+         const_reverse_iterator rend() const { return std::make_reverse_iterator(begin()); }
+
+         const_iterator lower_bound(const secondary_key_type& k) const {
+            return at(set().lower_bound({_multi_index_detail::to_key(k), 0}));
+         }
+
+         const_iterator upper_bound(const secondary_key_type& k) const {
+            return at(set().upper_bound({_multi_index_detail::to_key(k), std::numeric_limits<uint64_t>::max()}));
+         }
+
+         const_iterator find(const secondary_key_type& k) const {
+            auto lb = lower_bound(k);
+            if (lb != end() && extractor_type()(*lb) != k) return end();
+            return lb;
+         }
+
+         const_iterator require_find(const secondary_key_type& k, const char* error_msg = "unable to find secondary key") const {
+            auto itr = find(k);
+            check(itr != end(), error_msg);
+            return itr;
+         }
+
+         const T& get(const secondary_key_type& k, const char* error_msg = "unable to find secondary key") const {
+            return *require_find(k, error_msg);
+         }
+
+         const_iterator iterator_to(const T& obj) const {
+            _multidx->require_cached(obj, "object passed to iterator_to is not in multi_index");
+            return const_iterator(_multidx, &obj);
+         }
+
+         template <typename Lambda>
+         void modify(const_iterator itr, eosio::name payer, Lambda&& updater) {
+            check(itr != end(), "cannot pass end iterator to modify");
+            const_cast<multi_index*>(_multidx)->modify(*itr, payer, std::forward<Lambda>(updater));
+         }
+
+         const_iterator erase(const_iterator itr) {
+            check(itr != end(), "cannot pass end iterator to erase");
+            const auto& obj = *itr;
+            ++itr;
+            const_cast<multi_index*>(_multidx)->erase(obj);
+            return itr;
+         }
+
+         static auto extract_secondary_key(const T& obj) { return extractor_type()(obj); }
+
+       private:
+         const std::set<std::pair<sim::secondary_key, uint64_t>>& set() const { return _multidx->_store->secondaries[I]; }
+
+         const_iterator at(typename std::set<std::pair<sim::secondary_key, uint64_t>>::const_iterator itr) const {
+            sim::chain::get().count_read(eosio::name(TableName), 0);
+            if (itr == set().end()) return end();
+            return const_iterator(_multidx, _multidx->load(itr->second));
+         }
+
+         const multi_index* _multidx;
+      };
+
+      const_iterator begin() const { return at(_store->rows.begin()); }
+      const_iterator cbegin() const { return begin(); }
+      const_iterator end() const { return const_iterator(this, nullptr); }
+      const_iterator cend() const { return end(); }
+      const_reverse_iterator rbegin() const { return std::make_reverse_iterator(end()); }
+      const_reverse_iterator rend() const { return std::make_reverse_iterator(begin()); }
+
+      const_iterator lower_bound(uint64_t primary) const { return at(_store->rows.lower_bound(primary)); }
+      const_iterator upper_bound(uint64_t primary) const { return at(_store->rows.upper_bound(primary)); }
+
+      const_iterator find(uint64_t primary) const { return at(_store->rows.find(primary)); }
+
+      const_iterator require_find(uint64_t primary, const char* error_msg = "unable to find key") const {
+         auto itr = find(primary);
+         check(itr != end(), error_msg);
+         return itr;
+      }
+
+      const T& get(uint64_t primary, const char* error_msg = "unable to find key") const {
+         return *require_find(primary, error_msg);
+      }
+
+      const_iterator iterator_to(const T& obj) const {
+         require_cached(obj, "object passed to iterator_to is not in multi_index");
+         return const_iterator(this, &obj);
+      }
+
+      uint64_t available_primary_key() const {
+         if (_next_primary_key == unset_next_primary_key) {
+            sim::chain::get().count_read(name(TableName), 0);
+            _next_primary_key = _store->rows.empty() ? 0 : std::prev(_store->rows.end())->first + 1;
+         }
+         check(_next_primary_key < no_available_primary_key,
+               "next primary key in table is at autoincrement limit");
+         return _next_primary_key;
+      }
+
+      template <name::raw IndexName>
+      auto get_index() const {
+         constexpr size_t I =
+             _multi_index_detail::index_number<std::integral_constant<uint64_t, uint64_t(IndexName)>, Indices...>::value;
+         static_assert(I < sizeof...(Indices), "name provided is not the name of any secondary index within multi_index");
+         return index<I, std::tuple_element_t<I, indices_type>>(this);
+      }
+
+      template <typename Lambda>
+      const_iterator emplace(name payer, Lambda&& constructor) {
+         check(payer != name(), "must specify a valid account to pay for new record");
+
+         auto obj = std::make_unique<T>();
+         constructor(*obj);
+         auto pk = obj->primary_key();
+         check(_store->rows.count(pk) == 0, "could not insert object, most likely a uniqueness constraint was violated");
+
+         sim::row_record rec;
+         rec.bytes = pack(*obj);
+         rec.payer = payer;
+         rec.keys  = keys_of(*obj);
+
+         auto& chain = sim::chain::get();
+         if (_store->rows.empty()) {
+            chain.bill(_code, payer, sim::table_overhead_bytes);
+            bill_store(sim::table_overhead_bytes);
+            _store->table_payer = payer;
+         }
+         auto cost = row_cost(rec);
+         chain.bill(_code, payer, cost);
+         bill_store(cost);
+         chain.count_write(name(TableName), sim::write_emplace, rec.bytes.size());
+
+         for (size_t i = 0; i < rec.keys.size(); ++i) _store->secondaries[i].insert({rec.keys[i], pk});
+         _store->rows.emplace(pk, std::move(rec));
+
+         auto* store = _store;
+         chain.push_undo([store, pk]() { remove_row(*store, pk); });
+
+         if (_next_primary_key != unset_next_primary_key && pk >= _next_primary_key)
+            _next_primary_key = pk < no_available_primary_key ? pk + 1 : no_available_primary_key;
+
+         const T* ptr = obj.get();
+         _cache[pk]   = std::move(obj);
+         return const_iterator(this, ptr);
+      }
+
+      template <typename Lambda>
+      void modify(const_iterator itr, name payer, Lambda&& updater) {
+         check(itr != end(), "cannot pass end iterator to modify");
+         modify(*itr, payer, std::forward<Lambda>(updater));
+      }
+
+      template <typename Lambda>
+      void modify(const T& obj, name payer, Lambda&& updater) {
+         require_cached(obj, "object passed to modify is not in multi_index");
+         auto pk = obj.primary_key();
+         auto& mutableobj = const_cast<T&>(obj);
+         updater(mutableobj);
+         check(pk == obj.primary_key(), "updater cannot change primary key when modifying an object");
+
+         auto row = _store->rows.find(pk);
+         check(row != _store->rows.end(), "object passed to modify is no longer in the table");
+
+         auto& chain = sim::chain::get();
+         sim::row_record old = row->second;
+         sim::row_record& rec = row->second;
+         rec.bytes = pack(obj);
+         rec.keys  = keys_of(obj);
+         if (payer != same_payer) rec.payer = payer;
+
+         auto old_cost = row_cost(old);
+         auto new_cost = row_cost(rec);
+         if (rec.payer == old.payer) {
+            chain.bill(_code, rec.payer, new_cost - old_cost);
+         } else {
+            chain.bill(_code, old.payer, -old_cost);
+            chain.bill(_code, rec.payer, new_cost);
+         }
+         bill_store(new_cost - old_cost);
+         chain.count_write(name(TableName), sim::write_modify, rec.bytes.size());
+
+         for (size_t i = 0; i < rec.keys.size(); ++i) {
+            if (!(old.keys[i] == rec.keys[i])) {
+               _store->secondaries[i].erase({old.keys[i], pk});
+               _store->secondaries[i].insert({rec.keys[i], pk});
+            }
+         }
+
+         auto* store = _store;
+         chain.push_undo([store, pk, old, new_cost, old_cost]() {
+            auto& r = store->rows.at(pk);
+            for (size_t i = 0; i < r.keys.size(); ++i) {
+               store->secondaries[i].erase({r.keys[i], pk});
+               store->secondaries[i].insert({old.keys[i], pk});
+            }
+            r = old;
+            store->billed_bytes -= new_cost - old_cost;
+         });
+      }
+
+      const_iterator erase(const_iterator itr) {
+         check(itr != end(), "cannot pass end iterator to erase");
+         const auto& obj = *itr;
+         ++itr;
+         erase(obj);
+         return itr;
+      }
+
+      void erase(const T& obj) {
+         require_cached(obj, "object passed to erase is not in multi_index");
+         auto pk  = obj.primary_key();
+         auto row = _store->rows.find(pk);
+         check(row != _store->rows.end(), "object passed to erase is no longer in the table");
+
+         auto& chain = sim::chain::get();
+         sim::row_record old = row->second;
+         auto cost = row_cost(old);
+         chain.bill(_code, old.payer, -cost);
+         bill_store(-cost);
+         chain.count_write(name(TableName), sim::write_erase, 0);
+
+         for (size_t i = 0; i < old.keys.size(); ++i) _store->secondaries[i].erase({old.keys[i], pk});
+         _store->rows.erase(row);
+
+         bool dropped = _store->rows.empty();
+         if (dropped) {
+            chain.bill(_code, _store->table_payer, -sim::table_overhead_bytes);
+            bill_store(-sim::table_overhead_bytes);
+         }
+
+         auto* store = _store;
+         chain.push_undo([store, pk, old, cost, dropped]() {
+            for (size_t i = 0; i < old.keys.size(); ++i) store->secondaries[i].insert({old.keys[i], pk});
+            store->rows.emplace(pk, old);
+            store->billed_bytes += cost + (dropped ? sim::table_overhead_bytes : 0);
+         });
+
+         _cache.erase(pk);
+      }
+
+    private:
+      static constexpr uint64_t unset_next_primary_key   = uint64_t(-2);
+      static constexpr uint64_t no_available_primary_key = uint64_t(-2);
+
+      void bill_store(int64_t delta) { _store->billed_bytes += delta; }
+
+      static void remove_row(sim::table_store& store, uint64_t pk) {
+         auto row = store.rows.find(pk);
+         if (row == store.rows.end()) return;
+         auto cost = row_cost(row->second);
+         for (size_t i = 0; i < row->second.keys.size(); ++i) store.secondaries[i].erase({row->second.keys[i], pk});
+         store.rows.erase(row);
+         store.billed_bytes -= cost + (store.rows.empty() ? sim::table_overhead_bytes : 0);
+      }
+
+      static int64_t row_cost(const sim::row_record& rec) {
+         int64_t cost = sim::row_overhead_bytes + int64_t(rec.bytes.size());
+         for (const auto& k : rec.keys) cost += sim::secondary_overhead_bytes + _multi_index_detail::key_bytes(k);
+         return cost;
+      }
+
+      static std::vector<sim::secondary_key> keys_of(const T& obj) {
+         std::vector<sim::secondary_key> keys;
+         keys.reserve(sizeof...(Indices));
+         (keys.push_back(_multi_index_detail::to_key(typename Indices::secondary_extractor_type()(obj))), ...);
+         return keys;
+      }
+
+      const sim::secondary_key& stored_key(uint64_t pk, size_t i) const { return _store->rows.at(pk).keys[i]; }
+
+      void require_cached(const T& obj, const char* msg) const {
+         auto itr = _cache.find(obj.primary_key());
+         check(itr != _cache.end() && itr->second.get() == &obj, msg);
+      }
+
+      // Unpacked object for a stored row, reusing this instance's cache.
+      const T* load(uint64_t pk) const {
+         auto cached = _cache.find(pk);
+         if (cached != _cache.end()) return cached->second.get();
+         const auto& rec = _store->rows.at(pk);
+         sim::chain::get().count_read(name(TableName), rec.bytes.size());
+         auto obj = std::make_unique<T>(unpack<T>(rec.bytes));
+         const T* ptr = obj.get();
+         _cache.emplace(pk, std::move(obj));
+         return ptr;
+      }
+
+      const_iterator at(std::map<uint64_t, sim::row_record>::const_iterator itr) const {
+         sim::chain::get().count_read(name(TableName), 0);
+         if (itr == _store->rows.end()) return end();
+         return const_iterator(this, load(itr->first));
+      }
+
+      const T* next_of(uint64_t pk) const {
+         auto itr = _store->rows.upper_bound(pk);
+         sim::chain::get().count_read(name(TableName), 0);
+         return itr == _store->rows.end() ? nullptr : load(itr->first);
+      }
+
+      const T* prev_of(const T* item) const {
+         auto itr = item == nullptr ? _store->rows.end() : _store->rows.lower_bound(item->primary_key());
+         check(itr != _store->rows.begin(), "cannot decrement iterator at beginning of table");
+         --itr;
+         sim::chain::get().count_read(name(TableName), 0);
+         return load(itr->first);
+      }
+
+      name                                          _code;
+      uint64_t                                      _scope;
+      sim::table_store*                             _store;
+      mutable std::map<uint64_t, std::unique_ptr<T>> _cache;
+      mutable uint64_t                              _next_primary_key = unset_next_primary_key;
+   };
+
+} // namespace eosio
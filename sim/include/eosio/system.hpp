@@ -0,0 +1,48 @@
+#pragma once
+
+#include "check.hpp"
+#include "name.hpp"
+#include "time.hpp"
+
+#include <sim/chain.hpp>
+
+namespace eosio {
+
+   struct permission_level {
+      permission_level(name a, name p) : actor(a), permission(p) {}
+      permission_level() {}
+
+      name actor;
+      name permission;
+
+      friend bool operator==(const permission_level& a, const permission_level& b) {
+         return a.actor == b.actor && a.permission == b.permission;
+      }
+   };
+
+   inline void require_auth(name n) {
+      check(sim::chain::get().has_auth(n), "missing authority of " + n.to_string());
+   }
+
+   inline void require_auth(const permission_level& level) { require_auth(level.actor); }
+
+   inline bool has_auth(name n) { return sim::chain::get().has_auth(n); }
+
+   inline bool is_account(name n) { return sim::chain::get().is_account(n); }
+
+   inline void require_recipient(name) {}
+
+   template <typename... Names>
+   void require_recipient(name n, Names... rest) {
+      require_recipient(n);
+      require_recipient(rest...);
+   }
+
+   inline time_point current_time_point() { return sim::chain::get().now(); }
+
+   inline time_point_sec current_time_point_sec() { return time_point_sec(current_time_point()); }
+
+   template <typename... Args>
+   void print(Args&&...) {}
+
+} // namespace eosio
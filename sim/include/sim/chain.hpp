@@ -0,0 +1,174 @@
+#pragma once
+
+#include <eosio/check.hpp>
+#include <eosio/fixed_bytes.hpp>
+#include <eosio/name.hpp>
+#include <eosio/time.hpp>
+
+#include <cstdint>
+#include <functional>
+#include <map>
+#include <memory>
+#include <set>
+#include <string>
+#include <tuple>
+#include <variant>
+#include <vector>
+
+namespace sim {
+
+   // Secondary keys of every supported index type, kept in one ordered
+   // representation so a table can be stored without knowing its row type.
+   using secondary_key = std::variant<uint64_t, unsigned __int128, double, long double, eosio::checksum256>;
+
+   // RAM billing constants of the reference chain (billable_size<> of the
+   // chainbase objects backing contract tables).
+   constexpr int64_t table_overhead_bytes = 108;
+   constexpr int64_t row_overhead_bytes   = 108;
+   constexpr int64_t secondary_overhead_bytes = 24 + 96;
+
+   struct row_record {
+      std::vector<char>          bytes;
+      eosio::name                payer;
+      std::vector<secondary_key> keys;
+   };
+
+   struct table_store {
+      eosio::name code;
+      uint64_t    scope = 0;
+      eosio::name table;
+
+      std::map<uint64_t, row_record>                               rows;
+      std::vector<std::set<std::pair<secondary_key, uint64_t>>>     secondaries;
+
+      eosio::name table_payer;
+      int64_t     billed_bytes = 0;
+   };
+
+   struct db_counters {
+      uint64_t reads   = 0;
+      uint64_t emplaces = 0;
+      uint64_t modifies = 0;
+      uint64_t erases  = 0;
+      uint64_t bytes_read    = 0;
+      uint64_t bytes_written = 0;
+
+      uint64_t writes() const { return emplaces + modifies + erases; }
+
+      db_counters& operator+=(const db_counters& o) {
+         reads += o.reads;
+         emplaces += o.emplaces;
+         modifies += o.modifies;
+         erases += o.erases;
+         bytes_read += o.bytes_read;
+         bytes_written += o.bytes_written;
+         return *this;
+      }
+      friend db_counters operator-(db_counters a, const db_counters& b) {
+         a.reads -= b.reads;
+         a.emplaces -= b.emplaces;
+         a.modifies -= b.modifies;
+         a.erases -= b.erases;
+         a.bytes_read -= b.bytes_read;
+         a.bytes_written -= b.bytes_written;
+         return a;
+      }
+   };
+
+   struct inline_action {
+      eosio::name              account;
+      eosio::name              action;
+      std::vector<eosio::name> authorization;
+      std::vector<char>        data;
+   };
+
+   // Process-wide state of the simulated chain: tables, clock, the
+   // authorities of the action being applied, and the accounting the
+   // workload driver reports on.
+   class chain {
+    public:
+      static chain& get();
+
+      table_store& store(eosio::name code, uint64_t scope, eosio::name table);
+      table_store* find_store(eosio::name code, uint64_t scope, eosio::name table);
+
+      // database accounting
+      void count_read(eosio::name table, size_t bytes);
+      void count_write(eosio::name table, int kind, size_t bytes);
+      // code is the contract whose table changed, see check_ram_auths
+      void bill(eosio::name code, eosio::name payer, int64_t delta);
+
+      // apply fn() as one action: writes are rolled back if it throws
+      template <typename F>
+      bool apply(std::vector<eosio::name> auths, F&& fn, std::string* error = nullptr) {
+         begin_action(std::move(auths));
+         try {
+            fn();
+            check_ram_auths();
+         } catch (const eosio::eosio_assert_exception& e) {
+            rollback();
+            if (error) *error = e.what();
+            return false;
+         }
+         commit();
+         return true;
+      }
+
+      void push_undo(std::function<void()> fn);
+
+      // authorization
+      bool has_auth(eosio::name n) const { return _auths.count(n.value) > 0; }
+      bool is_account(eosio::name n) const { return _all_accounts || _accounts.count(n.value) > 0; }
+      void create_account(eosio::name n) { _accounts.insert(n.value); }
+      void set_all_accounts_exist(bool v) { _all_accounts = v; }
+
+      // clock
+      eosio::time_point now() const { return _now; }
+      void set_now(eosio::time_point t) { _now = t; }
+      void advance(eosio::microseconds d) { _now = _now + d; }
+
+      // inline actions sent by the contract during the current action
+      void send_inline(inline_action act) { _inline.push_back(std::move(act)); }
+      const std::vector<inline_action>& inline_actions() const { return _inline; }
+
+      void set_action_return(std::vector<char> data) { _return_value = std::move(data); }
+      const std::vector<char>& action_return() const { return _return_value; }
+
+      const db_counters& totals() const { return _totals; }
+      const std::map<uint64_t, db_counters>& per_table() const { return _per_table; }
+      const std::map<uint64_t, int64_t>& ram_by_payer() const { return _ram; }
+      const std::map<std::tuple<uint64_t, uint64_t, uint64_t>, std::unique_ptr<table_store>>& tables() const {
+         return _tables;
+      }
+
+      // rows and billed bytes of every scope of a table
+      std::pair<uint64_t, int64_t> table_usage(eosio::name table) const;
+
+      void reset();
+
+    private:
+      void begin_action(std::vector<eosio::name> auths);
+      // The RAM rule of the reference chain: a contract may only grow the RAM of another
+      // account that authorized the action, counted on the net change of the whole action
+      void check_ram_auths() const;
+      void rollback();
+      void commit();
+
+      std::map<std::tuple<uint64_t, uint64_t, uint64_t>, std::unique_ptr<table_store>> _tables;
+      std::set<uint64_t>                     _auths;
+      std::set<uint64_t>                     _accounts;
+      bool                                   _all_accounts = true;
+      eosio::time_point                      _now;
+      std::vector<std::function<void()>>     _undo;
+      std::vector<inline_action>             _inline;
+      std::vector<char>                      _return_value;
+      db_counters                            _totals;
+      std::map<uint64_t, db_counters>        _per_table;
+      std::map<uint64_t, int64_t>            _ram;
+      // net RAM change of the current action per payer, billed by a contract other than the payer
+      std::map<uint64_t, int64_t>            _action_ram;
+   };
+
+   enum write_kind { write_emplace = 0, write_modify = 1, write_erase = 2 };
+
+} // namespace sim
@@ -0,0 +1,110 @@
+#include <sim/chain.hpp>
+
+namespace sim {
+
+   chain& chain::get() {
+      static chain instance;
+      return instance;
+   }
+
+   table_store& chain::store(eosio::name code, uint64_t scope, eosio::name table) {
+      auto key = std::make_tuple(code.value, scope, table.value);
+      auto itr = _tables.find(key);
+      if (itr == _tables.end()) {
+         auto s   = std::make_unique<table_store>();
+         s->code  = code;
+         s->scope = scope;
+         s->table = table;
+         itr      = _tables.emplace(key, std::move(s)).first;
+      }
+      return *itr->second;
+   }
+
+   table_store* chain::find_store(eosio::name code, uint64_t scope, eosio::name table) {
+      auto itr = _tables.find(std::make_tuple(code.value, scope, table.value));
+      return itr == _tables.end() ? nullptr : itr->second.get();
+   }
+
+   void chain::count_read(eosio::name table, size_t bytes) {
+      auto& t = _per_table[table.value];
+      ++t.reads;
+      t.bytes_read += bytes;
+      ++_totals.reads;
+      _totals.bytes_read += bytes;
+   }
+
+   void chain::count_write(eosio::name table, int kind, size_t bytes) {
+      auto& t = _per_table[table.value];
+      switch (kind) {
+         case write_emplace: ++t.emplaces; ++_totals.emplaces; break;
+         case write_modify:  ++t.modifies; ++_totals.modifies; break;
+         default:            ++t.erases;   ++_totals.erases;   break;
+      }
+      t.bytes_written += bytes;
+      _totals.bytes_written += bytes;
+   }
+
+   void chain::bill(eosio::name code, eosio::name payer, int64_t delta) {
+      if (delta == 0) return;
+      _ram[payer.value] += delta;
+      if (payer != code) _action_ram[payer.value] += delta;
+      push_undo([this, payer, delta]() { _ram[payer.value] -= delta; });
+   }
+
+   void chain::check_ram_auths() const {
+      for (const auto& [payer, delta] : _action_ram) {
+         if (delta <= 0 || _auths.count(payer) > 0) continue;
+         eosio::check(false, "unprivileged contract cannot increase RAM usage of another account that has not authorized the action: " +
+                                eosio::name(payer).to_string());
+      }
+   }
+
+   void chain::push_undo(std::function<void()> fn) { _undo.push_back(std::move(fn)); }
+
+   std::pair<uint64_t, int64_t> chain::table_usage(eosio::name table) const {
+      uint64_t rows  = 0;
+      int64_t  bytes = 0;
+      for (const auto& [key, s] : _tables) {
+         if (std::get<2>(key) != table.value) continue;
+         rows += s->rows.size();
+         bytes += s->billed_bytes;
+      }
+      return {rows, bytes};
+   }
+
+   void chain::begin_action(std::vector<eosio::name> auths) {
+      _auths.clear();
+      for (auto a : auths) _auths.insert(a.value);
+      _undo.clear();
+      _inline.clear();
+      _return_value.clear();
+      _action_ram.clear();
+   }
+
+   void chain::rollback() {
+      for (auto itr = _undo.rbegin(); itr != _undo.rend(); ++itr) (*itr)();
+      _undo.clear();
+      _inline.clear();
+      _auths.clear();
+   }
+
+   void chain::commit() {
+      _undo.clear();
+      _auths.clear();
+   }
+
+   void chain::reset() {
+      _tables.clear();
+      _auths.clear();
+      _accounts.clear();
+      _undo.clear();
+      _inline.clear();
+      _return_value.clear();
+      _totals = {};
+      _per_table.clear();
+      _ram.clear();
+      _action_ram.clear();
+      _now = eosio::time_point();
+   }
+
+} // namespace sim
@@ -0,0 +1,65 @@
+// Airdrops: issuemany mints one block per recipient from a single id
+// reservation and transfermany hands out nfts to many recipients at once. A
+// recipient named twice is served once with the sum, and one bad entry aborts
+// the whole drop.
+
+#include "test.hpp"
+
+using namespace sim_test;
+
+namespace {
+
+   uint64_t next_id() {
+      nfts::config_index config( self, self.value );
+      return config.get().next_nft_id.value_or( 0 );
+   }
+
+   int64_t supply() {
+      nfts::stat_index stats( self, event );
+      return stats.get( ticket.value ).current_supply.amount;
+   }
+
+   bool transfermany(uint64_t from, vector<pair<uint64_t, vector<uint64_t>>> recipients) {
+      return apply( { issuer }, [&]( nfts& c ){ c.transfermany( from, recipients, "" ); } );
+   }
+
+}
+
+int main() {
+   setup( 4 );
+
+   // user 2 is named twice and gets one block of three, ids follow the sorted recipients
+   CHECK( apply( { issuer }, [&]( nfts& c ){ c.issuemany( event, ticket, { { 3, 1 }, { 2, 2 }, { 1, 2 }, { 2, 1 } }, "", "" ); } ) );
+   CHECK( next_id() == 6 && supply() == 6 );
+   CHECK( balance( 1 ) == 2 && balance( 2 ) == 3 && balance( 3 ) == 1 );
+   CHECK( owner_of( 0 ) == 1 && owner_of( 1 ) == 1 );
+   CHECK( owner_of( 2 ) == 2 && owner_of( 4 ) == 2 && owner_of( 5 ) == 3 );
+   CHECK( find_nft( 2 )->serial_number == 3 && find_nft( 5 )->serial_number == 6 );
+
+   // an unknown recipient or a zero count stops the drop before anything is minted
+   CHECK( !apply( { issuer }, [&]( nfts& c ){ c.issuemany( event, ticket, { { 1, 1 }, { 9, 1 } }, "", "" ); } ) );
+   CHECK( error == "User with this id doesn't exist" );
+   CHECK( !apply( { issuer }, [&]( nfts& c ){ c.issuemany( event, ticket, { { 1, 1 }, { 2, 0 } }, "", "" ); } ) );
+   CHECK( error == "Amount must be >=1" );
+   CHECK( !apply( { issuer }, [&]( nfts& c ){ c.issuemany( event, ticket, {}, "", "" ); } ) );
+   CHECK( error == "No recipients given" );
+   CHECK( !apply( { caller }, [&]( nfts& c ){ c.issuemany( event, ticket, { { 1, 1 } }, "", "" ); } ) );
+   CHECK( error == "missing authority of issuer" );
+   CHECK( next_id() == 6 && supply() == 6 && balance( 1 ) == 2 );
+
+   // transfermany: user 4 is named twice, the sender's balance drops once by the total
+   CHECK( transfermany( 2, { { 4, { 2 } }, { 1, { 3 } }, { 4, { 4 } } } ) );
+   CHECK( owner_of( 2 ) == 4 && owner_of( 3 ) == 1 && owner_of( 4 ) == 4 );
+   CHECK( balance( 2 ) == 0 && balance( 4 ) == 2 && balance( 1 ) == 3 );
+
+   // an nft the sender does not own, or the sender among the recipients, leaves every nft where it was
+   CHECK( !transfermany( 1, { { 2, { 0 } }, { 3, { 5 } } } ) );
+   CHECK( error == "Must be the owner" );
+   CHECK( !transfermany( 1, { { 2, { 0 } }, { 1, { 1 } } } ) );
+   CHECK( error == "Cannot transfer NFT to self" );
+   CHECK( !transfermany( 1, { { 2, { 0 } }, { 7, { 1 } } } ) );
+   CHECK( error == "User 'to' with this id doesn't exist" );
+   CHECK( owner_of( 0 ) == 1 && owner_of( 1 ) == 1 && balance( 1 ) == 3 && balance( 2 ) == 0 );
+
+   return report();
+}
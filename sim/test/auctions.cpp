@@ -0,0 +1,133 @@
+// Auctions: bids are held from the bidder's funds and handed back when outbid
+// or closed, an ended auction is settled by finalize or by the settleauctns
+// crank in expiration order, and neither of them may be stopped by an auction
+// whose category is gone.
+
+#include "test.hpp"
+
+using namespace sim_test;
+
+namespace {
+
+   bool auction(uint64_t nft_id, int64_t target, uint32_t seconds) {
+      const auto expiration = time_point_sec( current_time_point() ) + seconds;
+      return apply( { self }, [&]( nfts& c ){ c.createauctn( 1, event, nft_id, asset( target, come ), asset( 10, come ), expiration ); } );
+   }
+
+   bool bid(uint64_t nft_id, uint64_t bidder, int64_t price) {
+      return apply( { self }, [&]( nfts& c ){ c.bid( nft_id, bidder, asset( price, come ) ); } );
+   }
+
+   uint64_t crank(uint64_t max_rows) {
+      uint64_t settled = 0;
+      CHECK( apply( { self }, [&]( nfts& c ){ settled = c.settleauctns( max_rows ); } ) );
+      return settled;
+   }
+
+   bool auctioned(uint64_t nft_id) {
+      nfts::auction_index auctions( self, self.value );
+      return auctions.find( nft_id ) != auctions.end();
+   }
+
+   bool locked(uint64_t nft_id) {
+      return find_nft( nft_id )->flags & nfts::NFT_AUCTIONED;
+   }
+
+}
+
+int main() {
+   setup( 3 );
+   CHECK( apply( { issuer }, [&]( nfts& c ){ c.issue( 1, event, ticket, asset( 10, ctt ), "", "" ); } ) );
+
+   const auto expiration = time_point_sec( current_time_point() ) + 100;
+   CHECK( !apply( { self }, [&]( nfts& c ){ c.createauctn( 1, event, 0, asset( 5000, come ), asset( 0, come ), expiration ); } ) );
+   CHECK( error == "Minimum bid price must be positive" );
+   CHECK( !apply( { self }, [&]( nfts& c ){ c.createauctn( 1, event, 0, asset( 5000, come ), asset( 10, ctt ), expiration ); } ) );
+   CHECK( error == "Only accept COME token for auction" );
+
+   // bids hold funds, an outbid bid is handed back and raises must clear the minimum step
+   CHECK( auction( 0, 5000, 100 ) && locked( 0 ) );
+   CHECK( !auction( 0, 5000, 100 ) );
+   CHECK( error == "NFT locked " );
+   CHECK( bid( 0, 2, 100 ) && funds( 2 ) == deposit - 100 );
+   CHECK( !bid( 0, 3, 105 ) );
+   CHECK( error == "Bid must be greater than the minimum bid price" );
+   CHECK( !bid( 0, 1, 200 ) );
+   CHECK( error == "You cannot bid at your own auction" );
+   CHECK( bid( 0, 3, 200 ) );
+   CHECK( funds( 2 ) == deposit && funds( 3 ) == deposit - 200 );
+
+   // closing hands the bid back and unlocks the nft
+   CHECK( apply( { self }, [&]( nfts& c ){ c.closeauctn( 1, 0 ); } ) );
+   CHECK( funds( 3 ) == deposit && !locked( 0 ) && !auctioned( 0 ) );
+
+   // a bid at the target buys at once, on the contract's authority as every other step of an auction
+   CHECK( auction( 1, 1000, 100 ) && bid( 1, 2, 1000 ) );
+   CHECK( owner_of( 1 ) == 2 && !locked( 1 ) && !auctioned( 1 ) );
+   CHECK( funds( 2 ) == deposit - 1000 && funds( 1 ) == deposit + 900 && royalties() == 100 );
+
+   // while a sale from an ask needs the issuer, also after an auction settled in the same action
+   CHECK( apply( { issuer }, [&]( nfts& c ){ c.listsale( 1, event, ticket, { 9 }, asset( 100, come ) ); } ) );
+   const uint64_t batch_id = *find_nft( 9 )->listed_in;
+   CHECK( auction( 8, 5000, 10 ) && bid( 8, 3, 100 ) );
+   sim::chain::get().advance( seconds( 20 ) );
+   CHECK( !apply( { self }, [&]( nfts& c ){
+      c.settleauctns( 1 );
+      c.buy( 2, batch_id, "", {} );
+   } ) );
+   CHECK( error == "missing authority of issuer" );
+   CHECK( owner_of( 9 ) == 1 && auctioned( 8 ) );
+   CHECK( crank( 1 ) == 1 && owner_of( 8 ) == 3 );
+   CHECK( apply( { issuer }, [&]( nfts& c ){ c.closesale( 1, batch_id ); } ) );
+   CHECK( funds( 3 ) == deposit - 100 );
+
+   // the crank settles ended auctions only, earliest first, and max_rows at a time
+   CHECK( auction( 2, 5000, 300 ) && bid( 2, 2, 500 ) );
+   CHECK( auction( 3, 5000, 100 ) );
+   CHECK( auction( 4, 5000, 200 ) && bid( 4, 3, 400 ) );
+   CHECK( auction( 5, 5000, 10000 ) && bid( 5, 3, 300 ) );
+   CHECK( !apply( { self }, [&]( nfts& c ){ c.finalize( 2, 1 ); } ) );
+   CHECK( error == "You cannot finalize an auction before its expiration" );
+   sim::chain::get().advance( seconds( 1000 ) );
+   CHECK( crank( 1 ) == 1 );
+   CHECK( !auctioned( 3 ) && !locked( 3 ) && owner_of( 3 ) == 1 );
+   CHECK( auctioned( 4 ) && auctioned( 2 ) );
+   CHECK( crank( 10 ) == 2 );
+   CHECK( owner_of( 4 ) == 3 && owner_of( 2 ) == 2 && !locked( 4 ) && !locked( 2 ) );
+   CHECK( funds( 1 ) == deposit + 900 + 90 + 360 + 450 && royalties() == 100 + 10 + 40 + 50 );
+   CHECK( auctioned( 5 ) && crank( 10 ) == 0 );
+
+   // a category with nfts out cannot be deleted, so no auction can lose it
+   CHECK( !apply( { issuer }, [&]( nfts& c ){ c.deletestats( event, ticket ); } ) );
+   CHECK( error == "Cannot delete a category with NFTs in circulation" );
+   CHECK( apply( { issuer }, [&]( nfts& c ){
+      c.createnft( issuer, event, "unused"_n, true, true, true, asset( 1000, come ), 255, 0, "", asset( 10, ctt ) );
+   } ) );
+   CHECK( apply( { issuer }, [&]( nfts& c ){ c.deletestats( event, "unused"_n ); } ) );
+
+   // as a category deleted before that check, with a bid on one of its nfts and an auction behind it
+   CHECK( auction( 6, 5000, 100 ) && bid( 6, 2, 700 ) );
+   CHECK( auction( 7, 5000, 200 ) );
+   const int64_t before = funds( 2 );
+   CHECK( sim::chain::get().apply( { self, issuer }, [&]{
+      nfts::stat_index stats( self, event );
+      nfts::category_index categories( self, self.value );
+      categories.erase( categories.get( category_id() ) );
+      stats.erase( stats.get( ticket.value ) );
+   } ) );
+   sim::chain::get().advance( seconds( 1000 ) );
+
+   // the bid goes back, the nft stays with its seller and the crank goes on to the next auction
+   CHECK( crank( 10 ) == 2 );
+   CHECK( funds( 2 ) == before + 700 && owner_of( 6 ) == 1 && !locked( 6 ) && !auctioned( 6 ) );
+   CHECK( !auctioned( 7 ) && !locked( 7 ) );
+
+   // finalize does the same
+   CHECK( !apply( { self }, [&]( nfts& c ){ c.finalize( 5, 1 ); } ) );
+   CHECK( error == "You cannot finalize an auction before its expiration" );
+   sim::chain::get().advance( seconds( 10000 ) );
+   CHECK( apply( { self }, [&]( nfts& c ){ c.finalize( 5, 1 ); } ) );
+   CHECK( funds( 3 ) == deposit - 100 - 400 && owner_of( 5 ) == 1 && !auctioned( 5 ) );
+
+   return report();
+}
@@ -0,0 +1,75 @@
+// The simulated chain itself: an aborted action leaves no trace, and rows may
+// only grow on an account other than the contract when that account signed,
+// as the RAM rule of the reference chain demands.
+
+#include "test.hpp"
+
+using namespace sim_test;
+
+namespace {
+
+   const name other = "other"_n;
+
+   // a write to the contract's own funds table, outside of any action
+   template<typename F>
+   bool write(std::vector<name> auths, F&& body) {
+      error.clear();
+      return sim::chain::get().apply( std::move( auths ), [&]{
+         nfts::user_funds_index funds_table( self, self.value );
+         body( funds_table );
+      }, &error );
+   }
+
+   int64_t ram(name account) {
+      const auto& ram = sim::chain::get().ram_by_payer();
+      auto itr = ram.find( account.value );
+      return itr == ram.end() ? 0 : itr->second;
+   }
+
+   const std::string not_authorized = "unprivileged contract cannot increase RAM usage of another account that has not authorized the action: ";
+
+}
+
+int main() {
+   // an abort rolls back rows and billing
+   CHECK( !write( { self }, [&]( auto& t ){
+      t.emplace( self, [&]( auto& r ){ r.user = 1; r.balance = asset( 5, come ); } );
+      check( false, "abort" );
+   } ) );
+   CHECK( error == "abort" );
+   CHECK( funds( 1 ) == 0 && ram( self ) == 0 );
+
+   // the contract pays for its own rows without anyone else signing
+   CHECK( write( {}, [&]( auto& t ){ t.emplace( self, [&]( auto& r ){ r.user = 1; r.balance = asset( 5, come ); } ); } ) );
+   CHECK( funds( 1 ) == 5 && ram( self ) > 0 );
+
+   // another account pays only when it signs
+   CHECK( !write( { self }, [&]( auto& t ){ t.emplace( other, [&]( auto& r ){ r.user = 2; r.balance = asset( 7, come ); } ); } ) );
+   CHECK( error == not_authorized + "other" );
+   CHECK( funds( 2 ) == 0 && ram( other ) == 0 );
+   CHECK( write( { other }, [&]( auto& t ){ t.emplace( other, [&]( auto& r ){ r.user = 2; r.balance = asset( 7, come ); } ); } ) );
+   const int64_t row_bytes = ram( other );
+   CHECK( row_bytes > 0 );
+
+   // the rule counts the net change of the action: freeing one row does not pay for two
+   CHECK( !write( { self }, [&]( auto& t ){
+      t.erase( t.get( 2 ) );
+      t.emplace( other, [&]( auto& r ){ r.user = 3; r.balance = asset( 7, come ); } );
+      t.emplace( other, [&]( auto& r ){ r.user = 4; r.balance = asset( 7, come ); } );
+   } ) );
+   CHECK( error == not_authorized + "other" );
+   CHECK( ram( other ) == row_bytes );
+
+   // but it pays for one of the same size
+   CHECK( write( { self }, [&]( auto& t ){
+      t.erase( t.get( 2 ) );
+      t.emplace( other, [&]( auto& r ){ r.user = 3; r.balance = asset( 7, come ); } );
+   } ) );
+   CHECK( funds( 2 ) == 0 && funds( 3 ) == 7 && ram( other ) == row_bytes );
+
+   // and moving a row to the contract frees it without the former payer
+   CHECK( write( {}, [&]( auto& t ){ t.modify( t.get( 3 ), self, [&]( auto& r ){ r.balance = asset( 9, come ); } ); } ) );
+   CHECK( funds( 3 ) == 9 && ram( other ) == 0 );
+
+   return report();
+}
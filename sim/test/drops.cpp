@@ -0,0 +1,134 @@
+// Merkle drops: the tree is built here from the leaf and node layout documented
+// on the drop table, independently of the contract, and every leaf is claimed
+// with its proof; altered proofs, counts and indexes must be rejected.
+
+#include "test.hpp"
+
+using namespace sim_test;
+
+namespace {
+
+   struct leaf {
+      uint64_t to;
+      uint64_t count;
+   };
+
+   void put_u64(std::string& bytes, uint64_t value) {
+      for( int i = 0; i < 8; i++ ) bytes.push_back( char( value >> ( 8 * i ) ) );
+   }
+
+   checksum256 hash_leaf(uint64_t leaf_index, uint64_t to, uint64_t nft_category_id, uint64_t count) {
+      std::string bytes( 1, '\0' );
+      put_u64( bytes, leaf_index );
+      put_u64( bytes, to );
+      put_u64( bytes, nft_category_id );
+      put_u64( bytes, count );
+      return sha256( bytes.data(), bytes.size() );
+   }
+
+   checksum256 hash_node(const checksum256& left, const checksum256& right) {
+      std::string bytes( 1, '\1' );
+      for( const auto& node : { left, right } ) {
+         const auto hash = node.extract_as_byte_array();
+         bytes.append( hash.begin(), hash.end() );
+      }
+      return sha256( bytes.data(), bytes.size() );
+   }
+
+   // levels of the tree, from the leaves up to the root
+   struct tree {
+      vector<vector<checksum256>> levels;
+
+      tree(const vector<leaf>& leaves, uint64_t nft_category_id) {
+         levels.emplace_back();
+         for( uint64_t i = 0; i < leaves.size(); i++ ) {
+            levels[0].push_back( hash_leaf( i, leaves[i].to, nft_category_id, leaves[i].count ) );
+         }
+         while( levels.back().size() > 1 ) {
+            const auto& level = levels.back();
+            vector<checksum256> parents;
+            for( size_t i = 0; i < level.size(); i += 2 ) {
+               parents.push_back( hash_node( level[i], i + 1 < level.size() ? level[i + 1] : level[i] ) );
+            }
+            levels.push_back( parents );
+         }
+      }
+
+      checksum256 root() const { return levels.back()[0]; }
+
+      vector<checksum256> proof(uint64_t leaf_index) const {
+         vector<checksum256> nodes;
+         for( size_t l = 0; l + 1 < levels.size(); l++ ) {
+            const uint64_t sibling = leaf_index ^ 1;
+            nodes.push_back( sibling < levels[l].size() ? levels[l][sibling] : levels[l][leaf_index] );
+            leaf_index >>= 1;
+         }
+         return nodes;
+      }
+   };
+
+   bool claim(uint64_t leaf_index, uint64_t to, uint64_t count, const vector<checksum256>& proof) {
+      return apply( { caller }, [&]( nfts& c ){ c.claim( 7, leaf_index, to, count, proof, caller ); } );
+   }
+
+}
+
+int main() {
+   setup( 3 );
+   const vector<leaf> leaves = { { 1, 2 }, { 2, 1 }, { 3, 3 }, { 1, 1 }, { 2, 2 } };
+   const tree drop( leaves, category_id() );
+
+   CHECK( !apply( { caller }, [&]( nfts& c ){ c.setdrop( event, ticket, 7, drop.root(), leaves.size() ); } ) );
+   CHECK( apply( { issuer }, [&]( nfts& c ){ c.setdrop( event, ticket, 7, drop.root(), leaves.size() ); } ) );
+   CHECK( !apply( { issuer }, [&]( nfts& c ){ c.setdrop( event, ticket, 7, drop.root(), leaves.size() ); } ) );
+   CHECK( error == "Drop with this id already exists" );
+
+   // the payer signs the claim
+   CHECK( !apply( {}, [&]( nfts& c ){ c.claim( 7, 0, 1, 2, drop.proof( 0 ), caller ); } ) );
+
+   // anything else than the leaf as built, with its own proof, is rejected
+   CHECK( !claim( 2, 3, 4, drop.proof( 2 ) ) );
+   CHECK( error == "Invalid proof" );
+   CHECK( !claim( 2, 1, 3, drop.proof( 2 ) ) );
+   CHECK( error == "Invalid proof" );
+   CHECK( !claim( 2, 3, 3, drop.proof( 3 ) ) );
+   CHECK( error == "Invalid proof" );
+   {
+      auto tampered = drop.proof( 2 );
+      auto bytes = tampered[1].extract_as_byte_array();
+      bytes[0] ^= 1;
+      tampered[1] = checksum256( bytes );
+      CHECK( !claim( 2, 3, 3, tampered ) );
+      CHECK( error == "Invalid proof" );
+
+      auto longer = drop.proof( 2 );
+      longer.push_back( drop.root() );
+      CHECK( !claim( 2, 3, 3, longer ) );
+      CHECK( error == "Invalid proof" );
+
+      auto shorter = drop.proof( 2 );
+      shorter.pop_back();
+      CHECK( !claim( 2, 3, 3, shorter ) );
+      CHECK( error == "Invalid proof" );
+   }
+   CHECK( !claim( leaves.size(), 1, 1, drop.proof( 4 ) ) );
+   CHECK( error == "Leaf index is out of the drop" );
+   CHECK( balance( 1 ) == 0 && balance( 2 ) == 0 && balance( 3 ) == 0 );
+
+   // every leaf, the last one paired with itself, then none twice
+   for( uint64_t i = 0; i < leaves.size(); i++ ) {
+      CHECK( claim( i, leaves[i].to, leaves[i].count, drop.proof( i ) ) );
+   }
+   for( uint64_t i = 0; i < leaves.size(); i++ ) {
+      CHECK( !claim( i, leaves[i].to, leaves[i].count, drop.proof( i ) ) );
+      CHECK( error == "Leaf already claimed" );
+   }
+
+   CHECK( balance( 1 ) == 3 && balance( 2 ) == 3 && balance( 3 ) == 3 );
+   nfts::stat_index stats( self, event );
+   CHECK( stats.get( ticket.value ).current_supply == asset( 9, ctt ) );
+   nfts::claim_index claims( self, 7 );
+   CHECK( claims.get( 0 ).bits == 0b11111 );
+
+   return report();
+}
@@ -0,0 +1,84 @@
+// Funds: COME deposited through the configured token contract is credited to
+// the user named in the memo, and refused outright while no token contract is
+// configured. Withdrawals and royalty claims pay out with an inline transfer of
+// that contract.
+
+#include "test.hpp"
+
+#include <tuple>
+
+using namespace sim_test;
+
+namespace {
+
+   bool send(name code, name from, name to, asset quantity, std::string memo) {
+      return apply( { code }, [&]( nfts& c ){ c.deposit( from, to, quantity, memo ); }, code );
+   }
+
+   bool has_funds(uint64_t user) {
+      nfts::user_funds_index funds_table( self, self.value );
+      return funds_table.find( user ) != funds_table.end();
+   }
+
+   // the transfer the last action sent, if it sent one
+   std::optional<std::tuple<name, name, asset, std::string>> payout() {
+      const auto& sent = sim::chain::get().inline_actions();
+      if( sent.size() != 1 ) return std::nullopt;
+      const auto& act = sent[0];
+      if( act.account != token || act.action != "transfer"_n || act.authorization != std::vector<name>{ self } ) return std::nullopt;
+      return unpack<std::tuple<name, name, asset, std::string>>( act.data );
+   }
+
+}
+
+int main() {
+   CHECK( apply( { caller }, [&]( nfts& c ){ c.createacc( 1, checksum256(), caller ); } ) );
+
+   // nothing to credit through before the token contract is known
+   CHECK( !send( token, caller, self, asset( 500, come ), "1" ) );
+   CHECK( error == "Config table does not exist" );
+   CHECK( apply( { self }, [&]( nfts& c ){ c.setconfig( "test", {} ); } ) );
+   CHECK( !send( token, caller, self, asset( 500, come ), "1" ) );
+   CHECK( error == "COME token contract is not configured" );
+   CHECK( funds( 1 ) == 0 );
+
+   CHECK( apply( { self }, [&]( nfts& c ){ c.setconfig( "test", token ); } ) );
+   CHECK( send( token, caller, self, asset( 500, come ), "1" ) && funds( 1 ) == 500 );
+   CHECK( send( token, caller, self, asset( 250, come ), "1" ) && funds( 1 ) == 750 );
+
+   // other tokens and outgoing transfers go through without crediting anyone
+   CHECK( send( "fake.token"_n, caller, self, asset( 500, come ), "1" ) && funds( 1 ) == 750 );
+   CHECK( send( token, self, caller, asset( 500, come ), "1" ) && funds( 1 ) == 750 );
+
+   // while a deposit no user can be credited with is refused
+   CHECK( !send( token, caller, self, asset( 500, symbol( "EOS", 4 ) ), "1" ) );
+   CHECK( error == "Only COME can be deposited" );
+   CHECK( !send( token, caller, self, asset( 500, come ), "user 1" ) );
+   CHECK( error == "Memo must be the id of the user to credit" );
+   CHECK( !send( token, caller, self, asset( 500, come ), "2" ) );
+   CHECK( error == "User with this id doesn't exist" );
+
+   // withdrawals are sent from the contract's funds on its own authority
+   CHECK( !apply( { caller }, [&]( nfts& c ){ c.withdraw( 1, caller, asset( 100, come ), "out" ); } ) );
+   CHECK( error == "missing authority of nfts" );
+   CHECK( !apply( { self }, [&]( nfts& c ){ c.withdraw( 1, caller, asset( 1000, come ), "out" ); } ) );
+   CHECK( error == "Not enough COME deposited for this user" );
+   CHECK( apply( { self }, [&]( nfts& c ){ c.withdraw( 1, caller, asset( 100, come ), "out" ); } ) );
+   CHECK( funds( 1 ) == 650 && payout() == std::make_tuple( self, caller, asset( 100, come ), std::string( "out" ) ) );
+   CHECK( apply( { self }, [&]( nfts& c ){ c.withdraw( 1, caller, asset( 650, come ), "" ); } ) );
+   CHECK( !has_funds( 1 ) );
+
+   // royalties are claimed by their issuer alone
+   CHECK( sim::chain::get().apply( { self }, [&]{
+      nfts::issuer_funds_index royalties_table( self, self.value );
+      royalties_table.emplace( self, [&]( auto& r ){ r.issuer = issuer; r.balance = asset( 300, come ); } );
+   } ) );
+   CHECK( !apply( { self }, [&]( nfts& c ){ c.claimroyalty( issuer, asset( 100, come ) ); } ) );
+   CHECK( error == "missing authority of issuer" );
+   CHECK( !apply( { issuer }, [&]( nfts& c ){ c.claimroyalty( issuer, asset( 400, come ) ); } ) );
+   CHECK( error == "Not enough royalties to claim" );
+   CHECK( apply( { issuer }, [&]( nfts& c ){ c.claimroyalty( issuer, asset( 300, come ) ); } ) );
+   CHECK( royalties() == 0 && payout() == std::make_tuple( self, issuer, asset( 300, come ), std::string( "royalties" ) ) );
+
+   return report();
+}
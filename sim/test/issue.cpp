@@ -0,0 +1,72 @@
+// Issue: a batch takes one block of consecutive ids from the sequence in the
+// config and consecutive serials from its category, supplies and balances move
+// by the whole batch, and a batch over a limit mints nothing at all.
+
+#include "test.hpp"
+
+using namespace sim_test;
+
+namespace {
+
+   const name limited = "limited"_n;
+
+   uint64_t next_id() {
+      nfts::config_index config( self, self.value );
+      return config.get().next_nft_id.value_or( 0 );
+   }
+
+   nfts::nft_stat stats_of(name nft_name) {
+      nfts::stat_index stats( self, event );
+      return stats.get( nft_name.value );
+   }
+
+   vector<nfts::id_range> id_blocks() {
+      nfts::range_index ranges( self, self.value );
+      return vector<nfts::id_range>( ranges.begin(), ranges.end() );
+   }
+
+}
+
+int main() {
+   setup( 3 );
+   CHECK( apply( { issuer }, [&]( nfts& c ){
+      c.createnft( issuer, event, limited, true, true, true, asset( 1000, come ), 3, royalty_bps, "https://example.com/limited", asset( 5, ctt ) );
+   } ) );
+
+   // ids 0-3 for the tickets, serials 1-4
+   CHECK( apply( { issuer }, [&]( nfts& c ){ c.issue( 1, event, ticket, asset( 4, ctt ), "", "" ); } ) );
+   CHECK( next_id() == 4 && balance( 1 ) == 4 );
+   CHECK( stats_of( ticket ).current_supply.amount == 4 && stats_of( ticket ).issued_supply.amount == 4 );
+   CHECK( find_nft( 0 )->serial_number == 1 && find_nft( 3 )->serial_number == 4 );
+
+   // the next category goes on with the ids but starts its own serials, its uri only when it adds to the base
+   CHECK( apply( { issuer }, [&]( nfts& c ){ c.issue( 2, event, limited, asset( 1, ctt ), "https://example.com/limited", "" ); } ) );
+   CHECK( apply( { issuer }, [&]( nfts& c ){ c.issue( 2, event, limited, asset( 1, ctt ), "seat-12", "" ); } ) );
+   CHECK( next_id() == 6 );
+   CHECK( find_nft( 4 )->serial_number == 1 && !find_nft( 4 )->relative_uri.has_value() );
+   CHECK( find_nft( 5 )->serial_number == 2 && find_nft( 5 )->relative_uri == std::optional<string>( "seat-12" ) );
+
+   // the ids of one event stay one block, extended by every issue
+   CHECK( id_blocks().size() == 1 && id_blocks()[0].first_id == 0 && id_blocks()[0].count == 6 );
+
+   // a batch over a limit is refused whole and leaves the sequence where it was
+   CHECK( !apply( { issuer }, [&]( nfts& c ){ c.issue( 2, event, limited, asset( 2, ctt ), "", "" ); } ) );
+   CHECK( error == "Every account is able to buy 3 NFTs" );
+   CHECK( !apply( { issuer }, [&]( nfts& c ){ c.issue( 3, event, limited, asset( 4, ctt ), "", "" ); } ) );
+   CHECK( error == "Every account is able to buy 3 NFTs" );
+   CHECK( apply( { issuer }, [&]( nfts& c ){ c.issue( 3, event, limited, asset( 3, ctt ), "", "" ); } ) );
+   CHECK( !apply( { issuer }, [&]( nfts& c ){ c.issue( 1, event, limited, asset( 1, ctt ), "", "" ); } ) );
+   CHECK( error == "Cannot issue more than max supply" );
+   CHECK( next_id() == 9 && stats_of( limited ).current_supply.amount == 5 );
+
+   // only the issuer mints, in whole CTT
+   CHECK( !apply( { self }, [&]( nfts& c ){ c.issue( 1, event, ticket, asset( 1, ctt ), "", "" ); } ) );
+   CHECK( error == "missing authority of issuer" );
+   CHECK( !apply( { issuer }, [&]( nfts& c ){ c.issue( 1, event, ticket, asset( 0, ctt ), "", "" ); } ) );
+   CHECK( error == "Amount must be >=1" );
+   CHECK( !apply( { issuer }, [&]( nfts& c ){ c.issue( 4, event, ticket, asset( 1, ctt ), "", "" ); } ) );
+   CHECK( error == "User with this id doesn't exist" );
+   CHECK( next_id() == 9 && id_blocks()[0].count == 9 );
+
+   return report();
+}
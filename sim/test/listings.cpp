@@ -0,0 +1,67 @@
+// Listings: a listed nft names its ask in listed_in, which getnftask follows,
+// and loses it when the ask is closed, bought or partially filled for it. No
+// other nft of the ask is rewritten by any of these.
+
+#include "test.hpp"
+
+using namespace sim_test;
+
+namespace {
+
+   std::optional<nfts::ask_item> ask_of(uint64_t nft_id) {
+      std::optional<nfts::ask_item> item;
+      CHECK( apply( {}, [&]( nfts& c ){ item = c.getnftask( nft_id ); } ) );
+      return item;
+   }
+
+   uint64_t list(vector<uint64_t> nft_ids, int64_t price) {
+      CHECK( apply( { issuer }, [&]( nfts& c ){ c.listsale( 1, event, ticket, nft_ids, asset( price, come ) ); } ) );
+      return *find_nft( nft_ids[0] )->listed_in;
+   }
+
+   uint64_t nft_writes() {
+      const auto& tables = sim::chain::get().per_table();
+      auto itr = tables.find( "nftsv2"_n.value );
+      return itr == tables.end() ? 0 : itr->second.writes();
+   }
+
+}
+
+int main() {
+   setup( 2 );
+   CHECK( apply( { issuer }, [&]( nfts& c ){ c.issue( 1, event, ticket, asset( 6, ctt ), "", "" ); } ) );
+   CHECK( !ask_of( 0 ) && !ask_of( 99 ) );
+
+   // every nft of the ask leads to it
+   const uint64_t batch = list( { 0, 1, 2 }, 900 );
+   for( uint64_t id : { 0, 1, 2 } ) {
+      const auto item = ask_of( id );
+      CHECK( item && item->batch_id == batch && item->seller == 1 && item->nft_name == ticket );
+      CHECK( item->nft_ids == vector<uint64_t>( { 0, 1, 2 } ) && item->ask_price == asset( 900, come ) && item->unit_price == asset( 300, come ) );
+   }
+   CHECK( !ask_of( 3 ) );
+
+   // a partial fill rewrites the nft sold and the ask, not the nfts left in it
+   const uint64_t before = nft_writes();
+   CHECK( apply( { self, issuer }, [&]( nfts& c ){ c.buy( 2, batch, "", vector<uint64_t>{ 1 } ); } ) );
+   CHECK( nft_writes() - before == 1 );
+   CHECK( !ask_of( 1 ) && !find_nft( 1 )->listed_in.has_value() );
+   CHECK( ask_of( 0 )->nft_ids == vector<uint64_t>( { 0, 2 } ) && ask_of( 2 )->ask_price == asset( 600, come ) );
+
+   // closing clears the rest
+   CHECK( apply( { issuer }, [&]( nfts& c ){ c.closesale( 1, batch ); } ) );
+   CHECK( !ask_of( 0 ) && !ask_of( 2 ) );
+   CHECK( find_nft( 0 )->flags == 0 && !find_nft( 0 )->listed_in.has_value() );
+
+   // listed again under a batch id of its own, and bought whole
+   const uint64_t relisted = list( { 0, 2 }, 400 );
+   CHECK( relisted != batch && ask_of( 2 )->batch_id == relisted );
+   CHECK( apply( { self, issuer }, [&]( nfts& c ){ c.buy( 2, relisted, "", {} ); } ) );
+   CHECK( !ask_of( 0 ) && !ask_of( 2 ) && owner_of( 2 ) == 2 );
+
+   // an nft of the new owner is listed by it
+   CHECK( apply( { issuer }, [&]( nfts& c ){ c.listsale( 2, event, ticket, { 2 }, asset( 500, come ) ); } ) );
+   CHECK( ask_of( 2 ) && ask_of( 2 )->seller == 2 );
+
+   return report();
+}
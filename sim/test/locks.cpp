@@ -0,0 +1,102 @@
+// Locks: a listed or auctioned nft carries its lock in its own flags and is
+// kept from moving, sharing and a second sale until the ask or auction ends.
+// Lock rows of the old lockednfts table become flags through migratelocks, or
+// when their legacy nft is converted.
+
+#include "test.hpp"
+
+using namespace sim_test;
+
+namespace {
+
+   uint8_t flags_of(uint64_t nft_id) {
+      return find_nft( nft_id )->flags;
+   }
+
+   bool transfer(uint64_t from, uint64_t to, uint64_t nft_id) {
+      return apply( { issuer }, [&]( nfts& c ){ c.transfer( from, to, { nft_id }, "" ); } );
+   }
+
+   // a lock as written before the flags, on an nft whose flags do not show it
+   void old_lock(uint64_t nft_id) {
+      CHECK( sim::chain::get().apply( { self }, [&]{
+         nfts::lock_index locks( self, self.value );
+         locks.emplace( self, [&]( auto& l ){ l.nft_id = nft_id; } );
+         nfts::nft_index nfts_table( self, event );
+         auto row = nfts_table.find( nft_id );
+         if( row != nfts_table.end() ) nfts_table.modify( row, same_payer, [&]( auto& n ){ n.flags = 0; } );
+      } ) );
+   }
+
+   size_t old_locks() {
+      nfts::lock_index locks( self, self.value );
+      return std::distance( locks.begin(), locks.end() );
+   }
+
+}
+
+int main() {
+   setup( 3 );
+   CHECK( apply( { issuer }, [&]( nfts& c ){ c.issue( 1, event, ticket, asset( 6, ctt ), "", "" ); } ) );
+   const auto expiration = time_point_sec( current_time_point() ) + 1000;
+
+   // a listed nft stays where it is until its ask is closed
+   CHECK( apply( { issuer }, [&]( nfts& c ){ c.listsale( 1, event, ticket, { 0 }, asset( 100, come ) ); } ) );
+   CHECK( flags_of( 0 ) == nfts::NFT_LISTED );
+   CHECK( !transfer( 1, 2, 0 ) );
+   CHECK( error == "NFT is locked, so it cannot transferred" );
+   CHECK( !apply( { issuer }, [&]( nfts& c ){ c.share( 1, 0, 2, expiration ); } ) );
+   CHECK( error == "NFT is locked, it cannot be shared" );
+   CHECK( !apply( { issuer }, [&]( nfts& c ){ c.listsale( 1, event, ticket, { 0 }, asset( 100, come ) ); } ) );
+   CHECK( error == "NFT locked " );
+   CHECK( !apply( { self }, [&]( nfts& c ){ c.createauctn( 1, event, 0, asset( 5000, come ), asset( 10, come ), expiration ); } ) );
+   CHECK( error == "NFT locked " );
+   CHECK( apply( { issuer }, [&]( nfts& c ){ c.closesale( 1, *find_nft( 0 )->listed_in ); } ) );
+   CHECK( flags_of( 0 ) == 0 && transfer( 1, 2, 0 ) );
+
+   // as does an auctioned one
+   CHECK( apply( { self }, [&]( nfts& c ){ c.createauctn( 1, event, 1, asset( 5000, come ), asset( 10, come ), expiration ); } ) );
+   CHECK( flags_of( 1 ) == nfts::NFT_AUCTIONED );
+   CHECK( !transfer( 1, 2, 1 ) );
+   CHECK( error == "NFT is locked, so it cannot transferred" );
+   CHECK( !apply( { issuer }, [&]( nfts& c ){ c.listsale( 1, event, ticket, { 1 }, asset( 100, come ) ); } ) );
+   CHECK( error == "NFT locked " );
+   CHECK( apply( { self }, [&]( nfts& c ){ c.closeauctn( 1, 1 ); } ) );
+   CHECK( flags_of( 1 ) == 0 && transfer( 1, 2, 1 ) );
+
+   // old lock rows: of an nft in an auction, of a listed one and of an nft that is gone
+   CHECK( apply( { self }, [&]( nfts& c ){ c.createauctn( 1, event, 2, asset( 5000, come ), asset( 10, come ), expiration ); } ) );
+   CHECK( apply( { issuer }, [&]( nfts& c ){ c.listsale( 1, event, ticket, { 3 }, asset( 100, come ) ); } ) );
+   old_lock( 2 );
+   old_lock( 3 );
+   old_lock( 99 );
+   CHECK( flags_of( 2 ) == 0 && flags_of( 3 ) == 0 && old_locks() == 3 );
+   CHECK( !apply( { issuer }, [&]( nfts& c ){ c.migratelocks( 10 ); } ) );
+   CHECK( error == "missing authority of nfts" );
+   CHECK( !apply( { self }, [&]( nfts& c ){ c.migratelocks( 0 ); } ) );
+   CHECK( error == "max_rows must be positive" );
+
+   // max_rows at a time, each call resuming with the rows left
+   CHECK( apply( { self }, [&]( nfts& c ){ c.migratelocks( 1 ); } ) );
+   CHECK( old_locks() == 2 && flags_of( 2 ) == nfts::NFT_AUCTIONED && flags_of( 3 ) == 0 );
+   CHECK( apply( { self }, [&]( nfts& c ){ c.migratelocks( 10 ); } ) );
+   CHECK( old_locks() == 0 && flags_of( 3 ) == nfts::NFT_LISTED );
+   CHECK( !transfer( 1, 2, 3 ) );
+
+   // a legacy nft with a lock row is locked from its first read, and loses the row then
+   CHECK( sim::chain::get().apply( { self, issuer }, [&]{
+      nfts::legacy_nft_index legacy( self, self.value );
+      legacy.emplace( issuer, [&]( auto& n ){
+         n.id = 100; n.serial_number = 100; n.event = event; n.owner = 1; n.nft_name = ticket;
+         n.resale_price = asset( 0, come ); n.shared_with = 0;
+      } );
+      nfts::lock_index locks( self, self.value );
+      locks.emplace( self, [&]( auto& l ){ l.nft_id = 100; } );
+   } ) );
+   CHECK( !transfer( 1, 2, 100 ) );
+   CHECK( error == "NFT is locked, so it cannot transferred" );
+   CHECK( apply( { self }, [&]( nfts& c ){ c.migratenfts( 10 ); } ) );
+   CHECK( flags_of( 100 ) == nfts::NFT_LISTED && old_locks() == 0 );
+
+   return report();
+}
@@ -0,0 +1,176 @@
+// Market stats of an event: after every action of a random mix of listings,
+// buys, sweeps and auctions, the markets row kept up to date by the actions must
+// match the stats computed from the asks and auctions tables, and initmarket
+// must rebuild the same row from scratch.
+
+#include "test.hpp"
+
+#include <random>
+
+using namespace sim_test;
+
+namespace {
+
+   struct stats {
+      uint64_t active_asks = 0;
+      uint64_t listed_units = 0;
+      int64_t floor_price = 0;
+      uint64_t open_auctions = 0;
+      int64_t highest_bid = 0;
+      uint64_t live_bids = 0;
+   };
+
+   stats expected() {
+      stats s;
+      nfts::ask_index asks( self, self.value );
+      for( const auto& ask : asks ) {
+         if( ask.event != event ) continue;
+         const int64_t unit_price = ask.get_unit_price();
+         if( s.active_asks++ == 0 || unit_price < s.floor_price ) s.floor_price = unit_price;
+         s.listed_units += ask.nft_ids.size();
+      }
+      nfts::auction_index auctions( self, self.value );
+      for( const auto& auction : auctions ) {
+         if( auction.event != event ) continue;
+         s.open_auctions++;
+         if( auction.bidder == 0 ) continue;
+         s.live_bids++;
+         s.highest_bid = std::max( s.highest_bid, auction.current_price.amount );
+      }
+      return s;
+   }
+
+   // false when the markets row disagrees with the tables
+   bool matches(const char* action, int step) {
+      const stats s = expected();
+      nfts::market_index markets( self, self.value );
+      const auto& m = markets.get( event );
+      nfts::live_bid_index bids( self, event );
+      const uint64_t live_bids = std::distance( bids.begin(), bids.end() );
+      if( m.active_asks == s.active_asks && m.listed_units == s.listed_units && m.floor_price.amount == s.floor_price &&
+          m.open_auctions == s.open_auctions && m.highest_bid.amount == s.highest_bid && live_bids == s.live_bids ) {
+         return true;
+      }
+      std::fprintf( stderr, "step %d %s: asks %lu/%lu units %lu/%lu floor %ld/%ld auctions %lu/%lu highest bid %ld/%ld live bids %lu/%lu\n",
+                    step, action, m.active_asks, s.active_asks, m.listed_units, s.listed_units, m.floor_price.amount, s.floor_price,
+                    m.open_auctions, s.open_auctions, m.highest_bid.amount, s.highest_bid, live_bids, s.live_bids );
+      return false;
+   }
+
+}
+
+int main() {
+   const uint64_t users = 4, per_user = 60, steps = 3000;
+   setup( users );
+   for( uint64_t u = 1; u <= users; u++ ) {
+      CHECK( apply( { issuer }, [&]( nfts& c ){ c.issue( u, event, ticket, asset( per_user, ctt ), "", "" ); } ) );
+   }
+   const uint64_t nft_count = users * per_user;
+
+   std::mt19937_64 rng( 1 );
+   auto uniform = [&]( uint64_t n ){ return rng() % n; };
+   // an open ask, most buys and closes go to one
+   auto some_ask = [&]() -> std::optional<nfts::ask> {
+      nfts::ask_index asks( self, self.value );
+      const uint64_t rows = std::distance( asks.begin(), asks.end() );
+      if( rows == 0 ) return std::nullopt;
+      return *std::next( asks.begin(), uniform( rows ) );
+   };
+
+   uint64_t succeeded = 0;
+   for( uint64_t step = 0; step < steps; step++ ) {
+      sim::chain::get().advance( seconds( int64_t( uniform( 4000 ) ) ) );
+      const uint64_t user = uniform( users ) + 1, nft_id = uniform( nft_count );
+      const char* action = "";
+      bool ok = false;
+      switch( uniform( 10 ) ) {
+         case 0: case 1: {
+            action = "listsale";
+            vector<uint64_t> ids = { nft_id };
+            if( uniform( 2 ) ) ids.push_back( ( nft_id + 1 ) % nft_count );
+            const asset price( int64_t( 100 + uniform( 900 ) ) * int64_t( ids.size() ), come );
+            ok = apply( { issuer }, [&]( nfts& c ){ c.listsale( owner_of( nft_id ), event, ticket, ids, price ); } );
+            break;
+         }
+         case 2: {
+            action = "closesale";
+            const auto ask = some_ask();
+            ok = ask && apply( { issuer }, [&]( nfts& c ){ c.closesale( ask->seller, ask->batch_id ); } );
+            break;
+         }
+         case 3: {
+            action = "buy";
+            const auto ask = some_ask();
+            const vector<uint64_t> some = ask ? vector<uint64_t>{ ask->nft_ids[0] } : vector<uint64_t>{};
+            ok = ask && apply( { self, issuer }, [&]( nfts& c ){ c.buy( user, ask->batch_id, "", uniform( 2 ) ? some : vector<uint64_t>{} ); } );
+            break;
+         }
+         case 4:
+            action = "buybest";
+            ok = apply( { self, issuer }, [&]( nfts& c ){ c.buybest( user, event, ticket, asset( 600, come ), uniform( 4 ) + 1 ); } );
+            break;
+         case 5:
+            action = "sweepasks";
+            ok = apply( {}, [&]( nfts& c ){ c.sweepasks( 2 ); } );
+            break;
+         case 6: {
+            action = "createauctn";
+            const auto expiration = time_point_sec( current_time_point() ) + uint32_t( uniform( 20000 ) );
+            ok = apply( { self }, [&]( nfts& c ){ c.createauctn( owner_of( nft_id ), event, nft_id, asset( 5000, come ), asset( 10, come ), expiration ); } );
+            break;
+         }
+         case 7:
+            action = "bid";
+            ok = apply( { self }, [&]( nfts& c ){ c.bid( nft_id, user, asset( int64_t( 50 + uniform( 6000 ) ), come ) ); } );
+            break;
+         case 8:
+            action = "closeauctn";
+            ok = apply( { self }, [&]( nfts& c ){ c.closeauctn( owner_of( nft_id ), nft_id ); } );
+            break;
+         case 9:
+            if( uniform( 2 ) ) {
+               action = "finalize";
+               ok = apply( { self }, [&]( nfts& c ){ c.finalize( nft_id, owner_of( nft_id ) ); } );
+            } else {
+               action = "settleauctns";
+               ok = apply( { self }, [&]( nfts& c ){ c.settleauctns( 3 ); } );
+            }
+            break;
+      }
+      succeeded += ok;
+      const bool in_sync = matches( action, step );
+      CHECK( in_sync );
+      // later steps would only repeat the first difference
+      if( !in_sync ) break;
+   }
+   // the mix must exercise the market, not only fail
+   CHECK( succeeded > steps / 4 );
+   {
+      nfts::market_index markets( self, self.value );
+      CHECK( markets.get( event ).sales > 0 );
+   }
+
+   // as for an event created before markets, with open asks and standing bids on fresh nfts
+   CHECK( apply( { issuer }, [&]( nfts& c ){ c.issue( 1, event, ticket, asset( 8, ctt ), "", "" ); } ) );
+   for( uint64_t nft_id = nft_count; nft_id < nft_count + 4; nft_id++ ) {
+      CHECK( apply( { issuer }, [&]( nfts& c ){ c.listsale( 1, event, ticket, { nft_id }, asset( int64_t( 100 + nft_id ), come ) ); } ) );
+      const auto expiration = time_point_sec( current_time_point() ) + 5000;
+      CHECK( apply( { self }, [&]( nfts& c ){ c.createauctn( 1, event, nft_id + 4, asset( 5000, come ), asset( 10, come ), expiration ); } ) );
+      CHECK( apply( { self }, [&]( nfts& c ){ c.bid( nft_id + 4, 2, asset( int64_t( 100 + nft_id ), come ) ); } ) );
+   }
+   CHECK( matches( "setup", steps ) );
+   const stats before = expected();
+   CHECK( before.active_asks >= 4 && before.live_bids >= 4 );
+   CHECK( sim::chain::get().apply( { self }, [&]{
+      nfts::market_index markets( self, self.value );
+      markets.erase( markets.get( event ) );
+      nfts::live_bid_index bids( self, event );
+      for( auto bid = bids.begin(); bid != bids.end(); ) bid = bids.erase( bid );
+   } ) );
+   CHECK( apply( { self }, [&]( nfts& c ){ c.initmarket( event ); } ) );
+   CHECK( matches( "initmarket", steps ) );
+   CHECK( !apply( { self }, [&]( nfts& c ){ c.initmarket( event ); } ) );
+   CHECK( error == "Market of this event already exists" );
+
+   return report();
+}
@@ -0,0 +1,186 @@
+// Metrics: after a random mix of actions over two events, one of them deleted
+// and purged at the end, the counters read back by getmetrics must agree with
+// the chain: rows created less rows erased is the row count of every counted
+// table, per event and in total, and every action that went through is counted
+// once while the ones that aborted are not.
+
+#include "test.hpp"
+
+#include <random>
+
+using namespace sim_test;
+
+namespace {
+
+   const uint64_t festival = 2;
+   const name pass = "pass"_n;
+
+   nfts::metrics_snapshot metrics() {
+      nfts::metrics_snapshot snapshot;
+      CHECK( apply( {}, [&]( nfts& c ){ snapshot = c.getmetrics( 0, 100 ); } ) );
+      return snapshot;
+   }
+
+   // rows of a table in every scope, or in one
+   int64_t rows_of(name table, std::optional<uint64_t> scope = std::nullopt) {
+      int64_t rows = 0;
+      for( const auto& [key, store] : sim::chain::get().tables() ) {
+         if( std::get<0>( key ) != self.value || std::get<2>( key ) != table.value ) continue;
+         if( !scope ) {
+            rows += store->rows.size();
+            continue;
+         }
+         // rows of no event are counted under the contract, event tables are told apart by the event field
+         for( const auto& [pk, row] : store->rows ) {
+            uint64_t event = std::get<1>( key );
+            if( table == "events"_n || table == "markets"_n ) event = pk;
+            if( table == "userfunds"_n || table == "royalties"_n || table == "users"_n ) event = self.value;
+            rows += event == *scope;
+         }
+      }
+      return rows;
+   }
+
+   // the tables scoped by event, whose per-event counts can be checked against their scope
+   const vector<name> event_tables = { "nftstats"_n, "nftsv2"_n, "nftranges"_n, "events"_n, "markets"_n };
+
+}
+
+int main() {
+   const uint64_t users = 4;
+   setup( users );
+   CHECK( apply( { issuer }, [&]( nfts& c ){
+      c.createnft( issuer, festival, pass, true, true, true, asset( 1000, come ), 255, 500, "", asset( 1000000, ctt ) );
+   } ) );
+
+   std::map<name, uint64_t> calls = { { "setconfig"_n, 1 }, { "createacc"_n, users }, { "deposit"_n, users }, { "createnft"_n, 2 } };
+   std::mt19937_64 rng( 7 );
+   auto uniform = [&]( uint64_t n ){ return rng() % n; };
+   uint64_t minted = 0;
+   for( int step = 0; step < 2000; step++ ) {
+      sim::chain::get().advance( seconds( int64_t( uniform( 3000 ) ) ) );
+      const uint64_t user = uniform( users ) + 1, other = uniform( users ) + 1;
+      const uint64_t ev = uniform( 2 ) ? event : festival;
+      const name category = ev == event ? ticket : pass;
+      const uint64_t nft_id = minted ? uniform( minted ) : 0;
+      name action;
+      bool ok = false;
+      switch( uniform( 12 ) ) {
+         case 0: case 1: {
+            action = "issue"_n;
+            const int64_t count = int64_t( uniform( 4 ) + 1 );
+            ok = apply( { issuer }, [&]( nfts& c ){ c.issue( user, ev, category, asset( count, ctt ), "", "" ); } );
+            break;
+         }
+         case 2:
+            action = "transfer"_n;
+            ok = apply( { issuer }, [&]( nfts& c ){ c.transfer( owner_of( nft_id ), other, { nft_id }, "" ); } );
+            break;
+         case 3:
+            action = "listsale"_n;
+            ok = apply( { issuer }, [&]( nfts& c ){ c.listsale( owner_of( nft_id ), ev, category, { nft_id }, asset( 500, come ) ); } );
+            break;
+         case 4: {
+            action = "buy"_n;
+            nfts::ask_index asks( self, self.value );
+            const uint64_t batch_id = asks.begin() == asks.end() ? 0 : asks.begin()->batch_id;
+            ok = apply( { self, issuer }, [&]( nfts& c ){ c.buy( user, batch_id, "", {} ); } );
+            break;
+         }
+         case 5:
+            action = "sweepasks"_n;
+            ok = apply( {}, [&]( nfts& c ){ c.sweepasks( 3 ); } );
+            break;
+         case 6: {
+            action = "createauctn"_n;
+            const auto expiration = time_point_sec( current_time_point() ) + uint32_t( uniform( 10000 ) );
+            ok = apply( { self }, [&]( nfts& c ){ c.createauctn( owner_of( nft_id ), ev, nft_id, asset( 3000, come ), asset( 10, come ), expiration ); } );
+            break;
+         }
+         case 7: {
+            action = "bid"_n;
+            nfts::auction_index auctions( self, self.value );
+            const uint64_t auctioned = auctions.begin() == auctions.end() ? 0 : std::prev( auctions.end() )->nft_id;
+            ok = apply( { self }, [&]( nfts& c ){ c.bid( auctioned, user, asset( int64_t( 100 + uniform( 4000 ) ), come ) ); } );
+            break;
+         }
+         case 8:
+            action = "settleauctns"_n;
+            ok = apply( { self }, [&]( nfts& c ){ c.settleauctns( 2 ); } );
+            break;
+         case 9: {
+            action = "share"_n;
+            const auto expiration = time_point_sec( current_time_point() ) + uint32_t( uniform( 10000 ) );
+            ok = apply( { issuer }, [&]( nfts& c ){ c.share( owner_of( nft_id ), nft_id, other, expiration ); } );
+            break;
+         }
+         case 10:
+            action = "sweepshares"_n;
+            ok = apply( {}, [&]( nfts& c ){ c.sweepshares( 3 ); } );
+            break;
+         case 11:
+            action = "withdraw"_n;
+            ok = apply( { self }, [&]( nfts& c ){ c.withdraw( user, caller, asset( 100, come ), "" ); } );
+            break;
+      }
+      if( ok ) calls[action]++;
+      nfts::config_index config( self, self.value );
+      minted = config.get().next_nft_id.value_or( 0 );
+   }
+
+   // the festival goes, with everything still open in it
+   CHECK( apply( { issuer }, [&]( nfts& c ){ c.deleteeve( festival ); } ) );
+   calls["deleteeve"_n]++;
+   for( bool done = false; !done; calls["purgeevent"_n]++ ) {
+      CHECK( apply( { self }, [&]( nfts& c ){ done = c.purgeevent( festival, 25 ).done; } ) );
+   }
+
+   const auto snapshot = metrics();
+   for( const auto& counter : snapshot.totals.tables ) {
+      const int64_t live = int64_t( counter.created ) - int64_t( counter.erased );
+      if( live != rows_of( counter.table ) ) {
+         std::fprintf( stderr, "%s: %ld rows counted, %ld on chain\n", counter.table.to_string().c_str(), live, rows_of( counter.table ) );
+      }
+      CHECK( live == rows_of( counter.table ) );
+   }
+   // and no table holds rows that were never counted, but the config and the metrics themselves
+   const vector<name> uncounted = { "tokenconfigs"_n, "tablecounts"_n, "tabletotals"_n, "actioncounts"_n, "eventmetrics"_n, "payermetrics"_n };
+   for( const auto& [key, store] : sim::chain::get().tables() ) {
+      const name table( std::get<2>( key ) );
+      if( store->rows.empty() || std::find( uncounted.begin(), uncounted.end(), table ) != uncounted.end() ) continue;
+      const bool counted = std::any_of( snapshot.totals.tables.begin(), snapshot.totals.tables.end(), [&]( const auto& c ){ return c.table == table; } );
+      if( !counted ) std::fprintf( stderr, "%s: rows on chain are not counted\n", table.to_string().c_str() );
+      CHECK( counted );
+   }
+   for( const auto& report : snapshot.events ) {
+      for( const auto& counter : report.tables ) {
+         if( std::find( event_tables.begin(), event_tables.end(), counter.table ) == event_tables.end() ) continue;
+         const int64_t live = int64_t( counter.created ) - int64_t( counter.erased );
+         if( live != rows_of( counter.table, report.event ) ) {
+            std::fprintf( stderr, "%s of %lu: %ld rows counted, %ld on chain\n", counter.table.to_string().c_str(), report.event, live, rows_of( counter.table, report.event ) );
+         }
+         CHECK( live == rows_of( counter.table, report.event ) );
+      }
+   }
+   CHECK( snapshot.events.size() >= 2 );
+
+   // the actions that went through, and only those
+   std::map<name, uint64_t> counted;
+   for( const auto& counter : snapshot.totals.actions ) counted[counter.action] = counter.calls;
+   for( const auto& [action, n] : calls ) {
+      if( counted[action] != n ) std::fprintf( stderr, "%s: %lu calls counted, %lu went through\n", action.to_string().c_str(), counted[action], n );
+      CHECK( counted[action] == n );
+   }
+   CHECK( counted.size() == calls.size() );
+   CHECK( calls["buy"_n] > 0 && calls["bid"_n] > 0 && calls["settleauctns"_n] > 0 && calls["share"_n] > 0 );
+
+   // bytes billed per event and per payer are two views of the same rows
+   int64_t by_event = 0, by_payer = 0;
+   for( const auto& report : snapshot.events ) by_event += report.billed_bytes;
+   vector<nfts::payer_metrics> payers;
+   CHECK( apply( {}, [&]( nfts& c ){ payers = c.getpayers( name(), 100 ); } ) );
+   for( const auto& payer : payers ) by_payer += payer.billed_bytes;
+   CHECK( by_event == by_payer && by_event > 0 );
+
+   return report();
+}
@@ -0,0 +1,83 @@
+// Compact rows: nfts of the legacy table are converted by migratenfts, a few
+// rows a call, or by the first action that reads them. A converted row keeps
+// its serial, owner and share, stores its uri only when it adds to the base
+// uri, and takes less RAM than the legacy row it replaces.
+
+#include "test.hpp"
+
+using namespace sim_test;
+
+namespace {
+
+   void legacy_row(uint64_t nft_id, name nft_name, std::optional<string> uri, uint64_t shared_with) {
+      CHECK( sim::chain::get().apply( { self, issuer }, [&]{
+         nfts::legacy_nft_index legacy( self, self.value );
+         legacy.emplace( issuer, [&]( auto& n ){
+            n.id = nft_id; n.serial_number = nft_id - 199; n.event = event; n.owner = 1; n.nft_name = nft_name;
+            n.resale_price = asset( 500, come ); n.shared_with = shared_with; n.relative_uri = uri;
+         } );
+      } ) );
+   }
+
+   size_t legacy_rows() {
+      nfts::legacy_nft_index legacy( self, self.value );
+      return std::distance( legacy.begin(), legacy.end() );
+   }
+
+   size_t row_size(name table, uint64_t scope, uint64_t nft_id) {
+      const auto* store = sim::chain::get().find_store( self, scope, table );
+      return store->rows.at( nft_id ).bytes.size();
+   }
+
+   std::optional<nfts::shared_nft> share_of(uint64_t nft_id) {
+      nfts::shared_index shared( self, self.value );
+      auto row = shared.find( nft_id );
+      if( row == shared.end() ) return std::nullopt;
+      return *row;
+   }
+
+}
+
+int main() {
+   setup( 2 );
+   legacy_row( 200, ticket, "seat-1", 0 );
+   legacy_row( 201, ticket, "https://example.com/", 2 );
+   legacy_row( 202, "ghost"_n, std::nullopt, 0 );
+   legacy_row( 203, ticket, std::nullopt, 2 );
+   const size_t legacy_size = row_size( "nfts"_n, self.value, 200 );
+
+   // a shared legacy nft is converted by unshare on its way to being unshared
+   CHECK( apply( { issuer }, [&]( nfts& c ){ c.unshare( 203 ); } ) );
+   CHECK( legacy_rows() == 3 && find_nft( 203 )->flags == 0 && !share_of( 203 ) );
+
+   CHECK( !apply( { issuer }, [&]( nfts& c ){ c.migratenfts( 10 ); } ) );
+   CHECK( error == "missing authority of nfts" );
+   CHECK( apply( { self }, [&]( nfts& c ){ c.migratenfts( 2 ); } ) );
+   CHECK( legacy_rows() == 1 );
+
+   const auto first = *find_nft( 200 );
+   CHECK( first.serial_number == 1 && first.owner == 1 && first.nft_category_id == category_id() );
+   CHECK( first.relative_uri == std::optional<string>( "seat-1" ) && first.flags == 0 );
+   CHECK( row_size( "nftsv2"_n, event, 200 ) < legacy_size );
+   const auto second = *find_nft( 201 );
+   CHECK( !second.relative_uri.has_value() && second.flags == nfts::NFT_SHARED && share_of( 201 )->shared_with == 2 );
+
+   // the row of a deleted category is dropped
+   CHECK( apply( { self }, [&]( nfts& c ){ c.migratenfts( 10 ); } ) );
+   CHECK( legacy_rows() == 0 && !find_nft( 202 ) );
+
+   // converted rows are used like any other
+   CHECK( apply( { issuer }, [&]( nfts& c ){ c.unshare( 201 ); } ) );
+   CHECK( !share_of( 201 ) && find_nft( 201 )->flags == 0 );
+   // with the balance user 1 was issued for them before the conversion
+   CHECK( sim::chain::get().apply( { self }, [&]{
+      nfts::account_index accounts( self, 1 );
+      accounts.emplace( self, [&]( auto& a ){
+         a.nft_category_id = category_id(); a.event = event; a.nft_name = ticket; a.amount = asset( 3, ctt );
+      } );
+   } ) );
+   CHECK( apply( { issuer }, [&]( nfts& c ){ c.transfer( 1, 2, { 200, 201 }, "" ); } ) );
+   CHECK( owner_of( 200 ) == 2 && owner_of( 201 ) == 2 && balance( 1 ) == 1 && balance( 2 ) == 2 );
+
+   return report();
+}
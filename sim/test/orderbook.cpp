@@ -0,0 +1,78 @@
+// Order book: buybest fills the cheapest running asks of one category of an
+// event, earlier asks first at the same unit price, up to a unit price and a
+// count, the last ask partially. Asks of other categories, expired asks and
+// asks above the price are left alone, and a buyer short of funds buys nothing.
+
+#include "test.hpp"
+
+using namespace sim_test;
+
+namespace {
+
+   const name vip = "vip"_n;
+
+   uint64_t list(uint64_t seller, name nft_name, vector<uint64_t> nft_ids, int64_t unit_price) {
+      CHECK( apply( { issuer }, [&]( nfts& c ){
+         c.listsale( seller, event, nft_name, nft_ids, asset( unit_price * int64_t( nft_ids.size() ), come ) );
+      } ) );
+      return find_nft( nft_ids[0] )->listed_in.value_or( 0 );
+   }
+
+   bool buybest(uint64_t to, name nft_name, int64_t max_unit_price, uint64_t count, uint64_t* bought = nullptr) {
+      return apply( { self, issuer }, [&]( nfts& c ){
+         const uint64_t n = c.buybest( to, event, nft_name, asset( max_unit_price, come ), count );
+         if( bought ) *bought = n;
+      } );
+   }
+
+}
+
+int main() {
+   setup( 4 );
+   CHECK( apply( { issuer }, [&]( nfts& c ){
+      c.createnft( issuer, event, vip, true, true, true, asset( 1000, come ), 255, royalty_bps, "", asset( 100, ctt ) );
+   } ) );
+   // tickets 0-9 of user 1, 10-13 of user 2, vip 14-15 of user 2
+   CHECK( apply( { issuer }, [&]( nfts& c ){ c.issue( 1, event, ticket, asset( 10, ctt ), "", "" ); } ) );
+   CHECK( apply( { issuer }, [&]( nfts& c ){ c.issue( 2, event, ticket, asset( 4, ctt ), "", "" ); } ) );
+   CHECK( apply( { issuer }, [&]( nfts& c ){ c.issue( 2, event, vip, asset( 2, ctt ), "", "" ); } ) );
+
+   // the cheapest ticket ask has expired by the time the others are listed
+   const uint64_t expired = list( 1, ticket, { 5 }, 100 );
+   sim::chain::get().advance( days( 8 ) );
+   const uint64_t pair = list( 1, ticket, { 0, 1 }, 300 );
+   const uint64_t single = list( 2, ticket, { 10 }, 200 );
+   const uint64_t triple = list( 1, ticket, { 2, 3, 4 }, 200 );
+   const uint64_t other = list( 2, vip, { 14 }, 50 );
+   const uint64_t dear = list( 2, ticket, { 11 }, 500 );
+
+   CHECK( !apply( { self, issuer }, [&]( nfts& c ){ c.buybest( 3, event, ticket, asset( 300, come ), 0 ); } ) );
+   CHECK( error == "count must be positive" );
+
+   // 200 from user 2 then user 1 at the same price, then one of the pair at 300
+   uint64_t bought = 0;
+   CHECK( buybest( 3, ticket, 300, 5, &bought ) && bought == 5 );
+   CHECK( owner_of( 10 ) == 3 && owner_of( 2 ) == 3 && owner_of( 4 ) == 3 && owner_of( 0 ) == 3 );
+   CHECK( funds( 3 ) == deposit - 200 - 600 - 300 );
+   CHECK( funds( 2 ) == deposit + 180 && funds( 1 ) == deposit + 540 + 270 && royalties() == 20 + 60 + 30 );
+   CHECK( !find_ask( single ) && !find_ask( triple ) );
+   CHECK( find_ask( pair )->nft_ids == vector<uint64_t>{ 1 } && find_ask( pair )->ask_price == asset( 300, come ) );
+   CHECK( find_ask( expired ) && find_ask( other ) && find_ask( dear ) );
+   CHECK( owner_of( 5 ) == 1 && owner_of( 14 ) == 2 && owner_of( 11 ) == 2 );
+
+   // what is left under the price, fewer than asked for
+   CHECK( buybest( 3, ticket, 300, 5, &bought ) && bought == 1 );
+   CHECK( !find_ask( pair ) && owner_of( 1 ) == 3 );
+   CHECK( !buybest( 3, ticket, 300, 5 ) );
+   CHECK( error == "No listing matches the requested price" );
+
+   // a buyer who cannot pay for the fills is refused and the asks stay
+   CHECK( apply( { self }, [&]( nfts& c ){ c.withdraw( 4, caller, asset( deposit - 10, come ), "" ); } ) );
+   CHECK( !buybest( 4, ticket, 500, 1 ) );
+   CHECK( error == "Not enough COME deposited for this user" );
+   CHECK( find_ask( dear ) && owner_of( 11 ) == 2 && funds( 2 ) == deposit + 180 );
+   CHECK( !buybest( 4, vip, 50, 1 ) );
+   CHECK( buybest( 3, vip, 50, 1, &bought ) && bought == 1 && owner_of( 14 ) == 3 );
+
+   return report();
+}
@@ -0,0 +1,82 @@
+// Partial fills of multi-nft asks: buy of some nfts of an ask, buybest across
+// asks, the unit price of an ask and the batch ids of asks that outlive a fill.
+
+#include "test.hpp"
+
+using namespace sim_test;
+
+int main() {
+   setup( 3 );
+   // nfts 0..5 and 6..8 of user 1
+   CHECK( apply( { issuer }, [&]( nfts& c ){ c.issue( 1, event, ticket, asset( 6, ctt ), "", "" ); } ) );
+   CHECK( apply( { issuer }, [&]( nfts& c ){ c.issue( 1, event, ticket, asset( 3, ctt ), "", "" ); } ) );
+
+   // the ask price must split into equal unit prices
+   CHECK( !apply( { issuer }, [&]( nfts& c ){ c.listsale( 1, event, ticket, { 6, 7, 8 }, asset( 1000, come ) ); } ) );
+   CHECK( error == "Price must be a multiple of the number of NFTs" );
+
+   CHECK( apply( { issuer }, [&]( nfts& c ){ c.listsale( 1, event, ticket, { 0, 1, 2, 3, 4, 5 }, asset( 60000, come ) ); } ) );
+   CHECK( find_ask( 0 ) && find_ask( 0 )->unit_price.value() == asset( 10000, come ) );
+
+   // only the contract moves the funds of the buyer
+   CHECK( !apply( { issuer }, [&]( nfts& c ){ c.buy( 2, 0, "", vector<uint64_t>{ 1 } ); } ) );
+   // the requested nfts must be in the ask, once each
+   CHECK( !apply( { self, issuer }, [&]( nfts& c ){ c.buy( 2, 0, "", vector<uint64_t>{ 1, 1 } ); } ) );
+   CHECK( error == "Duplicate NFT in request" );
+   CHECK( !apply( { self, issuer }, [&]( nfts& c ){ c.buy( 2, 0, "", vector<uint64_t>{ 1, 7 } ); } ) );
+   CHECK( error == "NFT is not part of this listing" );
+
+   // two of the six, the ask keeps the other four at the same unit price
+   nfts::sale_payout payout;
+   CHECK( apply( { self, issuer }, [&]( nfts& c ){ payout = c.buy( 2, 0, "", vector<uint64_t>{ 3, 1 } ); } ) );
+   CHECK( payout.seller == 1 && payout.issuer == issuer );
+   CHECK( payout.proceeds == asset( 18000, come ) && payout.royalty == asset( 2000, come ) );
+   CHECK( funds( 1 ) == deposit + 18000 && funds( 2 ) == deposit - 20000 && royalties() == 2000 );
+   {
+      const auto ask = *find_ask( 0 );
+      CHECK( ask.nft_ids == vector<uint64_t>( { 0, 2, 4, 5 } ) );
+      CHECK( ask.ask_price == asset( 40000, come ) && ask.unit_price.value() == asset( 10000, come ) );
+   }
+   CHECK( owner_of( 1 ) == 2 && owner_of( 3 ) == 2 && owner_of( 0 ) == 1 );
+   CHECK( !( find_nft( 1 )->flags & nfts::NFT_LISTED ) && ( find_nft( 0 )->flags & nfts::NFT_LISTED ) );
+   CHECK( balance( 1 ) == 7 && balance( 2 ) == 2 );
+
+   // an ask of the bought nfts gets a batch id of its own while the rest of the first ask is on sale
+   CHECK( apply( { issuer }, [&]( nfts& c ){ c.listsale( 2, event, ticket, { 1, 3 }, asset( 16000, come ) ); } ) );
+   CHECK( find_ask( 1 ) && find_ask( 1 )->seller == 2 );
+   CHECK( find_nft( 1 )->listed_in.value() == 1 && find_nft( 0 )->listed_in.value() == 0 );
+
+   // nothing is listed at or below the unit price
+   CHECK( !apply( { self, issuer }, [&]( nfts& c ){ c.buybest( 3, event, ticket, asset( 7999, come ), 1 ); } ) );
+
+   // the cheapest ask is bought whole, then the first nft of the next one
+   uint64_t bought = 0;
+   CHECK( apply( { self, issuer }, [&]( nfts& c ){ bought = c.buybest( 3, event, ticket, asset( 10000, come ), 3 ); } ) );
+   CHECK( bought == 3 );
+   CHECK( funds( 3 ) == deposit - 26000 && funds( 2 ) == deposit - 20000 + 14400 && funds( 1 ) == deposit + 27000 );
+   CHECK( !find_ask( 1 ) );
+   CHECK( find_ask( 0 )->nft_ids == vector<uint64_t>( { 2, 4, 5 } ) && find_ask( 0 )->ask_price == asset( 30000, come ) );
+   CHECK( owner_of( 1 ) == 3 && owner_of( 3 ) == 3 && owner_of( 0 ) == 3 );
+   CHECK( balance( 1 ) == 6 && balance( 2 ) == 0 && balance( 3 ) == 3 );
+
+   // buying the last nfts closes the ask
+   CHECK( apply( { self, issuer }, [&]( nfts& c ){ payout = c.buy( 2, 0, "", vector<uint64_t>{ 2, 4, 5 } ); } ) );
+   CHECK( payout.proceeds == asset( 27000, come ) );
+   CHECK( no_asks() );
+   CHECK( owner_of( 5 ) == 2 && !( find_nft( 5 )->flags & nfts::NFT_LISTED ) );
+   CHECK( balance( 1 ) == 3 && balance( 2 ) == 3 );
+
+   // an ask listed before unit prices is only sold whole, and is refused before anything is priced
+   CHECK( apply( { issuer }, [&]( nfts& c ){ c.listsale( 1, event, ticket, { 6, 7, 8 }, asset( 3000, come ) ); } ) );
+   CHECK( sim::chain::get().apply( { self }, [&]{
+      nfts::ask_index asks( self, self.value );
+      asks.modify( asks.get( 2 ), same_payer, [&]( auto& a ){ a.unit_price.reset(); } );
+   } ) );
+   const int64_t before = funds( 3 );
+   CHECK( !apply( { self, issuer }, [&]( nfts& c ){ c.buy( 3, 2, "", vector<uint64_t>{ 7 } ); } ) );
+   CHECK( error == "This listing can only be bought as a whole" );
+   CHECK( apply( { self, issuer }, [&]( nfts& c ){ c.buy( 3, 2, "", {} ); } ) );
+   CHECK( funds( 3 ) == before - 3000 && owner_of( 7 ) == 3 && no_asks() );
+
+   return report();
+}
@@ -0,0 +1,99 @@
+// Purge: a deleted event takes no new nfts, asks or auctions, and purgeevent
+// then erases everything left of it a few rows per call, in stage order, with
+// the held bids handed back. The rows of other events stay as they were.
+
+#include "test.hpp"
+
+using namespace sim_test;
+
+namespace {
+
+   const uint64_t festival = 2;
+   const name pass = "pass"_n;
+
+   // rows of a table in one scope
+   size_t rows_in(name table, uint64_t scope) {
+      const auto* store = sim::chain::get().find_store( self, scope, table );
+      return store ? store->rows.size() : 0;
+   }
+
+   size_t id_blocks_of(uint64_t ev) {
+      nfts::range_index ranges( self, self.value );
+      return std::count_if( ranges.begin(), ranges.end(), [&]( const auto& r ){ return r.event == ev; } );
+   }
+
+   int64_t passes(uint64_t user, uint64_t pass_id) {
+      nfts::account_index accounts( self, user );
+      auto row = accounts.find( pass_id );
+      return row == accounts.end() ? 0 : row->amount.amount;
+   }
+
+}
+
+int main() {
+   setup( 3 );
+   CHECK( apply( { issuer }, [&]( nfts& c ){
+      c.createnft( issuer, festival, pass, true, true, true, asset( 1000, come ), 255, 500, "", asset( 1000, ctt ) );
+   } ) );
+   nfts::stat_index stats( self, festival );
+   const uint64_t pass_id = stats.get( pass.value ).nft_category_id;
+
+   // ids 0-4 and 5 in the festival, 6-8 in the event, 9-10 in the festival again
+   CHECK( apply( { issuer }, [&]( nfts& c ){ c.issue( 1, festival, pass, asset( 5, ctt ), "", "" ); } ) );
+   CHECK( apply( { issuer }, [&]( nfts& c ){ c.issue( 2, festival, pass, asset( 1, ctt ), "", "" ); } ) );
+   CHECK( apply( { issuer }, [&]( nfts& c ){ c.issue( 1, event, ticket, asset( 3, ctt ), "", "" ); } ) );
+   CHECK( apply( { issuer }, [&]( nfts& c ){ c.issue( 3, festival, pass, asset( 2, ctt ), "", "" ); } ) );
+   CHECK( id_blocks_of( festival ) == 2 && id_blocks_of( event ) == 1 );
+
+   // an ask, a share and an auction with a held bid are open when the festival goes
+   CHECK( apply( { issuer }, [&]( nfts& c ){ c.listsale( 1, festival, pass, { 0 }, asset( 100, come ) ); } ) );
+   const auto expiration = time_point_sec( current_time_point() ) + 1000;
+   CHECK( apply( { issuer }, [&]( nfts& c ){ c.share( 2, 5, 3, expiration ); } ) );
+   CHECK( apply( { self }, [&]( nfts& c ){ c.createauctn( 3, festival, 9, asset( 5000, come ), asset( 10, come ), expiration ); } ) );
+   CHECK( apply( { self }, [&]( nfts& c ){ c.bid( 9, 1, asset( 300, come ) ); } ) );
+   CHECK( funds( 1 ) == deposit - 300 );
+
+   CHECK( !apply( { self }, [&]( nfts& c ){ c.purgeevent( festival, 10 ); } ) );
+   CHECK( error == "Event must be deleted before it is purged" );
+   CHECK( apply( { issuer }, [&]( nfts& c ){ c.deleteeve( festival ); } ) );
+
+   // nothing new may land behind the purge
+   CHECK( !apply( { issuer }, [&]( nfts& c ){ c.issue( 1, festival, pass, asset( 1, ctt ), "", "" ); } ) );
+   CHECK( error == "No event with this id" );
+   CHECK( !apply( { issuer }, [&]( nfts& c ){ c.listsale( 1, festival, pass, { 1 }, asset( 100, come ) ); } ) );
+   CHECK( error == "No event with this id" );
+   CHECK( !apply( { self }, [&]( nfts& c ){ c.createauctn( 3, festival, 10, asset( 5000, come ), asset( 10, come ), expiration ); } ) );
+   CHECK( error == "No event with this id" );
+   // nor split off the ranges
+   CHECK( !apply( { issuer }, [&]( nfts& c ){ c.transfer( 1, 2, { 2 }, "" ); } ) );
+   CHECK( error == "No event with this id" );
+
+   // two rows a call, the stages only go forward and every one of them is passed
+   std::vector<uint8_t> stages;
+   for( bool done = false; !done; ) {
+      nfts::purge_progress progress{};
+      CHECK( apply( { self }, [&]( nfts& c ){ progress = c.purgeevent( festival, 2 ); } ) );
+      CHECK( progress.erased <= 2 );
+      CHECK( stages.empty() || progress.stage >= stages.back() );
+      if( stages.empty() || progress.stage != stages.back() ) stages.push_back( progress.stage );
+      done = progress.done;
+      if( stages.size() > 100 ) break;
+   }
+   CHECK( stages.back() == nfts::PURGE_DONE );
+   CHECK( std::find( stages.begin(), stages.end(), nfts::PURGE_IDS ) != stages.end() );
+
+   // the bid is back and nothing of the festival is left
+   CHECK( funds( 1 ) == deposit );
+   CHECK( rows_in( "nftsv2"_n, festival ) == 0 && rows_in( "nftranges"_n, festival ) == 0 && rows_in( "nftstats"_n, festival ) == 0 );
+   CHECK( rows_in( "asks"_n, self.value ) == 0 && rows_in( "auctions"_n, self.value ) == 0 && rows_in( "sharednfts"_n, self.value ) == 0 );
+   CHECK( rows_in( "purges"_n, self.value ) == 0 );
+   CHECK( id_blocks_of( festival ) == 0 );
+   CHECK( passes( 1, pass_id ) == 0 && passes( 2, pass_id ) == 0 && passes( 3, pass_id ) == 0 );
+
+   // while the event is untouched and still trades
+   CHECK( id_blocks_of( event ) == 1 && balance( 1 ) == 3 && owner_of( 7 ) == 1 );
+   CHECK( apply( { issuer }, [&]( nfts& c ){ c.transfer( 1, 2, { 7 }, "" ); } ) );
+   CHECK( owner_of( 7 ) == 2 && balance( 2 ) == 1 );
+
+   return report();
+}
@@ -0,0 +1,138 @@
+// Queries: getinventory, getasks and getbids return the same rows in the same
+// order whatever the page size, each page resuming at the cursor of the one
+// before, and leave out what their filters exclude.
+
+#include "test.hpp"
+
+using namespace sim_test;
+
+namespace {
+
+   const uint64_t festival = 2;
+   const name pass = "pass"_n;
+
+   vector<uint64_t> inventory(uint64_t owner, uint32_t limit, std::optional<uint64_t> ev = std::nullopt) {
+      vector<uint64_t> ids;
+      std::optional<nfts::inventory_cursor> cursor = nfts::inventory_cursor{ 0, 0 };
+      while( cursor ) {
+         nfts::inventory_page page;
+         binary_extension<uint64_t> filter;
+         if( ev ) filter.emplace( *ev );
+         CHECK( apply( {}, [&]( nfts& c ){ page = c.getinventory( owner, cursor->nft_category_id, cursor->nft_id, limit, filter ); } ) );
+         CHECK( page.items.size() <= limit );
+         for( const auto& item : page.items ) ids.push_back( item.nft_id );
+         cursor = page.next;
+      }
+      return ids;
+   }
+
+   vector<uint64_t> asks(uint64_t ev, uint32_t limit) {
+      vector<uint64_t> batch_ids;
+      std::optional<nfts::ask_cursor> cursor = nfts::ask_cursor{ 0, 0 };
+      while( cursor ) {
+         nfts::ask_page page;
+         CHECK( apply( {}, [&]( nfts& c ){ page = c.getasks( ev, cursor->unit_price, cursor->batch_id, limit ); } ) );
+         CHECK( page.items.size() <= limit );
+         for( const auto& item : page.items ) batch_ids.push_back( item.batch_id );
+         cursor = page.next;
+      }
+      return batch_ids;
+   }
+
+   vector<uint64_t> bids(uint64_t bidder, uint32_t limit) {
+      vector<uint64_t> nft_ids;
+      std::optional<uint64_t> cursor = 0;
+      while( cursor ) {
+         nfts::bid_page page;
+         CHECK( apply( {}, [&]( nfts& c ){ page = c.getbids( bidder, *cursor, limit ); } ) );
+         CHECK( page.items.size() <= limit );
+         for( const auto& item : page.items ) nft_ids.push_back( item.auction.nft_id );
+         cursor = page.next;
+      }
+      return nft_ids;
+   }
+
+   uint64_t list(uint64_t seller, uint64_t ev, name nft_name, vector<uint64_t> nft_ids, int64_t unit_price) {
+      CHECK( apply( { issuer }, [&]( nfts& c ){
+         c.listsale( seller, ev, nft_name, nft_ids, asset( unit_price * int64_t( nft_ids.size() ), come ) );
+      } ) );
+      nfts::ask_index asks_table( self, self.value );
+      return std::prev( asks_table.end() )->batch_id;
+   }
+
+   bool auction(uint64_t seller, uint64_t ev, uint64_t nft_id) {
+      const auto expiration = time_point_sec( current_time_point() ) + 1000;
+      return apply( { self }, [&]( nfts& c ){ c.createauctn( seller, ev, nft_id, asset( 5000, come ), asset( 10, come ), expiration ); } );
+   }
+
+   bool bid(uint64_t nft_id, uint64_t bidder, int64_t price) {
+      return apply( { self }, [&]( nfts& c ){ c.bid( nft_id, bidder, asset( price, come ) ); } );
+   }
+
+}
+
+int main() {
+   setup( 3 );
+   CHECK( apply( { issuer }, [&]( nfts& c ){
+      c.createnft( issuer, festival, pass, true, true, true, asset( 1000, come ), 255, royalty_bps, "", asset( 100, ctt ) );
+   } ) );
+   // tickets 0-4, passes 5-6 and ticket 7 of user 1, tickets 8-11 of user 2
+   CHECK( apply( { issuer }, [&]( nfts& c ){ c.issue( 1, event, ticket, asset( 5, ctt ), "", "" ); } ) );
+   CHECK( apply( { issuer }, [&]( nfts& c ){ c.issue( 1, festival, pass, asset( 2, ctt ), "", "" ); } ) );
+   CHECK( apply( { issuer }, [&]( nfts& c ){ c.issue( 1, event, ticket, asset( 1, ctt ), "", "" ); } ) );
+   CHECK( apply( { issuer }, [&]( nfts& c ){ c.issue( 2, event, ticket, asset( 4, ctt ), "", "" ); } ) );
+
+   // an inventory is in category order, then id order across ranges and single rows, and an event keeps to its own
+   for( uint32_t limit : { 1, 2, 100 } ) {
+      CHECK( inventory( 1, limit ) == vector<uint64_t>( { 0, 1, 2, 3, 4, 7, 5, 6 } ) );
+      CHECK( inventory( 1, limit, festival ) == vector<uint64_t>( { 5, 6 } ) );
+      CHECK( inventory( 1, limit, event ) == vector<uint64_t>( { 0, 1, 2, 3, 4, 7 } ) );
+   }
+   CHECK( inventory( 3, 10 ).empty() );
+
+   // an auctioned nft shows its current price
+   CHECK( auction( 1, event, 3 ) && bid( 3, 2, 400 ) );
+   nfts::inventory_page page;
+   CHECK( apply( {}, [&]( nfts& c ){ page = c.getinventory( 1, 0, 3, 1, {} ); } ) );
+   CHECK( page.items.size() == 1 && page.items[0].nft_id == 3 && page.items[0].auction_price == asset( 400, come ) );
+   CHECK( page.items[0].nft_name == ticket && ( page.items[0].flags & nfts::NFT_AUCTIONED ) );
+
+   // asks of an event by unit price, then batch id, the expired ones left out
+   const uint64_t stale = list( 1, event, ticket, { 0 }, 100 );
+   sim::chain::get().advance( days( 8 ) );
+   const uint64_t pair = list( 2, event, ticket, { 8, 9 }, 300 );
+   const uint64_t cheap = list( 1, event, ticket, { 1 }, 200 );
+   const uint64_t later = list( 2, event, ticket, { 10 }, 300 );
+   const uint64_t passes = list( 1, festival, pass, { 5 }, 100 );
+   for( uint32_t limit : { 1, 2, 100 } ) {
+      CHECK( asks( event, limit ) == vector<uint64_t>( { cheap, pair, later } ) );
+      CHECK( asks( festival, limit ) == vector<uint64_t>( { passes } ) );
+   }
+   CHECK( stale < pair );
+   nfts::ask_page first;
+   CHECK( apply( {}, [&]( nfts& c ){ first = c.getasks( event, 0, 0, 1 ); } ) );
+   CHECK( first.items[0].nft_name == ticket && first.items[0].unit_price == asset( 200, come ) && first.items[0].nft_ids == vector<uint64_t>{ 1 } );
+   CHECK( first.next && first.next->unit_price == 300 && first.next->batch_id == pair );
+
+   // bids the bidder is winning, in nft id order
+   CHECK( auction( 1, event, 2 ) && bid( 2, 2, 300 ) );
+   CHECK( auction( 1, event, 4 ) && bid( 4, 3, 300 ) );
+   CHECK( auction( 1, event, 7 ) && bid( 7, 2, 300 ) );
+   CHECK( auction( 1, festival, 6 ) && bid( 6, 2, 300 ) );
+   for( uint32_t limit : { 1, 2, 100 } ) {
+      CHECK( bids( 2, limit ) == vector<uint64_t>( { 2, 3, 6, 7 } ) );
+      CHECK( bids( 3, limit ) == vector<uint64_t>( { 4 } ) );
+   }
+   // an outbid auction moves to the new bidder's list
+   CHECK( bid( 7, 3, 500 ) );
+   CHECK( bids( 2, 100 ) == vector<uint64_t>( { 2, 3, 6 } ) && bids( 3, 100 ) == vector<uint64_t>( { 4, 7 } ) );
+
+   CHECK( !apply( {}, [&]( nfts& c ){ c.getbids( 2, 0, 0 ); } ) );
+   CHECK( error == "limit must be positive" );
+   CHECK( !apply( {}, [&]( nfts& c ){ c.getasks( event, 0, 0, 0 ); } ) );
+   CHECK( error == "limit must be positive" );
+   CHECK( !apply( {}, [&]( nfts& c ){ c.getinventory( 1, 0, 0, 0, {} ); } ) );
+   CHECK( error == "limit must be positive" );
+
+   return report();
+}
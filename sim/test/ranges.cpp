@@ -0,0 +1,116 @@
+// Nft ranges: one row for the nfts of an issue, split around every nft that
+// is moved, with the serials and owners of the nfts it still holds unchanged.
+
+#include "test.hpp"
+
+using namespace sim_test;
+
+namespace {
+
+   struct range_row {
+      uint64_t first_id;
+      uint64_t count;
+      uint64_t first_serial;
+      uint64_t owner;
+
+      bool operator==(const range_row& other) const {
+         return first_id == other.first_id && count == other.count && first_serial == other.first_serial && owner == other.owner;
+      }
+   };
+
+   vector<range_row> ranges() {
+      vector<range_row> rows;
+      nfts::nft_range_index ranges_table( self, event );
+      for( const auto& r : ranges_table ) rows.push_back( { r.first_id, r.count, r.first_serial, r.owner } );
+      return rows;
+   }
+
+   vector<uint64_t> single_rows() {
+      vector<uint64_t> ids;
+      nfts::nft_index nfts_table( self, event );
+      for( const auto& n : nfts_table ) ids.push_back( n.id );
+      return ids;
+   }
+
+   bool transfer(uint64_t from, uint64_t to, uint64_t nft_id) {
+      return apply( { issuer }, [&]( nfts& c ){ c.transfer( from, to, { nft_id }, "" ); } );
+   }
+
+   // the ids of an owner, read page by page
+   vector<uint64_t> inventory(uint64_t owner, uint32_t limit) {
+      vector<uint64_t> ids;
+      std::optional<nfts::inventory_cursor> cursor = nfts::inventory_cursor{ 0, 0 };
+      while( cursor ) {
+         nfts::inventory_page page;
+         CHECK( apply( {}, [&]( nfts& c ){ page = c.getinventory( owner, cursor->nft_category_id, cursor->nft_id, limit, {} ); } ) );
+         CHECK( page.items.size() <= limit );
+         for( const auto& item : page.items ) ids.push_back( item.nft_id );
+         cursor = page.next;
+      }
+      return ids;
+   }
+
+}
+
+int main() {
+   setup( 2 );
+
+   CHECK( apply( { issuer }, [&]( nfts& c ){ c.issue( 1, event, ticket, asset( 10, ctt ), "", "" ); } ) );
+   CHECK( ranges() == vector<range_row>( { { 0, 10, 1, 1 } } ) );
+   CHECK( single_rows().empty() );
+
+   // an nft in the middle leaves a range on each side
+   CHECK( transfer( 1, 2, 4 ) );
+   CHECK( ranges() == vector<range_row>( { { 0, 4, 1, 1 }, { 5, 5, 6, 1 } } ) );
+   CHECK( single_rows() == vector<uint64_t>( { 4 } ) );
+
+   // the first and the last nft of a range shrink it
+   CHECK( transfer( 1, 2, 0 ) );
+   CHECK( transfer( 1, 2, 9 ) );
+   CHECK( transfer( 1, 2, 3 ) );
+   CHECK( ranges() == vector<range_row>( { { 1, 2, 2, 1 }, { 5, 4, 6, 1 } } ) );
+   CHECK( single_rows() == vector<uint64_t>( { 0, 3, 4, 9 } ) );
+
+   // an nft keeps its serial whether it is still in a range or not
+   for( uint64_t id = 0; id < 10; id++ ) {
+      auto nft = find_nft( id );
+      CHECK( nft && nft->serial_number == id + 1 );
+      CHECK( nft->owner == ( id == 0 || id == 3 || id == 4 || id == 9 ? 2 : 1 ) );
+   }
+   CHECK( balance( 1 ) == 6 && balance( 2 ) == 4 );
+
+   // an nft that left the range moves on its own row
+   CHECK( transfer( 2, 1, 4 ) && owner_of( 4 ) == 1 );
+   CHECK( transfer( 1, 2, 4 ) && owner_of( 4 ) == 2 );
+   CHECK( !transfer( 1, 2, 4 ) );
+   CHECK( error == "Must be the owner" );
+
+   // a single nft gets a row at once, more than one a range
+   CHECK( apply( { issuer }, [&]( nfts& c ){ c.issuemany( event, ticket, { { 1, 1 }, { 2, 3 } }, "", "" ); } ) );
+   CHECK( single_rows() == vector<uint64_t>( { 0, 3, 4, 9, 10 } ) );
+   CHECK( ranges() == vector<range_row>( { { 1, 2, 2, 1 }, { 5, 4, 6, 1 }, { 11, 3, 12, 2 } } ) );
+   CHECK( owner_of( 10 ) == 1 && find_nft( 10 )->serial_number == 11 );
+   CHECK( balance( 1 ) == 7 && balance( 2 ) == 7 );
+
+   // the inventory merges both in id order, whatever the page size
+   for( uint32_t limit : { 1, 3, 100 } ) {
+      CHECK( inventory( 1, limit ) == vector<uint64_t>( { 1, 2, 5, 6, 7, 8, 10 } ) );
+      CHECK( inventory( 2, limit ) == vector<uint64_t>( { 0, 3, 4, 9, 11, 12, 13 } ) );
+   }
+
+   // unsharing an nft that was never shared leaves its range whole
+   const auto before = ranges();
+   CHECK( apply( { issuer }, [&]( nfts& c ){ c.unshare( 6 ); } ) );
+   CHECK( apply( { issuer }, [&]( nfts& c ){ c.unsharemany( { 7, 12 } ); } ) );
+   CHECK( ranges() == before && single_rows() == vector<uint64_t>( { 0, 3, 4, 9, 10 } ) );
+
+   // a shared one is split off when it is shared, and unshared on its own row
+   CHECK( apply( { issuer }, [&]( nfts& c ){ c.share( 1, 6, 2, {} ); } ) );
+   CHECK( ( find_nft( 6 )->flags & nfts::NFT_SHARED ) && single_rows().size() == 6 );
+   CHECK( !apply( {}, [&]( nfts& c ){ c.unshare( 6 ); } ) );
+   CHECK( error == "missing authority of issuer" );
+   CHECK( apply( { issuer }, [&]( nfts& c ){ c.unshare( 6 ); } ) );
+   CHECK( !( find_nft( 6 )->flags & nfts::NFT_SHARED ) && owner_of( 6 ) == 1 );
+
+   return report();
+}
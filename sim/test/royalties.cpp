@@ -0,0 +1,81 @@
+// Royalties: every sale is split between the seller and the issuer in integer
+// basis points, the royalty rounded down. A category created before royalty_bps
+// keeps selling on its sale_split until migratesplit converts it, with the
+// issuer's signature since the larger row stays on the issuer's RAM.
+
+#include "test.hpp"
+
+using namespace sim_test;
+
+namespace {
+
+   const name legacy = "legacy"_n;
+
+   // sells nft_id of user 1 to user 2 for price, returns false when any step fails
+   bool sell(uint64_t nft_id, int64_t price) {
+      uint64_t batch_id = 0;
+      if( !apply( { issuer }, [&]( nfts& c ){
+         const auto name = find_nft( nft_id )->nft_category_id == category_id() ? ticket : legacy;
+         c.listsale( 1, event, name, { nft_id }, asset( price, come ) );
+         nfts::ask_index asks( self, self.value );
+         batch_id = std::prev( asks.end() )->batch_id;
+      } ) ) return false;
+      return apply( { self, issuer }, [&]( nfts& c ){ c.buy( 2, batch_id, "", {} ); } );
+   }
+
+   name payer_of_stats(name nft_name) {
+      const auto* store = sim::chain::get().find_store( self, event, "nftstats"_n );
+      return store->rows.at( nft_name.value ).payer;
+   }
+
+}
+
+int main() {
+   setup( 2 );
+   CHECK( !apply( { issuer }, [&]( nfts& c ){
+      c.createnft( issuer, event, "toomuch"_n, true, true, true, asset( 1000, come ), 255, 10001, "", asset( 10, ctt ) );
+   } ) );
+   CHECK( error == "Royalty must be between 0 and 10000 basis points" );
+
+   // 10% of 10.01 COME is 1.001, the issuer gets 1.00 and the seller the rest
+   CHECK( apply( { issuer }, [&]( nfts& c ){ c.issue( 1, event, ticket, asset( 3, ctt ), "", "" ); } ) );
+   CHECK( sell( 0, 1001 ) );
+   CHECK( royalties() == 100 && funds( 1 ) == deposit + 901 && funds( 2 ) == deposit - 1001 );
+
+   // a category as stored before royalty_bps: a quarter of every sale in sale_split
+   CHECK( apply( { issuer }, [&]( nfts& c ){
+      c.createnft( issuer, event, legacy, true, true, true, asset( 1000, come ), 255, 0, "", asset( 10, ctt ) );
+   } ) );
+   CHECK( sim::chain::get().apply( { self }, [&]{
+      nfts::stat_index stats( self, event );
+      stats.modify( stats.get( legacy.value ), same_payer, [&]( auto& s ){
+         s.sale_split = 0.25;
+         s.royalty_bps.reset();
+      } );
+   } ) );
+   CHECK( apply( { issuer }, [&]( nfts& c ){ c.issue( 1, event, legacy, asset( 2, ctt ), "", "" ); } ) );
+
+   // it sells on its split before the migration
+   CHECK( sell( 3, 1000 ) );
+   CHECK( royalties() == 100 + 250 && funds( 1 ) == deposit + 901 + 750 );
+
+   // the row grows on the issuer's RAM, which the contract alone cannot do
+   CHECK( !apply( { self }, [&]( nfts& c ){ c.migratesplit( event ); } ) );
+   CHECK( error == "missing authority of issuer" );
+   CHECK( apply( { self, issuer }, [&]( nfts& c ){ c.migratesplit( event ); } ) );
+   {
+      nfts::stat_index stats( self, event );
+      const auto& row = stats.get( legacy.value );
+      CHECK( row.royalty_bps.has_value() && *row.royalty_bps == 2500 && row.sale_split == 0 );
+      CHECK( *stats.get( ticket.value ).royalty_bps == royalty_bps );
+   }
+   CHECK( payer_of_stats( legacy ) == issuer );
+   // converted categories are left alone, the contract runs it again on its own
+   CHECK( apply( { self }, [&]( nfts& c ){ c.migratesplit( event ); } ) );
+
+   // and the same split after it
+   CHECK( sell( 4, 1000 ) );
+   CHECK( royalties() == 100 + 250 + 250 && funds( 1 ) == deposit + 901 + 750 + 750 );
+
+   return report();
+}
@@ -0,0 +1,92 @@
+// Event scopes: nfts are minted into the scope of their event, and the rows
+// left in the contract scope from before move there the first time an action
+// touches them or through migratescope. Rows whose category is gone are
+// dropped on the way, and no event is purged while any of them is left.
+
+#include "test.hpp"
+
+using namespace sim_test;
+
+namespace {
+
+   const uint64_t festival = 2;
+   const name pass = "pass"_n;
+
+   bool stored_in(uint64_t scope, uint64_t nft_id) {
+      nfts::nft_index nfts_table( self, scope );
+      return nfts_table.find( nft_id ) != nfts_table.end();
+   }
+
+   size_t unscoped() {
+      nfts::nft_index nfts_table( self, self.value );
+      return std::distance( nfts_table.begin(), nfts_table.end() );
+   }
+
+   // the event an id block says an nft is stored in
+   std::optional<uint64_t> block_of(uint64_t nft_id) {
+      nfts::range_index ranges( self, self.value );
+      auto range = ranges.upper_bound( nft_id );
+      if( range == ranges.begin() ) return std::nullopt;
+      --range;
+      if( nft_id >= range->first_id + range->count ) return std::nullopt;
+      return range->event;
+   }
+
+   // a compact row as written before event scopes
+   void unscoped_row(uint64_t nft_id, uint64_t nft_category_id) {
+      CHECK( sim::chain::get().apply( { self, issuer }, [&]{
+         nfts::nft_index nfts_table( self, self.value );
+         nfts_table.emplace( issuer, [&]( auto& n ){
+            n.id = nft_id; n.serial_number = nft_id; n.owner = 1; n.nft_category_id = nft_category_id; n.flags = 0;
+         } );
+      } ) );
+   }
+
+}
+
+int main() {
+   setup( 2 );
+   CHECK( apply( { issuer }, [&]( nfts& c ){
+      c.createnft( issuer, festival, pass, true, true, true, asset( 1000, come ), 255, royalty_bps, "", asset( 100, ctt ) );
+   } ) );
+
+   // issued nfts go to their event, the id blocks say which
+   CHECK( apply( { issuer }, [&]( nfts& c ){ c.issue( 1, event, ticket, asset( 1, ctt ), "", "" ); } ) );
+   CHECK( apply( { issuer }, [&]( nfts& c ){ c.issue( 1, festival, pass, asset( 1, ctt ), "", "" ); } ) );
+   CHECK( stored_in( event, 0 ) && stored_in( festival, 1 ) && !stored_in( self.value, 0 ) );
+   CHECK( block_of( 0 ) == event && block_of( 1 ) == festival );
+
+   // rows from before the scopes, one of a category that no longer exists
+   unscoped_row( 100, category_id() );
+   unscoped_row( 101, category_id() );
+   unscoped_row( 102, category_id() );
+   unscoped_row( 103, 77 );
+   CHECK( unscoped() == 4 && !block_of( 100 ) );
+
+   // a transfer moves its nft to the event before anything else
+   CHECK( apply( { issuer }, [&]( nfts& c ){ c.transfer( 1, 2, { 100 }, "" ); } ) );
+   CHECK( !stored_in( self.value, 100 ) && stored_in( event, 100 ) && block_of( 100 ) == event );
+   CHECK( owner_of( 100 ) == 2 && unscoped() == 3 );
+
+   // no purge leaves them behind
+   CHECK( apply( { issuer }, [&]( nfts& c ){ c.deleteeve( festival ); } ) );
+   CHECK( !apply( { self }, [&]( nfts& c ){ c.purgeevent( festival, 10 ); } ) );
+   CHECK( error == "NFTs stored before event scopes must be moved with migratescope first" );
+
+   // migratescope moves max_rows of them a call, on the contract's authority
+   CHECK( !apply( { issuer }, [&]( nfts& c ){ c.migratescope( 10 ); } ) );
+   CHECK( error == "missing authority of nfts" );
+   CHECK( !apply( { self }, [&]( nfts& c ){ c.migratescope( 0 ); } ) );
+   CHECK( error == "max_rows must be positive" );
+   CHECK( apply( { self }, [&]( nfts& c ){ c.migratescope( 2 ); } ) );
+   CHECK( unscoped() == 1 && stored_in( event, 101 ) && stored_in( event, 102 ) );
+   CHECK( block_of( 101 ) == event && block_of( 102 ) == event && owner_of( 101 ) == 1 );
+   CHECK( apply( { self }, [&]( nfts& c ){ c.migratescope( 2 ); } ) );
+   CHECK( unscoped() == 0 && !block_of( 103 ) );
+   CHECK( !stored_in( event, 103 ) && !stored_in( festival, 103 ) );
+
+   CHECK( apply( { self }, [&]( nfts& c ){ c.purgeevent( festival, 10 ); } ) );
+   CHECK( !stored_in( festival, 1 ) && stored_in( event, 0 ) );
+
+   return report();
+}
@@ -0,0 +1,84 @@
+// Shares: share and sharemany give nfts to another user until unshared or
+// until their expiration, a share may be moved or re-timed, and sweepshares
+// ends the expired ones in expiration order, max_rows at a time, for anyone.
+
+#include "test.hpp"
+
+using namespace sim_test;
+
+namespace {
+
+   std::optional<nfts::shared_nft> share_of(uint64_t nft_id) {
+      nfts::shared_index shared( self, self.value );
+      auto row = shared.find( nft_id );
+      if( row == shared.end() ) return std::nullopt;
+      return *row;
+   }
+
+   bool has_expiry(uint64_t nft_id) {
+      nfts::share_expiry_index expiry( self, self.value );
+      return expiry.find( nft_id ) != expiry.end();
+   }
+
+   bool shared(uint64_t nft_id) {
+      return find_nft( nft_id )->flags & nfts::NFT_SHARED;
+   }
+
+   time_point_sec in(uint32_t seconds) {
+      return time_point_sec( current_time_point() ) + seconds;
+   }
+
+   uint64_t sweep(uint64_t max_rows) {
+      uint64_t cleared = 0;
+      CHECK( apply( {}, [&]( nfts& c ){ cleared = c.sweepshares( max_rows ); } ) );
+      return cleared;
+   }
+
+}
+
+int main() {
+   setup( 3 );
+   CHECK( apply( { issuer }, [&]( nfts& c ){ c.issue( 1, event, ticket, asset( 6, ctt ), "", "" ); } ) );
+
+   CHECK( !apply( { issuer }, [&]( nfts& c ){ c.share( 1, 0, 1, {} ); } ) );
+   CHECK( error == "Cannot share to self" );
+   CHECK( !apply( { issuer }, [&]( nfts& c ){ c.share( 1, 0, 2, time_point_sec( current_time_point() ) ); } ) );
+   CHECK( error == "Share expiration must be in the future" );
+   CHECK( !apply( { caller }, [&]( nfts& c ){ c.share( 1, 0, 2, {} ); } ) );
+   CHECK( error == "missing authority of issuer" );
+
+   // a share without expiration lasts until unshared, one with it gets an expiry row
+   CHECK( apply( { issuer }, [&]( nfts& c ){ c.share( 1, 0, 2, {} ); } ) );
+   CHECK( shared( 0 ) && share_of( 0 )->shared_with == 2 && !has_expiry( 0 ) );
+   CHECK( apply( { issuer }, [&]( nfts& c ){ c.sharemany( 1, { 1, 2, 3 }, 2, in( 300 ) ); } ) );
+   CHECK( shared( 1 ) && shared( 3 ) && has_expiry( 1 ) && has_expiry( 3 ) );
+   CHECK( apply( { issuer }, [&]( nfts& c ){ c.share( 1, 4, 3, in( 100 ) ); } ) );
+
+   // a share is moved and re-timed in place: 0 gets an expiration, 2 loses its own
+   CHECK( apply( { issuer }, [&]( nfts& c ){ c.share( 1, 0, 3, in( 200 ) ); } ) );
+   CHECK( share_of( 0 )->shared_with == 3 && has_expiry( 0 ) );
+   CHECK( apply( { issuer }, [&]( nfts& c ){ c.share( 1, 2, 3, {} ); } ) );
+   CHECK( share_of( 2 )->shared_with == 3 && !has_expiry( 2 ) );
+
+   // unsharing ends the share and its expiry
+   CHECK( apply( { issuer }, [&]( nfts& c ){ c.unsharemany( { 3 } ); } ) );
+   CHECK( !shared( 3 ) && !share_of( 3 ) && !has_expiry( 3 ) );
+   CHECK( !apply( { issuer }, [&]( nfts& c ){ c.unsharemany( {} ); } ) );
+   CHECK( error == "No NFTs to unshare" );
+
+   // expired shares end earliest first: 4 at 100, 0 at 200, 1 at 300
+   CHECK( sweep( 10 ) == 0 );
+   sim::chain::get().advance( seconds( 250 ) );
+   CHECK( sweep( 1 ) == 1 && !shared( 4 ) && !share_of( 4 ) && !has_expiry( 4 ) && shared( 0 ) );
+   CHECK( sweep( 10 ) == 1 && !shared( 0 ) && shared( 1 ) && has_expiry( 1 ) );
+   sim::chain::get().advance( seconds( 100 ) );
+   CHECK( sweep( 10 ) == 1 && !shared( 1 ) );
+   CHECK( shared( 2 ) && share_of( 2 )->shared_with == 3 );
+   CHECK( !apply( {}, [&]( nfts& c ){ c.sweepshares( 0 ); } ) );
+   CHECK( error == "max_rows must be positive" );
+
+   // an nft whose share ended moves as any other
+   CHECK( apply( { issuer }, [&]( nfts& c ){ c.transfer( 1, 2, { 4 }, "" ); } ) && owner_of( 4 ) == 2 );
+
+   return report();
+}
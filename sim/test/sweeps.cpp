@@ -0,0 +1,72 @@
+// Expired asks: sweepasks closes them in expiration order, at most max_rows per
+// call and with no authority, unlocks their nfts for the seller and leaves the
+// asks that still run alone. An ask whose nfts are gone is closed like any other.
+
+#include "test.hpp"
+
+using namespace sim_test;
+
+namespace {
+
+   // the batch id of the new ask
+   uint64_t list(vector<uint64_t> nft_ids) {
+      CHECK( apply( { issuer }, [&]( nfts& c ){
+         c.listsale( 1, event, ticket, nft_ids, asset( 100 * int64_t( nft_ids.size() ), come ) );
+      } ) );
+      return find_nft( nft_ids[0] )->listed_in.value_or( 0 );
+   }
+
+   uint64_t sweep(uint64_t max_rows) {
+      uint64_t cleared = 0;
+      CHECK( apply( {}, [&]( nfts& c ){ cleared = c.sweepasks( max_rows ); } ) );
+      return cleared;
+   }
+
+   bool listed(uint64_t nft_id) {
+      const auto nft = find_nft( nft_id );
+      return ( nft->flags & nfts::NFT_LISTED ) || nft->listed_in.has_value();
+   }
+
+   uint64_t active_asks() {
+      nfts::market_index markets( self, self.value );
+      return markets.get( event ).active_asks;
+   }
+
+}
+
+int main() {
+   setup( 2 );
+   CHECK( apply( { issuer }, [&]( nfts& c ){ c.issue( 1, event, ticket, asset( 8, ctt ), "", "" ); } ) );
+
+   // asks run for a week from their listing
+   const uint64_t first = list( { 0, 1 } );
+   sim::chain::get().advance( seconds( 3600 ) );
+   const uint64_t second = list( { 2 } );
+   const uint64_t third = list( { 3 } );
+   sim::chain::get().advance( days( 7 ) - seconds( 1800 ) );
+   const uint64_t later = list( { 4 } );
+   CHECK( sweep( 10 ) == 1 );
+   CHECK( !find_ask( first ) && find_ask( second ) && find_ask( third ) );
+   CHECK( !listed( 0 ) && !listed( 1 ) && listed( 2 ) );
+   CHECK( owner_of( 0 ) == 1 && active_asks() == 3 );
+
+   // the nft of an expired ask is gone, the sweep closes the ask and goes on
+   CHECK( sim::chain::get().apply( { self }, [&]{
+      nfts::nft_index nfts_table( self, event );
+      nfts_table.erase( nfts_table.get( 2 ) );
+   } ) );
+   sim::chain::get().advance( seconds( 3600 ) );
+   CHECK( sweep( 1 ) == 1 && !find_ask( second ) && find_ask( third ) );
+   CHECK( sweep( 1 ) == 1 && !find_ask( third ) && !listed( 3 ) );
+
+   // nothing else has expired, anyone may run it anyway
+   CHECK( sweep( 10 ) == 0 && find_ask( later ) && listed( 4 ) );
+   CHECK( active_asks() == 1 );
+   CHECK( !apply( {}, [&]( nfts& c ){ c.sweepasks( 0 ); } ) );
+   CHECK( error == "max_rows must be positive" );
+
+   // an unlocked nft is listed again
+   CHECK( list( { 0 } ) != first );
+
+   return report();
+}
@@ -0,0 +1,132 @@
+// Harness of the contract tests, which run the contract natively on sim::chain
+// like workload.cpp. Every test is its own program on a fresh chain: it sends
+// actions with apply, asserts with CHECK and returns the number of failed checks.
+
+#pragma once
+
+#include <nfts.hpp>
+#include <sim/chain.hpp>
+
+#include <cstdio>
+#include <optional>
+#include <string>
+#include <vector>
+
+using namespace eosio;
+
+namespace sim_test {
+
+   const name self = "nfts"_n;
+   const name issuer = "issuer"_n;
+   const name caller = "caller"_n;
+   const name token = "come.token"_n;
+   const symbol ctt = symbol( "CTT", 0 );
+   const symbol come = symbol( "COME", 2 );
+
+   // category of the tests, set up by setup
+   const uint64_t event = 1;
+   const name ticket = "ticket"_n;
+   const uint16_t royalty_bps = 1000;
+   const int64_t deposit = 1000000;
+
+   inline int failures = 0;
+   // reason of the last rejected action
+   inline std::string error;
+
+   #define CHECK( cond ) \
+      do { \
+         if( !(cond) ) { \
+            sim_test::failures++; \
+            std::fprintf( stderr, "%s:%d: check failed: %s (last error: %s)\n", __FILE__, __LINE__, #cond, sim_test::error.c_str() ); \
+         } \
+      } while( 0 )
+
+   // Runs body as one action with the given authorities and rolls it back when it aborts,
+   // code is the first receiver, the token contract for deposit notifications
+   template<typename F>
+   bool apply(std::vector<name> auths, F&& body, name code = self) {
+      error.clear();
+      return sim::chain::get().apply( std::move( auths ), [&]{
+         nfts contract( self, code, datastream<const char*>( nullptr, 0 ) );
+         body( contract );
+      }, &error );
+   }
+
+   // Configures the COME token, registers users 1..users with deposit COME each and creates
+   // the transferable and sellable category ticket of event
+   inline void setup(uint64_t users) {
+      CHECK( apply( { self }, [&]( nfts& c ){ c.setconfig( "test", token ); } ) );
+      for( uint64_t u = 1; u <= users; u++ ) {
+         CHECK( apply( { caller }, [&]( nfts& c ){ c.createacc( u, checksum256(), caller ); } ) );
+         CHECK( apply( { token }, [&]( nfts& c ){ c.deposit( caller, self, asset( deposit, come ), std::to_string( u ) ); }, token ) );
+      }
+      CHECK( apply( { issuer }, [&]( nfts& c ){
+         c.createnft( issuer, event, ticket, true, true, true, asset( 1000, come ), 255, royalty_bps,
+                      "https://example.com/", asset( 1000000, ctt ) );
+      } ) );
+   }
+
+   // The readers below open their tables on every call: a multi_index keeps the rows it
+   // loaded, as on chain, and would not see the writes of later actions
+
+   inline uint64_t category_id() {
+      nfts::stat_index stats( self, event );
+      return stats.get( ticket.value ).nft_category_id;
+   }
+
+   // COME held for a user by the contract
+   inline int64_t funds(uint64_t user) {
+      nfts::user_funds_index funds_table( self, self.value );
+      auto row = funds_table.find( user );
+      return row == funds_table.end() ? 0 : row->balance.amount;
+   }
+
+   inline int64_t royalties() {
+      nfts::issuer_funds_index royalties_table( self, self.value );
+      auto row = royalties_table.find( issuer.value );
+      return row == royalties_table.end() ? 0 : row->balance.amount;
+   }
+
+   // tickets held by a user
+   inline int64_t balance(uint64_t user) {
+      nfts::account_index accounts( self, user );
+      auto row = accounts.find( category_id() );
+      return row == accounts.end() ? 0 : row->amount.amount;
+   }
+
+   // An nft of event, from its own row or from the range it is still part of
+   inline std::optional<nfts::nft> find_nft(uint64_t nft_id) {
+      nfts::nft_index nfts_table( self, event );
+      auto row = nfts_table.find( nft_id );
+      if( row != nfts_table.end() ) return *row;
+      nfts::nft_range_index ranges( self, event );
+      auto range = ranges.upper_bound( nft_id );
+      if( range == ranges.begin() ) return std::nullopt;
+      --range;
+      if( nft_id >= range->first_id + range->count ) return std::nullopt;
+      return range->member( nft_id );
+   }
+
+   inline uint64_t owner_of(uint64_t nft_id) {
+      auto nft = find_nft( nft_id );
+      return nft ? nft->owner : 0;
+   }
+
+   inline std::optional<nfts::ask> find_ask(uint64_t batch_id) {
+      nfts::ask_index asks( self, self.value );
+      auto row = asks.find( batch_id );
+      if( row == asks.end() ) return std::nullopt;
+      return *row;
+   }
+
+   inline bool no_asks() {
+      nfts::ask_index asks( self, self.value );
+      return asks.begin() == asks.end();
+   }
+
+   inline int report() {
+      if( failures ) std::fprintf( stderr, "%d checks failed\n", failures );
+      return failures;
+   }
+
+} // namespace sim_test
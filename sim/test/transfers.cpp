@@ -0,0 +1,95 @@
+// Transfers: the balances of a multi-nft transfer move once per category, the
+// sender's row going away when it reaches zero, and an nft the sender does not
+// own or may not move aborts the transfer with no balance touched. Categories
+// are read once per action, and every issuer of the nfts moved must sign.
+
+#include "test.hpp"
+
+using namespace sim_test;
+
+namespace {
+
+   const name vip = "vip"_n;
+   const name promoter = "promoter"_n;
+   const name merch = "merch"_n;
+   const uint64_t fair = 2;
+
+   int64_t held(uint64_t user, name nft_name, uint64_t ev = event) {
+      nfts::stat_index stats( self, ev );
+      nfts::account_index accounts( self, user );
+      auto row = accounts.find( stats.get( nft_name.value ).nft_category_id );
+      return row == accounts.end() ? -1 : row->amount.amount;
+   }
+
+   bool transfer(uint64_t from, uint64_t to, vector<uint64_t> nft_ids) {
+      return apply( { issuer }, [&]( nfts& c ){ c.transfer( from, to, nft_ids, "" ); } );
+   }
+
+   // reads and writes of a table in any scope, counted by the chain
+   sim::db_counters counters(name table) {
+      const auto& tables = sim::chain::get().per_table();
+      auto itr = tables.find( table.value );
+      return itr == tables.end() ? sim::db_counters{} : itr->second;
+   }
+
+   sim::db_counters balance_writes() {
+      return counters( "accounts"_n );
+   }
+
+}
+
+int main() {
+   setup( 3 );
+   CHECK( apply( { issuer }, [&]( nfts& c ){
+      c.createnft( issuer, event, vip, true, true, false, asset( 1000, come ), 255, royalty_bps, "", asset( 100, ctt ) );
+   } ) );
+   // tickets 0-3 and vip 4-5 of user 1, ticket 6 of user 2
+   CHECK( apply( { issuer }, [&]( nfts& c ){ c.issue( 1, event, ticket, asset( 4, ctt ), "", "" ); } ) );
+   CHECK( apply( { issuer }, [&]( nfts& c ){ c.issue( 1, event, vip, asset( 2, ctt ), "", "" ); } ) );
+   CHECK( apply( { issuer }, [&]( nfts& c ){ c.issue( 2, event, ticket, asset( 1, ctt ), "", "" ); } ) );
+
+   // three tickets to a holder: one write for each of the two balances
+   auto before = balance_writes();
+   CHECK( transfer( 1, 2, { 2, 0, 3 } ) );
+   auto writes = balance_writes() - before;
+   CHECK( writes.modifies == 2 && writes.emplaces == 0 && writes.erases == 0 );
+   CHECK( held( 1, ticket ) == 1 && held( 2, ticket ) == 4 );
+   CHECK( owner_of( 0 ) == 2 && owner_of( 2 ) == 2 && owner_of( 3 ) == 2 && owner_of( 1 ) == 1 );
+
+   // the last ticket of the sender: its row goes, the receiver's is created
+   before = balance_writes();
+   CHECK( transfer( 1, 3, { 1 } ) );
+   writes = balance_writes() - before;
+   CHECK( writes.erases == 1 && writes.emplaces == 1 && writes.modifies == 0 );
+   CHECK( held( 1, ticket ) == -1 && held( 3, ticket ) == 1 );
+
+   // nothing moves when one nft of the list cannot
+   CHECK( !transfer( 2, 3, { 0, 1 } ) );
+   CHECK( error == "Must be the owner" );
+   CHECK( !transfer( 1, 3, { 4 } ) );
+   CHECK( error == "Not transferable" );
+   CHECK( !transfer( 2, 2, { 0 } ) );
+   CHECK( error == "Cannot transfer NFT to self" );
+   CHECK( !transfer( 2, 3, { 0, 0 } ) );
+   CHECK( owner_of( 0 ) == 2 && held( 2, ticket ) == 4 && held( 3, ticket ) == 1 && held( 1, vip ) == 2 );
+
+   // the category of the nfts is read as often for four of them as for one
+   before = counters( "categories"_n );
+   CHECK( transfer( 3, 1, { 1 } ) );
+   const uint64_t one = ( counters( "categories"_n ) - before ).reads;
+   before = counters( "categories"_n );
+   CHECK( transfer( 2, 1, { 0, 2, 3, 6 } ) );
+   CHECK( one > 0 && ( counters( "categories"_n ) - before ).reads == one );
+
+   // nfts of two issuers move together when both sign, 7 is the merch of user 1 from the promoter's own event
+   CHECK( apply( { promoter }, [&]( nfts& c ){
+      c.createnft( promoter, fair, merch, true, true, true, asset( 1000, come ), 255, royalty_bps, "", asset( 100, ctt ) );
+   } ) );
+   CHECK( apply( { promoter }, [&]( nfts& c ){ c.issue( 1, fair, merch, asset( 1, ctt ), "", "" ); } ) );
+   CHECK( !transfer( 1, 2, { 0, 7, 2 } ) );
+   CHECK( error == "missing authority of promoter" );
+   CHECK( apply( { issuer, promoter }, [&]( nfts& c ){ c.transfer( 1, 2, { 0, 7, 2 }, "" ); } ) );
+   CHECK( held( 2, merch, fair ) == 1 && held( 1, merch, fair ) == -1 && held( 2, ticket ) == 2 );
+
+   return report();
+}
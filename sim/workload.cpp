@@ -0,0 +1,347 @@
+// Load generator for the nfts contract running natively on sim::chain.
+//
+// The contract sources are compiled unchanged against the in-memory stand-ins
+// of sim/include, so every action runs its real logic while the simulated
+// chain counts database reads, writes and bytes. The generator keeps its own
+// model of who owns which nft and which asks and auctions are open, so most
+// of the traffic it sends succeeds; rejected actions are rolled back and
+// counted as failures.
+//
+//   nfts_workload --users 100000 --ops 2000000 --mix issue=20,transfer=30,list=20,buy=20,bid=10
+//
+// Prints the throughput, the database operations per action and, every
+// --report-every operations, the rows and billed bytes of the main tables.
+
+#include <nfts.hpp>
+#include <sim/chain.hpp>
+
+#include <chrono>
+#include <cstdio>
+#include <cstdlib>
+#include <cstring>
+#include <random>
+#include <string>
+#include <unordered_map>
+#include <vector>
+
+using namespace eosio;
+
+namespace {
+
+   const name self = "nfts"_n;
+   const name issuer = "issuer"_n;
+   const name caller = "caller"_n;
+   const name token = "come.token"_n;
+   const symbol ctt = symbol( "CTT", 0 );
+   const symbol come = symbol( "COME", 2 );
+
+   struct options {
+      uint64_t users = 1000;
+      uint64_t events = 10;
+      uint64_t ops = 100000;
+      uint64_t report_every = 0; // 0 reports the tables once, at the end
+      uint64_t max_issue = 10; // nfts per issue, ranges are used above one
+      uint64_t seed = 1;
+      // weights of the operations
+      uint64_t issue = 20, transfer = 30, list = 20, buy = 20, bid = 10;
+   };
+
+   struct action_stats {
+      uint64_t calls = 0;
+      uint64_t failures = 0;
+      sim::db_counters db;
+      double seconds = 0;
+   };
+
+   struct ask_model {
+      uint64_t batch_id;
+      uint64_t seller;
+      uint64_t event;
+      vector<uint64_t> nft_ids;
+   };
+
+   struct auction_model {
+      uint64_t nft_id;
+      uint64_t seller;
+      int64_t price; // current bid, 0 without bids
+   };
+
+   class workload {
+     public:
+      explicit workload(const options& opts) : opts( opts ), rng( opts.seed ) {}
+
+      void run() {
+         setup();
+         const uint64_t total = opts.issue + opts.transfer + opts.list + opts.buy + opts.bid;
+         if( total == 0 ) {
+            fprintf( stderr, "the operation mix is empty\n" );
+            exit( 2 );
+         }
+
+         const auto start = std::chrono::steady_clock::now();
+         for( uint64_t op = 1; op <= opts.ops; op++ ) {
+            sim::chain::get().advance( eosio::microseconds( 10000 ) );
+            uint64_t pick = uniform( total );
+            if( pick < opts.issue ) issue();
+            else if( (pick -= opts.issue) < opts.transfer ) transfer();
+            else if( (pick -= opts.transfer) < opts.list ) list();
+            else if( (pick -= opts.list) < opts.buy ) buy();
+            else bid();
+
+            if( opts.report_every && op % opts.report_every == 0 ) report_tables( op );
+         }
+         const double seconds = std::chrono::duration<double>( std::chrono::steady_clock::now() - start ).count();
+
+         report_actions( seconds );
+         if( !opts.report_every || opts.ops % opts.report_every ) report_tables( opts.ops );
+      }
+
+     private:
+      template <typename F>
+      bool apply(const char* action, vector<name> auths, F&& body) {
+         return apply( action, self, std::move( auths ), std::forward<F>( body ) );
+      }
+
+      // code is the first receiver, the token contract for deposit notifications
+      template <typename F>
+      bool apply(const char* action, name code, vector<name> auths, F&& body) {
+         auto& chain = sim::chain::get();
+         auto& stats = actions[action];
+         const auto before = chain.totals();
+         const auto start = std::chrono::steady_clock::now();
+         bool ok = chain.apply( std::move( auths ), [&]{
+            nfts contract( self, code, datastream<const char*>( nullptr, 0 ) );
+            body( contract );
+         }, &error );
+         stats.seconds += std::chrono::duration<double>( std::chrono::steady_clock::now() - start ).count();
+         stats.calls++;
+         stats.failures += !ok;
+         stats.db += chain.totals() - before;
+         return ok;
+      }
+
+      uint64_t uniform(uint64_t n) { return std::uniform_int_distribution<uint64_t>( 0, n - 1 )( rng ); }
+      uint64_t user() { return uniform( opts.users ) + 1; }
+      uint64_t event() { return uniform( opts.events ) + 1; }
+
+      void setup() {
+         apply( "setconfig", { self }, [&]( nfts& c ){ c.setconfig( "sim", token ); } );
+         for( uint64_t u = 1; u <= opts.users; u++ ) {
+            apply( "createacc", { caller }, [&]( nfts& c ){ c.createacc( u, checksum256(), caller ); } );
+            // enough COME that no purchase or bid runs out of funds
+            apply( "deposit", token, { token }, [&]( nfts& c ){ c.deposit( caller, self, asset( 1000000000000, come ), std::to_string( u ) ); } );
+         }
+         for( uint64_t e = 1; e <= opts.events; e++ ) {
+            apply( "createnft", { issuer }, [&]( nfts& c ){
+               c.createnft( issuer, e, "ticket"_n, true, true, true, asset( 1000, come ), 255, 1000,
+                            "https://example.com/", asset( 1000000000000, ctt ) );
+            } );
+         }
+         owned.resize( opts.users + 1 );
+      }
+
+      // nfts of a user that are neither listed nor auctioned
+      vector<uint64_t>& free_nfts(uint64_t u) { return owned[u]; }
+
+      void take(uint64_t u, uint64_t nft_id) {
+         auto& ids = owned[u];
+         ids.erase( std::find( ids.begin(), ids.end(), nft_id ) );
+      }
+
+      void issue() {
+         const uint64_t to = user(), ev = event(), quantity = uniform( opts.max_issue ) + 1;
+         auto& held = holdings[to * (opts.events + 1) + ev];
+         if( held + quantity > 255 ) return;
+         if( apply( "issue", { issuer }, [&]( nfts& c ){ c.issue( to, ev, "ticket"_n, asset( quantity, ctt ), "", "" ); } ) ) {
+            // ids are handed out in sequence, one block per issue
+            for( uint64_t i = 0; i < quantity; i++ ) {
+               owned[to].push_back( next_id + i );
+               event_of[next_id + i] = ev;
+            }
+            next_id += quantity;
+            held += quantity;
+         }
+      }
+
+      void transfer() {
+         const uint64_t from = user(), to = user();
+         auto& ids = free_nfts( from );
+         if( from == to || ids.empty() ) return;
+         vector<uint64_t> batch( ids.end() - std::min<size_t>( ids.size(), uniform( 3 ) + 1 ), ids.end() );
+         if( apply( "transfer", { issuer }, [&]( nfts& c ){ c.transfer( from, to, batch, "" ); } ) ) {
+            move( from, to, batch );
+         }
+      }
+
+      void list() {
+         const uint64_t seller = user();
+         auto& ids = free_nfts( seller );
+         if( ids.empty() ) return;
+         // one category per event, so the batch is the nfts of one event
+         const uint64_t ev = event_of[ids.back()];
+         vector<uint64_t> batch;
+         for( auto itr = ids.rbegin(); itr != ids.rend() && batch.size() <= uniform( 3 ); itr++ ) {
+            if( event_of[*itr] == ev ) batch.push_back( *itr );
+         }
+         const asset price( int64_t( 1000 * batch.size() ), come );
+         if( apply( "listsale", { issuer }, [&]( nfts& c ){ c.listsale( seller, ev, "ticket"_n, batch, price ); } ) ) {
+            for( auto id : batch ) take( seller, id );
+            asks.push_back( ask_model{ next_batch_id++, seller, ev, batch } );
+         }
+      }
+
+      void buy() {
+         if( asks.empty() ) return;
+         const size_t pick = uniform( asks.size() );
+         const auto ask = asks[pick];
+         const uint64_t to = user();
+         if( to == ask.seller ) return;
+         if( apply( "buy", { self, issuer }, [&]( nfts& c ){ c.buy( to, ask.batch_id, "", {} ); } ) ) {
+            for( auto id : ask.nft_ids ) owned[to].push_back( id );
+            asks[pick] = asks.back();
+            asks.pop_back();
+         }
+      }
+
+      // opens an auction, or bids on an open one; a bid at the target price buys the nft
+      void bid() {
+         if( auctions.empty() || uniform( 4 ) == 0 ) {
+            const uint64_t seller = user();
+            auto& ids = free_nfts( seller );
+            if( ids.empty() ) return;
+            const uint64_t nft_id = ids.back();
+            const auto expiration = time_point_sec( current_time_point() ) + 30 * 86400;
+            if( apply( "createauctn", { self }, [&]( nfts& c ){
+                  c.createauctn( seller, event_of[nft_id], nft_id, asset( 10000, come ), asset( 100, come ), expiration );
+                } ) ) {
+               take( seller, nft_id );
+               auctions.push_back( auction_model{ nft_id, seller, 0 } );
+            }
+            return;
+         }
+
+         const size_t pick = uniform( auctions.size() );
+         auto& auction = auctions[pick];
+         const uint64_t bidder = user();
+         if( bidder == auction.seller ) return;
+         const bool instant = uniform( 10 ) == 0;
+         const asset price( instant ? 10000 : std::max<int64_t>( auction.price + 100, 200 ), come );
+         if( apply( "bid", { self, issuer }, [&]( nfts& c ){ c.bid( auction.nft_id, bidder, price ); } ) ) {
+            if( price.amount >= 10000 ) {
+               owned[bidder].push_back( auction.nft_id );
+               auctions[pick] = auctions.back();
+               auctions.pop_back();
+            } else {
+               auction.price = price.amount;
+            }
+         }
+      }
+
+      void move(uint64_t from, uint64_t to, const vector<uint64_t>& batch) {
+         for( auto id : batch ) {
+            take( from, id );
+            owned[to].push_back( id );
+         }
+      }
+
+      void report_actions(double seconds) const {
+         // setup actions run before the clock starts
+         uint64_t calls = 0;
+         for( const auto& [action, stats] : actions ) calls += stats.calls;
+         calls -= setup_calls();
+         printf( "\n%lu actions in %.2f s, %.0f actions/s\n\n", calls, seconds, seconds > 0 ? calls / seconds : 0.0 );
+         printf( "%-12s %10s %8s %10s %9s %9s %9s %11s %11s %9s\n", "action", "calls", "failed", "us/call", "reads", "emplaces",
+                 "modifies", "erases", "bytes read", "bytes wr" );
+         for( const auto& [action, stats] : actions ) {
+            const double n = double( stats.calls );
+            printf( "%-12s %10lu %8lu %10.2f %9.2f %9.2f %9.2f %11.2f %11.1f %9.1f\n", action.c_str(), stats.calls, stats.failures,
+                    stats.seconds * 1e6 / n, stats.db.reads / n, stats.db.emplaces / n, stats.db.modifies / n, stats.db.erases / n,
+                    stats.db.bytes_read / n, stats.db.bytes_written / n );
+         }
+         if( !error.empty() ) printf( "\nlast failure: %s\n", error.c_str() );
+      }
+
+      uint64_t setup_calls() const {
+         uint64_t calls = 0;
+         for( const char* action : { "setconfig", "createacc", "deposit", "createnft" } ) {
+            auto itr = actions.find( action );
+            if( itr != actions.end() ) calls += itr->second.calls;
+         }
+         return calls;
+      }
+
+      void report_tables(uint64_t op) const {
+         printf( "\nafter %lu operations:\n", op );
+         for( auto table : { "nftsv2"_n, "nftranges"_n, "idranges"_n, "accounts"_n, "asks"_n, "auctions"_n, "userfunds"_n, "royalties"_n, "markets"_n, "livebids"_n, "eventmetrics"_n, "tablecounts"_n, "payermetrics"_n } ) {
+            auto [rows, bytes] = sim::chain::get().table_usage( table );
+            printf( "  %-12s %12lu rows %14ld bytes\n", table.to_string().c_str(), rows, bytes );
+         }
+      }
+
+      options opts;
+      std::mt19937_64 rng;
+      std::map<std::string, action_stats> actions;
+      std::string error;
+
+      uint64_t next_id = 0;
+      uint64_t next_batch_id = 0;
+      vector<vector<uint64_t>> owned;
+      std::unordered_map<uint64_t, uint64_t> event_of;
+      std::unordered_map<uint64_t, uint64_t> holdings; // issued per (user, event), max_per_account is 255
+      vector<ask_model> asks;
+      vector<auction_model> auctions;
+   };
+
+   void usage(const char* program) {
+      fprintf( stderr,
+               "usage: %s [--users N] [--events N] [--ops N] [--report-every N] [--max-issue N] [--seed N]\n"
+               "          [--mix issue=W,transfer=W,list=W,buy=W,bid=W]\n", program );
+      exit( 2 );
+   }
+
+   void parse_mix(const char* program, const std::string& mix, options& opts) {
+      opts.issue = opts.transfer = opts.list = opts.buy = opts.bid = 0;
+      size_t start = 0;
+      while( start < mix.size() ) {
+         size_t end = mix.find( ',', start );
+         if( end == std::string::npos ) end = mix.size();
+         const std::string item = mix.substr( start, end - start );
+         const size_t eq = item.find( '=' );
+         if( eq == std::string::npos ) usage( program );
+         const std::string key = item.substr( 0, eq );
+         const uint64_t weight = std::strtoull( item.c_str() + eq + 1, nullptr, 10 );
+         if( key == "issue" ) opts.issue = weight;
+         else if( key == "transfer" ) opts.transfer = weight;
+         else if( key == "list" ) opts.list = weight;
+         else if( key == "buy" ) opts.buy = weight;
+         else if( key == "bid" ) opts.bid = weight;
+         else usage( program );
+         start = end + 1;
+      }
+   }
+
+} // namespace
+
+int main(int argc, char** argv) {
+   options opts;
+   for( int i = 1; i < argc; i++ ) {
+      if( i + 1 == argc ) usage( argv[0] );
+      const std::string flag = argv[i];
+      const char* value = argv[++i];
+      if( flag == "--mix" ) {
+         parse_mix( argv[0], value, opts );
+         continue;
+      }
+      const uint64_t number = std::strtoull( value, nullptr, 10 );
+      if( flag == "--users" && number > 0 ) opts.users = number;
+      else if( flag == "--events" && number > 0 ) opts.events = number;
+      else if( flag == "--ops" ) opts.ops = number;
+      else if( flag == "--report-every" ) opts.report_every = number;
+      else if( flag == "--max-issue" && number > 0 && number <= 255 ) opts.max_issue = number;
+      else if( flag == "--seed" ) opts.seed = number;
+      else usage( argv[0] );
+   }
+
+   workload( opts ).run();
+   return 0;
+}
@@ -1,29 +1,40 @@
 #include <nfts.hpp>
 
-ACTION nfts::setconfig(string version)
+#include <algorithm>
+
+ACTION nfts::setconfig(string version, binary_extension<name> token_contract)
 {
+  count_action( "setconfig"_n );
   require_auth(get_self());
 
   // can only have one symbol per contract
   config_index config_table(get_self(), get_self().value);
-  auto config_singleton = config_table.get_or_create( get_self(), tokenconfigs{ "cometogether"_n, version, 0 } );
+  auto config_singleton = config_table.get_or_create( get_self(), tokenconfigs{ "cometogether"_n, version, 0, {}, {}, {} } );
 
   // setconfig will always update version when called
   config_singleton.version = version;
+  if( token_contract.has_value() ) {
+    check( is_account( *token_contract ), "Token contract account does not exist" );
+    // extensions are packed in order, next_nft_id must be present before token_contract
+    init_next_nft_id( config_singleton );
+    config_singleton.token_contract.emplace( *token_contract );
+  }
   config_table.set( config_singleton, get_self() );
 }
 
 ACTION nfts::createacc(uint64_t id, checksum256 signature, name caller) 
 {
   require_auth(caller);
+  count_action( "createacc"_n );
 
   user_index user_table(get_self(), get_self().value );
   auto user_id = user_table.find(id);
   check( user_id == user_table.end(), "This id already exists");
-    user_table.emplace( caller, [&]( auto& u ){
+    auto created = user_table.emplace( caller, [&]( auto& u ){
         u.id = id;
         u.signature = signature;
     });
+    count_row( "users"_n, caller, get_self().value, row_bytes( *created, 0 ) );
 }
 
 ACTION nfts::createnft(name issuer,
@@ -34,19 +45,22 @@ ACTION nfts::createnft(name issuer,
                        bool transferable,
                        asset price,
                        uint8_t max_per_account,
-                       double sale_split,
+                       uint16_t royalty_bps,
                        string base_uri,
                        asset max_supply)
 {
+    count_action( "createnft"_n );
     require_auth( issuer );
 
     check( max_per_account > 0, "Max NFTs per account should be greaten than zero");
     check( price.amount > 0, "Price amount must be positive" );
-    check( price.symbol == symbol( symbol_code("COME"), 2), "Price must be in COME token");
+    check( price.symbol == COME_SYMBOL, "Price must be in COME token");
     checkasset(max_supply);
-    // check if issuer account exists and if split is between 0 and 1
+    // check if issuer account exists and if the royalty is at most the whole price
     check( is_account( issuer ), "Issuer account does not exist" );
-    check( ( sale_split <= 1.0 ) && ( sale_split >= 0.0 ), "Sale split must be between 0 and 1" );
+    check( royalty_bps <= BPS_DENOMINATOR, "Royalty must be between 0 and 10000 basis points" );
+    // the scope of the contract itself holds nfts minted before they were scoped by event
+    check( event != get_self().value, "Event id is reserved" );
 
     // get nft_category_id (global id)
     config_index config_table( get_self(), get_self().value );
@@ -59,25 +73,32 @@ ACTION nfts::createnft(name issuer,
 
     // Create event in which the new nft category will be assigned, if it hasn't already created
     if( existing_event == events_table.end() ) {
-      events_table.emplace( issuer, [&]( auto& ev ) {
+      auto created_event = events_table.emplace( issuer, [&]( auto& ev ) {
           ev.event = event;
           ev.creator = issuer;
       });
+      count_row( "events"_n, issuer, event, row_bytes( *created_event, 0 ) );
+
+      market_index markets_table( get_self(), get_self().value );
+      auto created_market = markets_table.emplace( issuer, [&]( auto& m ) {
+          m = market{ event, 0, 0, asset( 0, COME_SYMBOL ), 0, 0, asset( 0, COME_SYMBOL ), 0, 0, asset( 0, COME_SYMBOL ) };
+      });
+      count_row( "markets"_n, issuer, event, row_bytes( *created_market, 0 ) );
     }
 
     else {
       check( existing_event->creator == issuer, "Issuer must be the creator of the event");
     }
 
-    asset current_supply = asset( 0, symbol("CTT", max_supply.symbol.precision()));
-    asset issued_supply = asset( 0, symbol("CTT", max_supply.symbol.precision()));
+    asset current_supply = asset( 0, symbol(CTT_CODE, max_supply.symbol.precision()));
+    asset issued_supply = asset( 0, symbol(CTT_CODE, max_supply.symbol.precision()));
 
     stat_index nfts_stats_table( get_self(), event );
     auto existing_nft_stats = nfts_stats_table.find( nft_name.value );
     check( existing_nft_stats == nfts_stats_table.end(), "NFT with this name already exists in this event");
 
     // Create token, if it hasn't already created
-    nfts_stats_table.emplace( issuer, [&]( auto& stats ){
+    auto created_stats = nfts_stats_table.emplace( issuer, [&]( auto& stats ){
       stats.nft_category_id = nft_category_id;
       stats.issuer = issuer;
       stats.nft_name = nft_name;
@@ -88,10 +109,20 @@ ACTION nfts::createnft(name issuer,
       stats.max_per_account = max_per_account;
       stats.current_supply = current_supply;
       stats.issued_supply = issued_supply;
-      stats.sale_split = sale_split;
+      stats.sale_split = 0;
       stats.base_uri = base_uri;
+      stats.royalty_bps = royalty_bps;
       stats.max_supply = max_supply;
     });
+    count_row( "nftstats"_n, issuer, event, row_bytes( *created_stats, 0 ) );
+
+    category_index categories_table( get_self(), get_self().value );
+    auto created_category = categories_table.emplace( issuer, [&]( auto& c ){
+      c.nft_category_id = nft_category_id;
+      c.event = event;
+      c.nft_name = nft_name;
+    });
+    count_row( "categories"_n, issuer, event, row_bytes( *created_category, 0 ) );
 
     // successful creation of token, update category_name_id to reflect
     config_singleton.nft_category_id++;
@@ -102,6 +133,14 @@ ACTION nfts::deleteeve(uint64_t event) {
   event_index events_table(get_self(), get_self().value);
   const auto& selected_event = events_table.get(event, "No event with this id");
   require_auth(selected_event.creator); // ensure that only the event creator can call the action
+  count_action( "deleteeve"_n );
+  count_row( "events"_n, selected_event.creator, event, -row_bytes( selected_event, 0 ) );
+  market_index markets_table(get_self(), get_self().value);
+  auto market = markets_table.find(event);
+  if( market != markets_table.end() ) {
+    count_row( "markets"_n, selected_event.creator, event, -row_bytes( *market, 0 ) );
+    markets_table.erase(market);
+  }
   events_table.erase(selected_event);
 }
 
@@ -109,12 +148,19 @@ ACTION nfts::deletestats(uint64_t event, name nft_name){
   stat_index nfts_stats_table(get_self(), event);
   const auto& stats = nfts_stats_table.get(nft_name.value, "A NFT with this name does not exist in this event");
   require_auth( stats.issuer ); // ensure that only the nft issuer can call the action
+  count_action( "deletestats"_n );
+  // nfts of the category, and the asks and auctions holding them, would be left without one. nothing
+  // takes nfts out of circulation, so only a category that was never issued can go
+  check( stats.current_supply.amount == 0, "Cannot delete a category with NFTs in circulation" );
+  category_index categories_table(get_self(), get_self().value);
+  auto category = categories_table.find(stats.nft_category_id);
+  if( category != categories_table.end() ) {
+    count_row( "categories"_n, stats.issuer, event, -row_bytes( *category, 0 ) );
+    categories_table.erase(category);
+  }
+  count_row( "nftstats"_n, stats.issuer, event, -row_bytes( stats, 0 ) );
+  // category ids are never handed out again, rows of later categories and drops still refer to theirs
   nfts_stats_table.erase(stats);
-  config_index config_table( get_self(), get_self().value );
-  check( config_table.exists(), "Config table does not exist" );
-  auto config_singleton = config_table.get();
-  config_singleton.nft_category_id--;
-  config_table.set( config_singleton, get_self() );
 }
 
 ACTION nfts::issue(uint64_t to,
@@ -124,6 +170,7 @@ ACTION nfts::issue(uint64_t to,
                       string relative_uri,
                       string memo)
 {
+    count_action( "issue"_n );
     //check( is_account( to ), "to account does not exist" ); // comment out because we don't use eosio accounts for our users atm 
     check( memo.size() <= 256, "memo has more than 256 bytes" );
 
@@ -134,46 +181,88 @@ ACTION nfts::issue(uint64_t to,
     stat_index nfts_stats_table( get_self(), event );
     const auto& nft_stats = nfts_stats_table.get( nft_name.value, "NFT with this name is not redeemable for this event");
 
+    //ensure that only issuer can call that action and that quantity is valid
+    require_auth( nft_stats.issuer);
+
+    checkasset(quantity);
     account_index account_table( get_self(), to );
     auto account = account_table.find( nft_stats.nft_category_id );
-    string string_max_tickets = "Every account is able to buy " + to_string(nft_stats.max_per_account) + " NFTs";
-    
-    if( account == account_table.end() ) {
-      // first time issued this asset
-      check( quantity.amount <= nft_stats.max_per_account, string_max_tickets.c_str());
-    }
-    else {
-      // already has a quantity of this nft category asset in account
-      check( quantity.amount + account->amount.amount <= nft_stats.max_per_account, string_max_tickets.c_str());
+    // the quantity already in the account counts against the limit
+    check_max_per_account( nft_stats, quantity.amount, account == account_table.end() ? 0 : account->amount.amount );
+    if( quantity.symbol != nft_stats.max_supply.symbol ) {
+      check( false, "precision of quantity must be " + to_string(nft_stats.max_supply.symbol.precision() ) );
     }
+    check( quantity.amount <= (nft_stats.max_supply.amount - nft_stats.current_supply.amount), "Cannot issue more than max supply" );
 
-    //ensure that only issuer can call that action and that quantity is valid
+    // mint the whole batch at once, ids and serial numbers are consecutive
+    mint({ { to, quantity.amount } }, event, nft_stats, quantity.amount, relative_uri, nft_stats.issuer);
+
+    add_balance(to, get_self(), event, nft_name, nft_stats.nft_category_id, quantity);
+
+    // increase current&issued supply of the selected asset
+    nfts_stats_table.modify( nft_stats, same_payer, [&]( auto& s ) {
+        s.current_supply += quantity;
+        s.issued_supply += quantity;
+    });
+}
+
+ACTION nfts::issuemany(uint64_t event,
+                      name nft_name,
+                      vector<pair<uint64_t, uint64_t>> recipients_and_counts,
+                      string relative_uri,
+                      string memo)
+{
+    count_action( "issuemany"_n );
+    check( memo.size() <= 256, "memo has more than 256 bytes" );
+    check( !recipients_and_counts.empty(), "No recipients given" );
+
+    stat_index nfts_stats_table( get_self(), event );
+    const auto& nft_stats = nfts_stats_table.get( nft_name.value, "NFT with this name is not redeemable for this event");
+
+    //ensure that only issuer can call that action
     require_auth( nft_stats.issuer);
 
-    checkasset(quantity);
-    string string_prop = "precision of quantity must be " + to_string(nft_stats.max_supply.symbol.precision() );
-    check( quantity.symbol == nft_stats.max_supply.symbol, string_prop.c_str() );
-    check( quantity.amount <= (nft_stats.max_supply.amount - nft_stats.current_supply.amount), "Cannot issue more than max supply" );
+    for( const auto& [to, count] : recipients_and_counts ) {
+      check( count >= 1, "Amount must be >=1");
+      check_max_per_account( nft_stats, count, 0 );
+    }
 
-    if ( quantity.amount > 1 ) {
-      asset issued_supply = nft_stats.issued_supply;
-      asset one_token = asset( 1, nft_stats.max_supply.symbol);
-      for ( uint64_t i = 1; i <= quantity.amount; i++ ) {
-          mint(to, nft_stats.issuer, event, nft_name, issued_supply, relative_uri);
-          issued_supply += one_token;
+    // a recipient listed more than once gets the sum of its counts, so its balance is written once
+    sort( recipients_and_counts.begin(), recipients_and_counts.end() );
+    auto last = recipients_and_counts.begin();
+    for( auto itr = next( last ); itr != recipients_and_counts.end(); itr++ ) {
+      if( itr->first == last->first ) {
+        last->second += itr->second;
+      } else if( ++last != itr ) {
+        *last = *itr;
       }
     }
-    else {
-        mint(to, nft_stats.issuer, event, nft_name, nft_stats.issued_supply, relative_uri);
+    recipients_and_counts.erase( next( last ), recipients_and_counts.end() );
+
+    user_index user_table( get_self(), get_self().value);
+    uint64_t quantity = 0;
+    for( const auto& [to, count] : recipients_and_counts ) {
+      check( user_table.find( to ) != user_table.end(), "User with this id doesn't exist");
+
+      account_index account_table( get_self(), to );
+      auto account = account_table.find( nft_stats.nft_category_id );
+      check_max_per_account( nft_stats, count, account == account_table.end() ? 0 : account->amount.amount );
+
+      quantity += count;
     }
+    check( quantity <= uint64_t(nft_stats.max_supply.amount - nft_stats.current_supply.amount), "Cannot issue more than max supply" );
 
+    // one id reservation for the whole drop, every recipient gets a consecutive block
+    mint(recipients_and_counts, event, nft_stats, quantity, relative_uri, nft_stats.issuer);
 
-    add_balance(to, get_self(), event, nft_name, nft_stats.nft_category_id, quantity);
+    for( const auto& [to, count] : recipients_and_counts ) {
+      add_balance(to, get_self(), event, nft_name, nft_stats.nft_category_id, asset( count, nft_stats.max_supply.symbol ));
+    }
 
     // increase current&issued supply of the selected asset
     nfts_stats_table.modify( nft_stats, same_payer, [&]( auto& s ) {
-        s.current_supply += quantity;
-        s.issued_supply += quantity;
+        s.current_supply.amount += quantity;
+        s.issued_supply.amount += quantity;
     });
 }
 
@@ -181,6 +270,7 @@ ACTION nfts::transfer(uint64_t from,
                          uint64_t to,
                          vector<uint64_t> nft_ids,
                          string memo ) {
+  count_action( "transfer"_n );
 
   check( from != to, "Cannot transfer NFT to self" );
 
@@ -196,7 +286,139 @@ ACTION nfts::transfer(uint64_t from,
   // check memo size
   check( memo.size() <= 256, "memo has more than 256 bytes" );
 
-  changeowner( from, to, nft_ids, memo, true );
+  changeowner( from, to, nft_ids, true, false );
+}
+
+ACTION nfts::transfermany(uint64_t from,
+                             vector<pair<uint64_t, vector<uint64_t>>> recipients_and_ids,
+                             string memo ) {
+  count_action( "transfermany"_n );
+  check( !recipients_and_ids.empty(), "No recipients given" );
+  check( memo.size() <= 256, "memo has more than 256 bytes" );
+
+  user_index user_table( get_self(), get_self().value);
+  check( user_table.find( from ) != user_table.end(), "User 'from' with this id doesn't exist");
+
+  // a recipient listed more than once gets all its nfts at once, so its balance is written once
+  sort( recipients_and_ids.begin(), recipients_and_ids.end(), []( const auto& a, const auto& b ){ return a.first < b.first; } );
+  auto last = recipients_and_ids.begin();
+  for( auto itr = next( last ); itr != recipients_and_ids.end(); itr++ ) {
+    if( itr->first == last->first ) {
+      last->second.insert( last->second.end(), itr->second.begin(), itr->second.end() );
+    } else if( ++last != itr ) {
+      *last = std::move( *itr );
+    }
+  }
+  recipients_and_ids.erase( next( last ), recipients_and_ids.end() );
+
+  // balance taken from the sender per nft category, applied once after every recipient got its nfts
+  vector<pair<uint64_t, asset>> sent;
+
+  for( const auto& [to, nft_ids] : recipients_and_ids ) {
+    check( from != to, "Cannot transfer NFT to self" );
+    check( user_table.find( to ) != user_table.end(), "User 'to' with this id doesn't exist");
+
+    vector<pair<uint64_t, asset>> moves;
+    move_nfts( from, to, nft_ids, true, false, moves );
+
+    for( auto const& [nft_category_id, quantity] : moves ) {
+      const auto& category = get_category( nft_category_id ).nft_category;
+      add_balance( to, get_self(), category.event, category.nft_name, nft_category_id, quantity );
+
+      auto total = find_if( sent.begin(), sent.end(), [&]( const auto& m ){ return m.first == nft_category_id; } );
+      if( total == sent.end() ) {
+        sent.emplace_back( nft_category_id, quantity );
+      } else {
+        total->second += quantity;
+      }
+    }
+  }
+
+  for( auto const& [nft_category_id, quantity] : sent ) {
+    sub_balance( from, nft_category_id, quantity );
+  }
+}
+
+ACTION nfts::setdrop(uint64_t event, name nft_name, uint64_t drop_id, checksum256 merkle_root, uint64_t leaf_count)
+{
+    count_action( "setdrop"_n );
+    stat_index nfts_stats_table( get_self(), event );
+    const auto& nft_stats = nfts_stats_table.get( nft_name.value, "NFT with this name is not redeemable for this event");
+
+    //ensure that only issuer can call that action
+    require_auth( nft_stats.issuer );
+    check( leaf_count > 0, "Drop must have at least one leaf" );
+
+    // claimed leaves are kept by index, so the tree of a drop cannot be replaced
+    drop_index drops_table( get_self(), get_self().value );
+    check( drops_table.find( drop_id ) == drops_table.end(), "Drop with this id already exists" );
+    auto created = drops_table.emplace( nft_stats.issuer, [&]( auto& d ){
+      d.drop_id = drop_id;
+      d.nft_category_id = nft_stats.nft_category_id;
+      d.merkle_root = merkle_root;
+      d.leaf_count = leaf_count;
+    });
+    count_row( "drops"_n, nft_stats.issuer, event, row_bytes( *created, 0 ) );
+}
+
+ACTION nfts::claim(uint64_t drop_id, uint64_t leaf_index, uint64_t to, uint64_t count, vector<checksum256> proof, name payer)
+{
+    count_action( "claim"_n );
+    // the leaf names the recipient, so anyone willing to pay the RAM can claim it on their behalf
+    require_auth( payer );
+
+    drop_index drops_table( get_self(), get_self().value );
+    const auto& drop = drops_table.get( drop_id, "Drop does not exist" );
+    check( leaf_index < drop.leaf_count, "Leaf index is out of the drop" );
+    check( count >= 1, "Amount must be >=1");
+
+    claim_index claims_table( get_self(), drop_id );
+    const uint64_t word = leaf_index / 64;
+    const uint64_t bit = uint64_t(1) << (leaf_index % 64);
+    auto claimed = claims_table.find( word );
+    check( claimed == claims_table.end() || !(claimed->bits & bit), "Leaf already claimed" );
+
+    // the bits of the leaf index tell on which side each proof node is
+    checksum256 node = merkle_leaf( leaf_index, to, drop.nft_category_id, count );
+    uint64_t position = leaf_index;
+    for( const auto& sibling : proof ) {
+      node = position & 1 ? merkle_node( sibling, node ) : merkle_node( node, sibling );
+      position >>= 1;
+    }
+    check( position == 0 && node == drop.merkle_root, "Invalid proof" );
+
+    user_index user_table( get_self(), get_self().value);
+    check( user_table.find( to ) != user_table.end(), "User with this id doesn't exist");
+
+    const auto& category = get_category( drop.nft_category_id ).nft_category;
+    stat_index nfts_stats_table( get_self(), category.event );
+    const auto& nft_stats = nfts_stats_table.get( category.nft_name.value, "NFT with this name is not redeemable for this event");
+
+    account_index account_table( get_self(), to );
+    auto account = account_table.find( nft_stats.nft_category_id );
+    check_max_per_account( nft_stats, count, account == account_table.end() ? 0 : account->amount.amount );
+    check( count <= uint64_t(nft_stats.max_supply.amount - nft_stats.current_supply.amount), "Cannot issue more than max supply" );
+
+    mint({ { to, count } }, category.event, nft_stats, count, "", payer);
+    add_balance(to, get_self(), category.event, category.nft_name, nft_stats.nft_category_id, asset( count, nft_stats.max_supply.symbol ));
+
+    // increase current&issued supply of the selected asset
+    nfts_stats_table.modify( nft_stats, same_payer, [&]( auto& s ) {
+        s.current_supply.amount += count;
+        s.issued_supply.amount += count;
+    });
+
+    if( claimed == claims_table.end() ) {
+      auto created = claims_table.emplace( payer, [&]( auto& c ){
+        c.word = word;
+        c.bits = bit;
+      });
+      count_row( "dropclaims"_n, payer, category.event, row_bytes( *created, 0 ) );
+    } else {
+      claims_table.modify( claimed, same_payer, [&]( auto& c ){
+        c.bits |= bit;
+      });
+    }
 }
 
 ACTION nfts::listsale(uint64_t seller,
@@ -205,58 +427,62 @@ ACTION nfts::listsale(uint64_t seller,
                          vector<uint64_t> nft_ids,
                          asset net_sale_price)
 {
+    count_action( "listsale"_n );
     user_index user_table( get_self(), get_self().value);
     auto user = user_table.find( seller );
     check( user != user_table.end(), "User with this id doesn't exist");
 
     check( net_sale_price.amount > 0, "amount must be positive" );
-    check( net_sale_price.symbol == symbol( symbol_code("COME"), 2), "Only accept COME token for sale");
-    nft_index nfts_table( get_self(), get_self().value );
+    check( net_sale_price.symbol == COME_SYMBOL, "Only accept COME token for sale");
+    check( !nft_ids.empty(), "No NFTs to list" );
+    check_event_open( event );
+    // partial fills are charged the unit price, so it must add up to the whole price and cannot be zero
+    check( net_sale_price.amount % int64_t(nft_ids.size()) == 0, "Price must be a multiple of the number of NFTs" );
+    // every NFT of the batch must belong to this category
+    stat_index nfts_stats_table( get_self(), event );
+    const auto& nft_stats = nfts_stats_table.get( nft_name.value, "A NFT with this name does not exist in this event" );
+    require_issuer( nft_stats.issuer ); // ensure that only issuer can call the action
+    check( nft_stats.sellable == true, "Must be sellable" );
 
-    for( auto const& nft_id: nft_ids) {
-      const auto& nft = nfts_table.get( nft_id, "NFT does not exist" );
+    // the nfts of an ask are bought and sold on, so the ask is not named after any of them
+    const uint64_t batch_id = reserve_batch_id();
 
-      stat_index nfts_stats_table( get_self(), nft.event );
-      const auto& nft_stats = nfts_stats_table.get( nft.nft_name.value, "A NFT with this name does not exist in this event" );
-      require_auth( nft_stats.issuer); // ensure that only issuer can call the action
+    for( auto const& nft_id: nft_ids) {
+      const auto& nft = get_nft( nft_id, "NFT does not exist" );
 
-      check( nft.shared_with == NULL, "NFT must not be in a shareable mode");
-      check( nft_stats.sellable == true, "Must be sellable" );
+      check( !(nft.flags & NFT_SHARED), "NFT must not be in a shareable mode");
       check( nft.owner == seller, "Must be nft owner" );
-      check( nft.event == event, "NFTs must be from the same event" );
-      check( nft.nft_name == nft_name, "NFTs must have the same nft name" );
-
-      // Check if nft is locked
-      lock_index lockednfts_table( get_self(), get_self().value );
-      auto lockednft = lockednfts_table.find( nft_id );
-      check( lockednft == lockednfts_table.end(), "NFT locked ");
-
-      // add resale price to nft
-      nfts_table.modify(nft, same_payer, [&]( auto& t){
-        t.resale_price = net_sale_price/nft_ids.size();
-      });
-
-      // add nft to lock stats_table
-      lockednfts_table.emplace( get_self(), [&]( auto& l ){
-        l.nft_id = nft_id;
+      check( nft.nft_category_id == nft_stats.nft_category_id, "NFTs must be from the same event and have the same nft name" );
+      check( !(nft.flags & NFT_LOCKED), "NFT locked ");
+
+      // lock nft as listed, the price is kept in the ask. listed_in grows the row, and the account that paid
+      // for it, such as the payer of a claim, does not sign the listing, so the row moves to the contract
+      nfts_in( nft_scope( nft_id ) ).modify( nft, get_self(), [&]( auto& t ){
+        t.flags |= NFT_LISTED;
+        t.listed_in = batch_id;
       });
     }
 
     // add batch to table of asks
     ask_index asks_table( get_self(), get_self().value );
-    asks_table.emplace( get_self(), [&]( auto& a ){
-      a.batch_id = nft_ids[0];
+    auto created = asks_table.emplace( get_self(), [&]( auto& a ){
+      a.batch_id = batch_id;
       a.nft_ids = nft_ids;
       a.event = event;
       a.seller = seller;
       a.ask_price = net_sale_price;
       a.expiration = time_point_sec(current_time_point()) + WEEK_SEC;
+      a.nft_category_id.emplace( nft_stats.nft_category_id );
+      a.unit_price.emplace( net_sale_price.amount / int64_t(nft_ids.size()), net_sale_price.symbol );
     });
+    count_row( "asks"_n, get_self(), event, row_bytes( *created, 4 ) );
+    market_listed( *created );
 }
 
 ACTION nfts::closesale( uint64_t seller,
                             uint64_t batch_id)
 {
+    count_action( "closesale"_n );
     ask_index asks_table( get_self(), get_self().value );
     const auto& ask = asks_table.get( batch_id, "Cannot find the desirable sale" );
 
@@ -264,75 +490,143 @@ ACTION nfts::closesale( uint64_t seller,
     auto user = user_table.find( seller );
     check( user != user_table.end(), "User with this id doesn't exist");
 
-    lock_index lockednfts_table( get_self(), get_self().value );
-    nft_index nfts_table( get_self(), get_self().value );
+    // a sale in progress can only be cancelled by its seller, an expired one by anyone
+    if( time_point_sec(current_time_point()) <= ask.expiration ) {
+      //require_auth( seller );
+      check( ask.seller == seller, "Only seller can cancel a sale in progress" );
+    }
 
 
     for( auto const& nft_id : ask.nft_ids ) {
-      const auto& nft = nfts_table.get( nft_id, "NFT does not exist" );
+      const auto& nft = get_nft( nft_id, "NFT does not exist" );
 
-      stat_index nfts_stats_table( get_self(), nft.event );
-      const auto& nft_stats = nfts_stats_table.get( nft.nft_name.value, "A NFT with this name does not exist in this event" );
-      require_auth( nft_stats.issuer); // ensure that only issuer can call the action
+      require_issuer( get_category( nft.nft_category_id ).stats.issuer ); // ensure that only issuer can call the action
 
-      nfts_table.modify(nft, same_payer, [&]( auto& t){
-        t.resale_price = asset(0, symbol("COME", 2));;
+      // unlock nft
+      modify_nft( nft, [&]( auto& t ){
+        t.flags &= ~NFT_LISTED;
+        t.listed_in.reset();
       });
-
     }
 
-    if( time_point_sec(current_time_point()) > ask.expiration ) {
-      for( auto const& nft_id: ask.nft_ids ) {
-        const auto& lockednft = lockednfts_table.get( nft_id, "NFT not found in lock table" );
-        lockednfts_table.erase( lockednft );
-      }
-      asks_table.erase( ask );
-    }
-    else {
-      //require_auth( seller );
-      check( ask.seller == seller, "Only seller can cancel a sale in progress" );
-      for( auto const& nft_id : ask.nft_ids ) {
-        const auto& lockednft = lockednfts_table.get( nft_id, "NFT was not found in lock table" );
-        lockednfts_table.erase( lockednft );
+    const uint64_t event = ask.event, units = ask.nft_ids.size();
+    count_row( "asks"_n, get_self(), ask.event, -row_bytes( ask, 4 ) );
+    asks_table.erase( ask );
+    market_unlisted( asks_table, event, batch_id, units, true );
+}
+
+uint64_t nfts::sweepasks(uint64_t max_rows)
+{
+    count_action( "sweepasks"_n );
+    check( max_rows > 0, "max_rows must be positive" );
+
+    // expired asks are closed in expiration order, anyone can pay the CPU for it
+    ask_index asks_table( get_self(), get_self().value );
+    auto asks_by_expiry = asks_table.get_index<"byexpiry"_n>();
+    const auto now = time_point_sec(current_time_point());
+
+    uint64_t cleared = 0;
+    for( auto itr = asks_by_expiry.begin(); itr != asks_by_expiry.end() && itr->expiration < now && cleared < max_rows; cleared++ ) {
+      for( auto const& nft_id : itr->nft_ids ) {
+        // an nft that is gone leaves nothing to unlock, and must not keep the rest of the asks behind it
+        const auto nft = find_nft( nft_id );
+        if( nft == nullptr ) {
+          continue;
+        }
+
+        // unlock nft
+        modify_nft( *nft, [&]( auto& t ){
+          t.flags &= ~NFT_LISTED;
+          t.listed_in.reset();
+        });
       }
-      asks_table.erase( ask );
+      const uint64_t event = itr->event, batch_id = itr->batch_id, units = itr->nft_ids.size();
+      count_row( "asks"_n, get_self(), itr->event, -row_bytes( *itr, 4 ) );
+      itr = asks_by_expiry.erase( itr );
+      market_unlisted( asks_table, event, batch_id, units, true );
     }
+
+    return cleared;
 }
 
-ACTION nfts::share(uint64_t from, uint64_t nft_id, uint64_t to) {
+ACTION nfts::share(uint64_t from, uint64_t nft_id, uint64_t to, binary_extension<time_point_sec> expiration) {
+  count_action( "share"_n );
   check( from != to, "Cannot share to self" );
 
-  lock_index lockednfts_table( get_self(), get_self().value );
-  auto lockednft = lockednfts_table.find( nft_id );
-  check( lockednft == lockednfts_table.end(), "NFT is locked, it cannot be shared");
+  shared_index shared_table( get_self(), get_self().value );
+  share_expiry_index expiry_table( get_self(), get_self().value );
+  share_nft( shared_table, expiry_table, get_nft( nft_id, "NFT does not exist" ), to, expiration );
+}
 
-  nft_index nfts_table( get_self(), get_self().value );
-  const auto& nft = nfts_table.get( nft_id, "NFT does not exist" );
+ACTION nfts::unshare(uint64_t nft_id){
+  count_action( "unshare"_n );
+  shared_index shared_table( get_self(), get_self().value );
+  share_expiry_index expiry_table( get_self(), get_self().value );
+  unshare_nft( shared_table, expiry_table, nft_id );
+}
 
-  stat_index nfts_stats_table( get_self(), nft.event );
-  const auto& nft_stats = nfts_stats_table.get( nft.nft_name.value, "A NFT with this name does not exist in this event" );
-  require_auth( nft_stats.issuer); // ensure that only issuer can call the action
+ACTION nfts::sharemany(uint64_t from, vector<uint64_t> nft_ids, uint64_t to, binary_extension<time_point_sec> expiration) {
+  count_action( "sharemany"_n );
+  check( from != to, "Cannot share to self" );
+  check( !nft_ids.empty(), "No NFTs to share" );
 
-  nfts_table.modify( nft, same_payer,  [&]( auto& t ){
-    t.shared_with = to;
-  });
+  // the tables are opened once, categories and issuer auths are cached across the batch
+  shared_index shared_table( get_self(), get_self().value );
+  share_expiry_index expiry_table( get_self(), get_self().value );
+  for( auto const& nft_id : nft_ids ) {
+    share_nft( shared_table, expiry_table, get_nft( nft_id, "NFT does not exist" ), to, expiration );
+  }
 }
 
-ACTION nfts::unshare(uint64_t nft_id){
-  nft_index nfts_table( get_self(), get_self().value );
-  const auto& nft = nfts_table.get( nft_id, "NFT does not exist" );
+ACTION nfts::unsharemany(vector<uint64_t> nft_ids) {
+  count_action( "unsharemany"_n );
+  check( !nft_ids.empty(), "No NFTs to unshare" );
 
-  stat_index nfts_stats_table( get_self(), nft.event );
-  const auto& nft_stats = nfts_stats_table.get( nft.nft_name.value, "A NFT with this name does not exist in this event" );
-  require_auth( nft_stats.issuer); // ensure that only issuer can call the action
-  
-  nfts_table.modify( nft, same_payer,  [&]( auto& t ){
-    t.shared_with = NULL;
-  });
+  shared_index shared_table( get_self(), get_self().value );
+  share_expiry_index expiry_table( get_self(), get_self().value );
+  for( auto const& nft_id : nft_ids ) {
+    unshare_nft( shared_table, expiry_table, nft_id );
+  }
+}
+
+uint64_t nfts::sweepshares(uint64_t max_rows)
+{
+  count_action( "sweepshares"_n );
+  check( max_rows > 0, "max_rows must be positive" );
+
+  // expired shares end in expiration order, anyone can pay the CPU for it
+  shared_index shared_table( get_self(), get_self().value );
+  share_expiry_index expiry_table( get_self(), get_self().value );
+  auto expiry_by_time = expiry_table.get_index<"byexpiry"_n>();
+  const auto now = time_point_sec(current_time_point());
+
+  uint64_t cleared = 0;
+  for( auto itr = expiry_by_time.begin(); itr != expiry_by_time.end() && itr->expiration <= now && cleared < max_rows; cleared++ ) {
+    // the nft may be gone with a purged event, its rows are then counted under no event
+    const auto* nft = find_nft( itr->nft_id );
+    const auto* category = nft != nullptr ? find_category( nft->nft_category_id ) : nullptr;
+    const uint64_t event = category != nullptr ? category->nft_category.event : get_self().value;
+    if( nft != nullptr ) {
+      modify_nft( *nft, [&]( auto& t ){
+        t.flags &= ~NFT_SHARED;
+      });
+    }
+    auto shared = shared_table.find( itr->nft_id );
+    if( shared != shared_table.end() ) {
+      count_row( "sharednfts"_n, get_self(), event, -row_bytes( *shared, 1 ) );
+      shared_table.erase( shared );
+    }
+    count_row( "shareexpiry"_n, get_self(), event, -row_bytes( *itr, 1 ) );
+    itr = expiry_by_time.erase( itr );
+  }
+
+  return cleared;
 }
 
-ACTION nfts::buy(uint64_t to, uint64_t batch_id,  string memo)
+nfts::sale_payout nfts::buy(uint64_t to, uint64_t batch_id,  string memo, binary_extension<vector<uint64_t>> nft_ids)
 {
+  count_action( "buy"_n );
+  require_auth(get_self());
   user_index user_table( get_self(), get_self().value);
   auto user = user_table.find( to );
   check( user != user_table.end(), "User with this id doesn't exist");
@@ -343,29 +637,108 @@ ACTION nfts::buy(uint64_t to, uint64_t batch_id,  string memo)
   const auto& ask = asks_table.get( batch_id, "Cannot find listing" );
   check( ask.expiration > time_point_sec(current_time_point()), "Sale has expired" );
 
-  string string_prop = "bought by: " + to_string(to);
+  // asks listed before buybest do not name their category, it is the one of their nfts
+  const uint64_t nft_category_id = ask.nft_category_id.has_value() ? *ask.nft_category_id : get_nft( ask.nft_ids[0], "NFT does not exist" ).nft_category_id;
+  const auto& nft_stats = get_category( nft_category_id ).stats;
+
+  if( !nft_ids.has_value() || nft_ids->empty() ) {
+    const auto payout = split_sale( ask.seller, nft_stats, ask.ask_price );
+    debit_user( to, ask.ask_price );
+    fill_ask( ask.seller, ask.nft_ids, to );
+
+    //remove sale listing
+    const uint64_t event = ask.event, units = ask.nft_ids.size();
+    const auto price = ask.ask_price;
+    count_row( "asks"_n, get_self(), ask.event, -row_bytes( ask, 4 ) );
+    asks_table.erase( ask );
+    market_unlisted( asks_table, event, batch_id, units, true );
+    market_sold( event, units, price );
+    pay_sale( payout );
+    return payout;
+  }
+  else {
+    // only the requested nfts are sold at the unit price, the listing keeps the rest
+    check( ask.unit_price.has_value(), "This listing can only be bought as a whole" );
+    const uint64_t seller = ask.seller, event = ask.event;
+    const auto price = *ask.unit_price * int64_t(nft_ids->size());
+    const auto payout = split_sale( seller, nft_stats, price );
+    debit_user( to, price );
+    take_from_ask( asks_table, ask, *nft_ids );
+    fill_ask( seller, *nft_ids, to );
+    market_sold( event, nft_ids->size(), price );
+    pay_sale( payout );
+    return payout;
+  }
+}
+
+uint64_t nfts::buybest(uint64_t to, uint64_t event, name nft_name, asset max_unit_price, uint64_t count)
+{
+  count_action( "buybest"_n );
+  require_auth(get_self());
+  user_index user_table( get_self(), get_self().value);
+  auto user = user_table.find( to );
+  check( user != user_table.end(), "User with this id doesn't exist");
 
-  changeowner( ask.seller, to, ask.nft_ids, string_prop.c_str(), false);
+  check( count > 0, "count must be positive" );
+  check( max_unit_price.amount > 0, "amount must be positive" );
+  check( max_unit_price.symbol == COME_SYMBOL, "Only accept COME token for sale");
 
-  lock_index lockednfts_table( get_self(), get_self().value );
-  nft_index nfts_table( get_self(), get_self().value );
+  stat_index nfts_stats_table( get_self(), event );
+  const auto& nft_stats = nfts_stats_table.get( nft_name.value, "A NFT with this name does not exist in this event" );
 
-  for( auto const& nft_id : ask.nft_ids ) {
-    const auto& nft = nfts_table.get( nft_id, "NFT does not exist" );
-    nfts_table.modify(nft, same_payer, [&]( auto& t){
-      t.resale_price = asset(0, symbol("COME", 2));
-    });
+  // cheapest asks of the event first, up to the price limit
+  ask_index asks_table( get_self(), get_self().value );
+  auto asks_by_price = asks_table.get_index<"byeventprice"_n>();
+  const uint128_t last = (uint128_t(event) << 64) | uint64_t(max_unit_price.amount);
+  const auto now = time_point_sec(current_time_point());
+
+  uint64_t bought = 0;
+  asset spent( 0, COME_SYMBOL );
+  for( auto itr = asks_by_price.lower_bound( uint128_t(event) << 64 ); itr != asks_by_price.end() && itr->get_byeventprice() <= last && bought < count; ) {
+    // asks listed before buybest or partial fills name no category or unit price, they are only sold by buy
+    if( !itr->nft_category_id.has_value() || !itr->unit_price.has_value() ) {
+      itr++;
+      continue;
+    }
+    if( *itr->nft_category_id != nft_stats.nft_category_id || itr->expiration <= now ) {
+      itr++;
+      continue;
+    }
 
-    const auto& lockednft = lockednfts_table.get( nft_id, "NFT not found in lock table" );
-    lockednfts_table.erase( lockednft );
+    if( itr->nft_ids.size() <= count - bought ) {
+      pay_sale( split_sale( itr->seller, nft_stats, itr->ask_price ) );
+      spent += itr->ask_price;
+      fill_ask( itr->seller, itr->nft_ids, to );
+      bought += itr->nft_ids.size();
+      const uint64_t batch_id = itr->batch_id, units = itr->nft_ids.size();
+      market_sold( event, units, itr->ask_price );
+      count_row( "asks"_n, get_self(), itr->event, -row_bytes( *itr, 4 ) );
+      itr = asks_by_price.erase( itr );
+      market_unlisted( asks_table, event, batch_id, units, true );
+    }
+    else {
+      // the last listing is filled partially, the rest of it stays on sale
+      vector<uint64_t> nft_ids( itr->nft_ids.begin(), itr->nft_ids.begin() + (count - bought) );
+      const uint64_t seller = itr->seller;
+      const auto price = *itr->unit_price * int64_t(nft_ids.size());
+      pay_sale( split_sale( seller, nft_stats, price ) );
+      spent += price;
+      take_from_ask( asks_table, *itr, nft_ids );
+      fill_ask( seller, nft_ids, to );
+      market_sold( event, nft_ids.size(), price );
+      bought = count;
+    }
   }
 
-  //remove sale listing
-  asks_table.erase( ask );
+  check( bought > 0, "No listing matches the requested price" );
+  // the buyer is charged once for every listing filled
+  debit_user( to, spent );
+  return bought;
 }
 
 ACTION nfts::createauctn(uint64_t seller, uint64_t event, uint64_t nft_id, asset target_price, asset min_bid_price, time_point_sec expiration)
 {
+  count_action( "createauctn"_n );
   require_auth(get_self());
   user_index user_table( get_self(), get_self().value);
   auto user = user_table.find( seller );
@@ -373,50 +746,49 @@ ACTION nfts::createauctn(uint64_t seller, uint64_t event, uint64_t nft_id, asset
  
   // target price validations  
   check( target_price.amount > 0, "Target price must be positive" );
-  check( target_price.symbol == symbol( symbol_code("COME"), 2), "Only accept COME token for auction");
+  check( target_price.symbol == COME_SYMBOL, "Only accept COME token for auction");
   // minimum bid price validations
-  check( target_price.amount > 0, "Minimum bid price must be positive" );
-  check( target_price.symbol == symbol( symbol_code("COME"), 2), "Only accept COME token for auction");
+  check( min_bid_price.amount > 0, "Minimum bid price must be positive" );
+  check( min_bid_price.symbol == COME_SYMBOL, "Only accept COME token for auction");
+  check_event_open( event );
   
-  nft_index nfts_table( get_self(), get_self().value );
-  const auto& nft = nfts_table.get( nft_id, "NFT does not exist" );
+  const auto& nft = get_nft( nft_id, "NFT does not exist" );
 
-  stat_index nfts_stats_table( get_self(), nft.event );
-  const auto& nft_stats = nfts_stats_table.get( nft.nft_name.value, "NFT stats does not exist" );
+  const auto& category = get_category( nft.nft_category_id );
+  const auto& nft_stats = category.stats;
 
-  check( nft.shared_with == NULL, "NFT must not be in a shareable mode");
+  check( !(nft.flags & NFT_SHARED), "NFT must not be in a shareable mode");
   check( nft_stats.sellable == true, "Must be sellable" );
   check( nft.owner == seller, "Must be nft owner" );
-  check( nft.event == event, "NFTs must be from the same event" );
-
-  // Check if nft is locked
-  lock_index lockednfts_table( get_self(), get_self().value );
-  auto lockednft = lockednfts_table.find( nft_id );
-  check( lockednft == lockednfts_table.end(), "NFT locked ");
+  check( category.nft_category.event == event, "NFTs must be from the same event" );
+  check( !(nft.flags & NFT_LOCKED), "NFT locked ");
 
-  // add nft to lock stats_table
-  lockednfts_table.emplace( get_self(), [&]( auto& l ){
-    l.nft_id = nft_id;
+  // lock nft for the auction
+  modify_nft( nft, [&]( auto& t ){
+    t.flags |= NFT_AUCTIONED;
   });
     
   // add auction to the respective table
   auction_index auctions_table( get_self(), get_self().value );
-  auctions_table.emplace( get_self(), [&]( auto& a ){
+  auto created = auctions_table.emplace( get_self(), [&]( auto& a ){
     a.nft_id = nft_id;
     a.event = event;
     a.seller = seller;
     a.target_price = target_price;
     a.min_bid_price = min_bid_price;
-    a.current_price = asset(NULL, symbol("COME", 2));
+    a.current_price = asset(0, COME_SYMBOL);
     //a.expiration = time_point_sec(current_time_point()) + WEEK_SEC;
     a.expiration = expiration;
-
+    a.escrowed = true;
   });
+  count_row( "auctions"_n, get_self(), event, row_bytes( *created, 3 ) );
+  market_auction_opened( event );
 
 }
 
 ACTION nfts::closeauctn(uint64_t seller, uint64_t nft_id) 
 {
+  count_action( "closeauctn"_n );
   require_auth(get_self());
   auction_index auctions_table( get_self(), get_self().value );
   const auto& auction = auctions_table.get( nft_id, "Cannot find the desirable auction" );
@@ -425,18 +797,27 @@ ACTION nfts::closeauctn(uint64_t seller, uint64_t nft_id)
   auto user = user_table.find( seller );
   check( user != user_table.end(), "User with this id doesn't exist");
 
-  lock_index lockednfts_table( get_self(), get_self().value );
-
   check( time_point_sec(current_time_point()) < auction.expiration, "Auction is not in progress, you need to call the finalize action" ); // is auction still in progress?
   check( auction.seller == seller, "Only seller can cancel an auction in progress" );
-    
-  const auto& lockednft = lockednfts_table.get( nft_id, "NFT not found in lock table" );
-  lockednfts_table.erase( lockednft );
+
+  // the held bid goes back to its bidder
+  if( auction.bidder != 0 && auction.escrowed.value_or( false ) ) {
+    credit_user( auction.bidder, auction.current_price );
+  }
+
+  // unlock nft & remove auction listing
+  const auto& nft = get_nft( nft_id, "NFT does not exist" );
+  modify_nft( nft, [&]( auto& t ){
+    t.flags &= ~NFT_AUCTIONED;
+  });
+  market_auction_closed( auction );
+  count_row( "auctions"_n, get_self(), auction.event, -row_bytes( auction, 3 ) );
   auctions_table.erase( auction );
 }
 
-ACTION nfts::bid(uint64_t nft_id, uint64_t bidder, asset bid_price)
+std::optional<nfts::sale_payout> nfts::bid(uint64_t nft_id, uint64_t bidder, asset bid_price)
 {
+  count_action( "bid"_n );
   require_auth(get_self());
   auction_index auctions_table( get_self(), get_self().value );
   const auto& auction = auctions_table.get( nft_id, "Cannot find the desirable auction" );
@@ -447,36 +828,47 @@ ACTION nfts::bid(uint64_t nft_id, uint64_t bidder, asset bid_price)
 
   // bid price validations  
   check( bid_price.amount > 0, "Bid price must be positive" );
-  check( bid_price.symbol == symbol( symbol_code("COME"), 2), "Only accept COME token for auction");
+  check( bid_price.symbol == COME_SYMBOL, "Only accept COME token for auction");
 
   check( time_point_sec(current_time_point()) < auction.expiration, "Auction has ended" ); // is auction still in progress?
   check( bidder != auction.seller, "You cannot bid at your own auction" );
   check( bid_price > auction.current_price , "Your bid price is lower than the current one" );
 
+  // the bid is held from the bidder's funds, the one it outbids is refunded first
+  if( auction.bidder != 0 && auction.escrowed.value_or( false ) ) {
+    credit_user( auction.bidder, auction.current_price );
+  }
+  debit_user( bidder, bid_price );
+
   if (bid_price >= auction.target_price) {
     // the target price has been reached, so this is an instant buy bid
-    string memo = "auction bought by: " + to_string(auction.bidder);
-    vector<uint64_t> nft_ids{ nft_id }; // we transform the single value to a vector to match the parameter type needed by the changeowner function
-    changeowner( auction.seller, bidder, nft_ids, memo.c_str(), false);
-
-    // unlock nft & remove auction listing
-    lock_index lockednfts_table( get_self(), get_self().value );
-    const auto& lockednft = lockednfts_table.get( nft_id, "NFT not found in lock table" );
-    lockednfts_table.erase( lockednft );
-    auctions_table.erase( auction );  
+    const auto payout = split_sale( auction.seller, get_category( get_nft( nft_id, "NFT does not exist" ).nft_category_id ).stats, bid_price );
+    changeowner( auction.seller, bidder, nft_id, false, true );
+    market_auction_closed( auction );
+    market_sold( auction.event, 1, bid_price );
+
+    // nft was unlocked by changeowner, remove auction listing
+    count_row( "auctions"_n, get_self(), auction.event, -row_bytes( auction, 3 ) );
+    auctions_table.erase( auction );
+    pay_sale( payout );
+    return payout;
   }
   else {
     check( bid_price - auction.current_price >= auction.min_bid_price , "Bid must be greater than the minimum bid price" );
+    market_bid( auction, bid_price );
     // new bid is greater than the current price, so we update the top bidder
     auctions_table.modify( auction, same_payer,  [&]( auto& t ){
       t.current_price = bid_price;
       t.bidder = bidder;
+      t.escrowed = true;
     });
+    return std::nullopt;
   }
 }
 
-ACTION nfts::finalize(uint64_t nft_id, uint64_t seller)
+std::optional<nfts::sale_payout> nfts::finalize(uint64_t nft_id, uint64_t seller)
 {
+  count_action( "finalize"_n );
   require_auth(get_self());
   auction_index auctions_table( get_self(), get_self().value );
   const auto& auction = auctions_table.get( nft_id, "Cannot find the desirable auction" );
@@ -488,119 +880,1577 @@ ACTION nfts::finalize(uint64_t nft_id, uint64_t seller)
   check( auction.seller == seller, "Only seller can finalize the auction" );
   check( time_point_sec(current_time_point()) > auction.expiration, "You cannot finalize an auction before its expiration" ); // is auction still in progress?
 
-  if ( auction.bidder != 0) {
-    // someone has a winning bid for this auction
-    string memo = "auction bought by: " + to_string(auction.bidder);
-    vector<uint64_t> nft_ids{ nft_id }; // we transform the single value to a vector to match the parameter type needed by the changeowner function
-    changeowner( seller, auction.bidder, nft_ids, memo.c_str(), false);
-  }
-
-  // unlock nft & remove auction listing
-  lock_index lockednfts_table( get_self(), get_self().value );
-  const auto& lockednft = lockednfts_table.get( nft_id, "NFT not found in lock table" );
-  lockednfts_table.erase( lockednft );
-  auctions_table.erase( auction ); 
-}
-
+  const auto payout = settle_auction( auction );
 
-void nfts::checkasset(const asset& amount) {
-  auto sym = amount.symbol;
-  symbol_code req = symbol_code("CTT");
-  check( sym.precision() == 0, "Symbol must be an int, with precision of 0" );
-  check( amount.amount >= 1, "Amount must be >=1");
-  check( sym.code().raw() == req.raw(), "Symbol must be CTT" );
-  check( amount.is_valid(), "Invalid amount");
+  // remove auction listing
+  count_row( "auctions"_n, get_self(), auction.event, -row_bytes( auction, 3 ) );
+  auctions_table.erase( auction );
+  return payout;
 }
 
-void nfts::mint(const uint64_t& to, const name& issuer, const uint64_t& event, const name& nft_name, const asset& issued_supply, const string& relative_uri)
+uint64_t nfts::settleauctns(uint64_t max_rows)
 {
-  nft_index nfts_table( get_self(), get_self().value);
-  auto nft_id = nfts_table.available_primary_key();
+  count_action( "settleauctns"_n );
+  require_auth(get_self());
+  check( max_rows > 0, "max_rows must be positive" );
 
-  if( relative_uri.empty() ) {
-    nfts_table.emplace( issuer, [&]( auto& t ){
-      t.id = nft_id;
-      t.serial_number = issued_supply.amount + 1;
-      t.event = event;
-      t.owner = to;
-      t.resale_price = asset(NULL, symbol("COME", 2));
-      t.nft_name = nft_name;
-    });
-  } else {
-      nfts_table.emplace( issuer, [&]( auto& t ) {
-        t.id = nft_id;
-        t.serial_number = issued_supply.amount + 1;
-        t.event = event;
-        t.owner = to;
-        t.resale_price = asset(NULL, symbol("COME", 2));
-        t.nft_name = nft_name;
-        t.relative_uri = relative_uri;
-      });
-    }
+  // ended auctions are settled in expiration order, settled rows are erased so the next call resumes
+  auction_index auctions_table( get_self(), get_self().value );
+  auto auctions_by_expiry = auctions_table.get_index<"byexpiry"_n>();
+  const auto now = time_point_sec(current_time_point());
+
+  uint64_t settled = 0;
+  for( auto itr = auctions_by_expiry.begin(); itr != auctions_by_expiry.end() && itr->expiration < now && settled < max_rows; settled++ ) {
+    settle_auction( *itr );
+    count_row( "auctions"_n, get_self(), itr->event, -row_bytes( *itr, 3 ) );
+    itr = auctions_by_expiry.erase( itr );
+  }
+
+  return settled;
 }
 
-// Helper function to add asset balance to user's account
-void nfts::add_balance(const uint64_t& owner, const name& ram_payer, const uint64_t& event, const name& nft_name, const uint64_t& nft_category_id, const asset& quantity )
+nfts::purge_progress nfts::purgeevent(uint64_t event, uint64_t max_rows)
 {
-  account_index to_acnts( get_self(), owner );
-  auto to = to_acnts.find( nft_category_id );
-  if( to == to_acnts.end() ) {
-    to_acnts.emplace( ram_payer, [&]( auto& a ){
-      a.nft_category_id = nft_category_id;
-      a.event = event;
-      a.nft_name = nft_name;
-      a.amount = quantity;
-    });
-  } else {
-    to_acnts.modify( to, same_payer, [&]( auto& a ){
-      a.amount += quantity;
+  count_action( "purgeevent"_n );
+  require_auth(get_self());
+  check( max_rows > 0, "max_rows must be positive" );
+
+  event_index events_table( get_self(), get_self().value );
+  check( events_table.find( event ) == events_table.end(), "Event must be deleted before it is purged" );
+  // compact rows still in the contract scope only name their event through the categories the purge erases
+  auto& unscoped_table = nfts_in( get_self().value );
+  check( unscoped_table.begin() == unscoped_table.end(), "NFTs stored before event scopes must be moved with migratescope first" );
+
+  purge_index purges_table( get_self(), get_self().value );
+  auto state = purges_table.find( event );
+  if( state == purges_table.end() ) {
+    state = purges_table.emplace( get_self(), [&]( auto& p ){
+      p.event = event;
+      p.stage = PURGE_ASKS;
+      p.erased = 0;
+      p.next_id = 0;
     });
+    count_row( "purges"_n, get_self(), event, row_bytes( *state, 0 ) );
   }
-}
 
-// Helper function to subtract asset balance to user's account
-void nfts::sub_balance(const uint64_t& owner, const uint64_t& nft_category_id, const asset& quantity)
-{
-  account_index from_acnts( get_self(), owner );
-  auto from = from_acnts.find( nft_category_id );
-  check( from->amount.amount >= quantity.amount, "Quantity must be equal or less than account balance" );
+  // every stage erases the rows it is done with, so a call resumes with the first row left.
+  // Rows are erased with their table handle, which refunds the RAM to whoever paid for it
+  uint8_t stage = state->stage;
+  uint64_t erased = 0;
+
+  // balances taken per (owner, nft category), applied once per batch
+  vector<pair<pair<uint64_t, uint64_t>, uint64_t>> balances;
+  auto take_balance = [&]( const uint64_t& owner, const uint64_t& nft_category_id, const uint64_t& quantity ){
+    auto key = make_pair( owner, nft_category_id );
+    auto itr = find_if( balances.begin(), balances.end(), [&]( const auto& b ){ return b.first == key; } );
+    if( itr == balances.end() ) {
+      balances.emplace_back( key, quantity );
+    } else {
+      itr->second += quantity;
+    }
+  };
+  auto payer_of = [&]( const uint64_t& nft_category_id ){
+    const auto category = find_category( nft_category_id );
+    return category != nullptr ? category->stats.issuer : get_self();
+  };
 
-  if( from->amount.amount == quantity.amount ) {
-    from_acnts.erase(from);
-  } else {
-    from_acnts.modify( from, same_payer, [&]( auto& a ){
-      a.amount -= quantity;
-    });
+  if( stage == PURGE_ASKS ) {
+    ask_index asks_table( get_self(), get_self().value );
+    auto asks_by_event = asks_table.get_index<"byevent"_n>();
+    auto itr = asks_by_event.lower_bound( event );
+    for( ; itr != asks_by_event.end() && itr->event == event && erased < max_rows; erased++ ) {
+      count_row( "asks"_n, get_self(), event, -row_bytes( *itr, 4 ) );
+      itr = asks_by_event.erase( itr );
+    }
+    if( itr == asks_by_event.end() || itr->event != event ) stage = PURGE_NFTS;
+  }
+
+  if( stage == PURGE_NFTS ) {
+    auction_index auctions_table( get_self(), get_self().value );
+    shared_index shared_table( get_self(), get_self().value );
+    share_expiry_index expiry_table( get_self(), get_self().value );
+    live_bid_index bids_table( get_self(), event );
+    auto& nfts_table = nfts_in( event );
+    auto itr = nfts_table.begin();
+    for( ; itr != nfts_table.end() && erased < max_rows; erased++ ) {
+      if( itr->flags & NFT_AUCTIONED ) {
+        auto auction = auctions_table.find( itr->id );
+        if( auction != auctions_table.end() ) {
+          // the held bid goes back to its bidder
+          if( auction->bidder != 0 && auction->escrowed.value_or( false ) ) {
+            credit_user( auction->bidder, auction->current_price );
+          }
+          auto live = bids_table.find( itr->id );
+          if( live != bids_table.end() ) {
+            count_row( "livebids"_n, get_self(), event, -row_bytes( *live, 1 ) );
+            bids_table.erase( live );
+          }
+          count_row( "auctions"_n, get_self(), event, -row_bytes( *auction, 3 ) );
+          auctions_table.erase( auction );
+        }
+      }
+      if( itr->flags & NFT_SHARED ) {
+        auto shared = shared_table.find( itr->id );
+        if( shared != shared_table.end() ) {
+          if( shared->expiration.has_value() ) {
+            const auto& expiry = expiry_table.get( itr->id, "Share expiry does not exist" );
+            count_row( "shareexpiry"_n, get_self(), event, -row_bytes( expiry, 1 ) );
+            expiry_table.erase( expiry );
+          }
+          count_row( "sharednfts"_n, get_self(), event, -row_bytes( *shared, 1 ) );
+          shared_table.erase( shared );
+        }
+      }
+      take_balance( itr->owner, itr->nft_category_id, 1 );
+      count_row( "nftsv2"_n, payer_of( itr->nft_category_id ), event, -row_bytes( *itr, 1 ) );
+      itr = nfts_table.erase( itr );
+    }
+    if( itr == nfts_table.end() ) stage = PURGE_RANGES;
   }
-}
 
-void nfts::changeowner(const uint64_t& from, const uint64_t& to, vector<uint64_t> nft_ids, const string& memo, bool istransfer) {
+  if( stage == PURGE_RANGES ) {
+    nft_range_index ranges_table( get_self(), event );
+    auto itr = ranges_table.begin();
+    for( ; itr != ranges_table.end() && erased < max_rows; erased++ ) {
+      take_balance( itr->owner, itr->nft_category_id, itr->count );
+      count_row( "nftranges"_n, payer_of( itr->nft_category_id ), event, -row_bytes( *itr, 1 ) );
+      itr = ranges_table.erase( itr );
+    }
+    if( itr == ranges_table.end() ) stage = PURGE_LEGACY;
+  }
 
-  nft_index nfts_table(get_self(), get_self().value);
-  lock_index lockednfts_table(get_self(), get_self().value);
+  if( stage == PURGE_LEGACY ) {
+    // rows never converted to the compact format, their balance is only known while the category exists
+    legacy_nft_index legacy_table( get_self(), get_self().value );
+    lock_index locks_table( get_self(), get_self().value );
+    stat_index nfts_stats_table( get_self(), event );
+    auto legacy_by_event = legacy_table.get_index<"byeve"_n>();
+    auto itr = legacy_by_event.lower_bound( event );
+    for( ; itr != legacy_by_event.end() && itr->event == event && erased < max_rows; erased++ ) {
+      auto lock = locks_table.find( itr->id );
+      if( lock != locks_table.end() ) {
+        locks_table.erase( lock );
+      }
+      auto nft_stats = nfts_stats_table.find( itr->nft_name.value );
+      if( nft_stats != nfts_stats_table.end() ) {
+        take_balance( itr->owner, nft_stats->nft_category_id, 1 );
+      }
+      itr = legacy_by_event.erase( itr );
+    }
+    if( itr == legacy_by_event.end() || itr->event != event ) stage = PURGE_IDS;
+  }
 
-  for( auto const& nft_id : nft_ids ) {
-    const auto& nft = nfts_table.get( nft_id, "NFT not found");
+  uint64_t next_id = state->next_id;
+  if( stage == PURGE_IDS ) {
+    // id blocks of all events share one table without an event index, so it is walked once from where the last
+    // call stopped. Blocks of other events are not erased but count against max_rows, they cost the same reads
+    range_index ranges_table( get_self(), get_self().value );
+    stat_index nfts_stats_table( get_self(), event );
+    // blocks are counted against the issuer, as most of them are paid by its mints
+    const name payer = nfts_stats_table.begin() != nfts_stats_table.end() ? nfts_stats_table.begin()->issuer : get_self();
+    auto itr = ranges_table.lower_bound( next_id );
+    for( uint64_t skipped = 0; itr != ranges_table.end() && erased + skipped < max_rows; ) {
+      if( itr->event != event ) {
+        skipped++;
+        itr++;
+        continue;
+      }
+      count_row( "idranges"_n, payer, event, -row_bytes( *itr, 0 ) );
+      itr = ranges_table.erase( itr );
+      erased++;
+    }
+    range_cache.clear();
+    if( itr == ranges_table.end() ) {
+      stage = PURGE_STATS;
+    } else {
+      next_id = itr->first_id;
+    }
+  }
 
-    stat_index nfts_stats_table( get_self(), nft.event );
-    const auto& nft_stat = nfts_stats_table.get( nft.nft_name.value, "A NFT with this name does not exist in this event" );
-    require_auth( nft_stat.issuer); // ensure that only issuer can call the action
+  if( stage == PURGE_STATS ) {
+    // categories left behind when the event was deleted without deletestats
+    stat_index nfts_stats_table( get_self(), event );
+    category_index categories_table( get_self(), get_self().value );
+    auto itr = nfts_stats_table.begin();
+    for( ; itr != nfts_stats_table.end() && erased < max_rows; erased++ ) {
+      auto category = categories_table.find( itr->nft_category_id );
+      if( category != categories_table.end() ) {
+        count_row( "categories"_n, itr->issuer, event, -row_bytes( *category, 0 ) );
+        categories_table.erase( category );
+      }
+      count_row( "nftstats"_n, itr->issuer, event, -row_bytes( *itr, 0 ) );
+      itr = nfts_stats_table.erase( itr );
+    }
+    if( itr == nfts_stats_table.end() ) stage = PURGE_DONE;
+  }
 
-    if( istransfer ) {
-      check( nft.owner == from, "Must be the owner");
-      check( nft_stat.transferable == true, "Not transferable");
-      auto locked_nft = lockednfts_table.find( nft_id);
-      check( locked_nft == lockednfts_table.end(), "NFT is locked, so it cannot transferred");
+  for( const auto& [key, quantity] : balances ) {
+    account_index accounts_table( get_self(), key.first );
+    auto account = accounts_table.find( key.second );
+    if( account != accounts_table.end() ) {
+      sub_balance( key.first, key.second, asset( std::min( uint64_t(account->amount.amount), quantity ), account->amount.symbol ) );
     }
+  }
 
-    nfts_table.modify( nft, same_payer, [&] ( auto& t ){
-      t.owner = to;
+  const purge_progress progress{ stage, erased, state->erased + erased, stage == PURGE_DONE };
+  if( progress.done ) {
+    count_row( "purges"_n, get_self(), event, -row_bytes( *state, 0 ) );
+    purges_table.erase( state );
+  } else {
+    purges_table.modify( state, same_payer, [&]( auto& p ){
+      p.stage = stage;
+      p.erased = progress.total_erased;
+      p.next_id = next_id;
     });
-
-    asset quantity( 1, nft_stat.max_supply.symbol );
-    sub_balance( from, nft_stat.nft_category_id, quantity );
-    add_balance( to, get_self(), nft.event, nft.nft_name, nft_stat.nft_category_id, quantity );
   }
+  return progress;
 }
 
-EOSIO_DISPATCH(nfts, (setconfig)(createacc)(createnft)(deleteeve)(deletestats)(issue)(transfer)(listsale)(closesale)(share)(unshare)(buy)(createauctn)(closeauctn)(bid)(finalize))
+ACTION nfts::migratenfts(uint64_t max_rows)
+{
+  count_action( "migratenfts"_n );
+  require_auth(get_self());
+  check( max_rows > 0, "max_rows must be positive" );
+
+  // converted rows are erased from the legacy table, so every call resumes where the last one stopped
+  legacy_nft_index legacy_table( get_self(), get_self().value );
+
+  for( auto itr = legacy_table.begin(); itr != legacy_table.end() && max_rows > 0; max_rows-- ) {
+    convert_nft( *itr );
+    itr = legacy_table.erase( itr );
+  }
+}
+
+ACTION nfts::migratelocks(uint64_t max_rows)
+{
+  count_action( "migratelocks"_n );
+  require_auth(get_self());
+  check( max_rows > 0, "max_rows must be positive" );
+
+  // moves each remaining lock row into the flags of its nft, erased rows make the next call resume
+  lock_index lockednfts_table( get_self(), get_self().value );
+  auction_index auctions_table( get_self(), get_self().value );
+
+  for( auto itr = lockednfts_table.begin(); itr != lockednfts_table.end() && max_rows > 0; max_rows-- ) {
+    uint64_t nft_id = itr->nft_id;
+    itr = lockednfts_table.erase( itr );
+
+    const auto nft = find_nft( nft_id );
+    if( nft == nullptr ) continue;
+
+    uint8_t lock = auctions_table.find( nft_id ) != auctions_table.end() ? NFT_AUCTIONED : NFT_LISTED;
+    modify_nft( *nft, [&]( auto& t ){
+      t.flags |= lock;
+    });
+  }
+}
+
+ACTION nfts::migratescope(uint64_t max_rows)
+{
+  count_action( "migratescope"_n );
+  require_auth(get_self());
+  check( max_rows > 0, "max_rows must be positive" );
+
+  // moves compact rows from the contract scope to the scope of their event, moved rows are erased so the next call resumes
+  auto& unscoped_table = nfts_in( get_self().value );
+  for( auto itr = unscoped_table.begin(); itr != unscoped_table.end() && max_rows > 0; max_rows-- ) {
+    const nft row = *itr;
+    itr = unscoped_table.erase( itr );
+    // the category was deleted or purged, no action can use this NFT anymore
+    const auto category = find_category( row.nft_category_id );
+    if( category != nullptr ) {
+      // rows were minted into the contract scope on the issuer's RAM
+      count_row( "nftsv2"_n, category->stats.issuer, category->nft_category.event, -row_bytes( row, 1 ) );
+      shard_nft( row, category->nft_category.event );
+    }
+  }
+}
+
+ACTION nfts::migratesplit(uint64_t event)
+{
+  count_action( "migratesplit"_n );
+  require_auth(get_self());
+
+  // an event has a handful of categories, all of them are converted at once. royalty_bps grows rows
+  // the issuer pays for, so the issuer signs too
+  stat_index nfts_stats_table( get_self(), event );
+  for( auto itr = nfts_stats_table.begin(); itr != nfts_stats_table.end(); itr++ ) {
+    if( itr->royalty_bps.has_value() ) {
+      continue;
+    }
+    require_issuer( itr->issuer );
+    nfts_stats_table.modify( itr, same_payer, [&]( auto& stats ){
+      stats.royalty_bps = split_to_bps( stats.sale_split );
+      stats.sale_split = 0;
+    });
+  }
+}
+
+ACTION nfts::initmarket(uint64_t event)
+{
+  count_action( "initmarket"_n );
+  require_auth(get_self());
+
+  event_index events_table( get_self(), get_self().value );
+  events_table.get( event, "No event with this id" );
+  market_index markets_table( get_self(), get_self().value );
+  check( markets_table.find( event ) == markets_table.end(), "Market of this event already exists" );
+
+  market m{ event, 0, 0, asset( 0, COME_SYMBOL ), 0, 0, asset( 0, COME_SYMBOL ), 0, 0, asset( 0, COME_SYMBOL ) };
+
+  // asks of the event in price order, the first one is the floor
+  ask_index asks_table( get_self(), get_self().value );
+  auto asks_by_price = asks_table.get_index<"byeventprice"_n>();
+  for( auto itr = asks_by_price.lower_bound( uint128_t(event) << 64 ); itr != asks_by_price.end() && itr->event == event; itr++ ) {
+    if( m.active_asks++ == 0 ) {
+      m.floor_price = asset( int64_t(itr->get_unit_price()), itr->ask_price.symbol );
+      m.floor_batch_id = itr->batch_id;
+    }
+    m.listed_units += itr->nft_ids.size();
+  }
+
+  // auctions are not indexed by event, they are all read once here
+  auction_index auctions_table( get_self(), get_self().value );
+  live_bid_index bids_table( get_self(), event );
+  for( const auto& auction : auctions_table ) {
+    if( auction.event != event ) {
+      continue;
+    }
+    m.open_auctions++;
+    if( auction.bidder == 0 ) {
+      continue;
+    }
+    auto created = bids_table.emplace( get_self(), [&]( auto& b ){
+      b.nft_id = auction.nft_id;
+      b.bid_price = auction.current_price;
+    });
+    count_row( "livebids"_n, get_self(), event, row_bytes( *created, 1 ) );
+    if( auction.current_price > m.highest_bid ) {
+      m.highest_bid = auction.current_price;
+      m.highest_bid_nft_id = auction.nft_id;
+    }
+  }
+
+  auto created = markets_table.emplace( get_self(), [&]( auto& row ){
+    row = m;
+  });
+  count_row( "markets"_n, get_self(), event, row_bytes( *created, 0 ) );
+}
+
+void nfts::deposit(name from, name to, asset quantity, string memo)
+{
+  // withdrawals notify the contract too
+  if( to != get_self() || from == get_self() ) {
+    return;
+  }
+
+  // a deposit before the token is configured would be credited to no one, so it is refused.
+  // Once it is, only COME of the configured token contract is credited, other tokens are left unassigned
+  config_index config_table( get_self(), get_self().value );
+  check( config_table.exists(), "Config table does not exist" );
+  const auto token_contract = config_table.get().token_contract;
+  check( token_contract.value_or() != name(), "COME token contract is not configured" );
+  if( get_first_receiver() != *token_contract ) {
+    return;
+  }
+
+  count_action( "deposit"_n );
+  check( quantity.symbol == COME_SYMBOL, "Only COME can be deposited" );
+  const uint64_t user = parse_user_id( memo );
+  user_index user_table( get_self(), get_self().value );
+  check( user_table.find( user ) != user_table.end(), "User with this id doesn't exist" );
+
+  credit_user( user, quantity );
+}
+
+ACTION nfts::withdraw(uint64_t user, name to, asset quantity, string memo)
+{
+  count_action( "withdraw"_n );
+  require_auth(get_self());
+  check( quantity.symbol == COME_SYMBOL, "Only COME can be withdrawn" );
+  check( quantity.amount > 0, "Amount must be positive" );
+  check( memo.size() <= 256, "Memo has more than 256 bytes" );
+  check( is_account( to ), "Recipient account does not exist" );
+
+  debit_user( user, quantity );
+  send_come( to, quantity, memo );
+}
+
+ACTION nfts::claimroyalty(name issuer, asset quantity)
+{
+  count_action( "claimroyalty"_n );
+  require_auth( issuer );
+  check( quantity.symbol == COME_SYMBOL, "Only COME can be withdrawn" );
+  check( quantity.amount > 0, "Amount must be positive" );
+
+  issuer_funds_index royalties_table( get_self(), get_self().value );
+  const auto& funds = royalties_table.get( issuer.value, "No royalties to claim" );
+  check( funds.balance >= quantity, "Not enough royalties to claim" );
+  if( funds.balance == quantity ) {
+    count_row( "royalties"_n, get_self(), get_self().value, -row_bytes( funds, 0 ) );
+    royalties_table.erase( funds );
+  } else {
+    royalties_table.modify( funds, same_payer, [&]( auto& f ){
+      f.balance -= quantity;
+    });
+  }
+
+  send_come( issuer, quantity, "royalties" );
+}
+
+nfts::metrics_snapshot nfts::getmetrics(uint64_t from_event, uint32_t limit)
+{
+  check( limit > 0, "limit must be positive" );
+
+  metrics_snapshot snapshot;
+  action_counter_index actions_table( get_self(), get_self().value );
+  snapshot.totals.actions.assign( actions_table.begin(), actions_table.end() );
+
+  // totals are summed over every event here, so that actions write the counters of their events only
+  event_metrics_index event_metrics_table( get_self(), get_self().value );
+  for( const auto& event_row : event_metrics_table ) {
+    const bool listed = event_row.event >= from_event && snapshot.events.size() < limit;
+    if( listed ) {
+      snapshot.events.push_back( event_report{ event_row.event, {}, 0 } );
+    }
+    table_counter_index counters_table( get_self(), event_row.event );
+    for( const auto& counter : counters_table ) {
+      auto total = find_if( snapshot.totals.tables.begin(), snapshot.totals.tables.end(), [&]( const auto& t ){ return t.table == counter.table; } );
+      if( total == snapshot.totals.tables.end() ) {
+        snapshot.totals.tables.push_back( table_counter{ counter.table } );
+        total = snapshot.totals.tables.end() - 1;
+      }
+      total->created += counter.created;
+      total->erased += counter.erased;
+      total->billed_bytes += counter.billed_bytes;
+      if( listed ) {
+        snapshot.events.back().tables.push_back( counter );
+        snapshot.events.back().billed_bytes += counter.billed_bytes;
+      }
+    }
+  }
+  return snapshot;
+}
+
+vector<nfts::payer_metrics> nfts::getpayers(name from_payer, uint32_t limit)
+{
+  check( limit > 0, "limit must be positive" );
+
+  vector<payer_metrics> payers;
+  payer_metrics_index payer_metrics_table( get_self(), get_self().value );
+  for( auto itr = payer_metrics_table.lower_bound( from_payer.value ); itr != payer_metrics_table.end() && payers.size() < limit; itr++ ) {
+    payers.push_back( *itr );
+  }
+  return payers;
+}
+
+nfts::inventory_page nfts::getinventory(uint64_t owner, uint64_t from_category, uint64_t from_id, uint32_t limit, binary_extension<uint64_t> event)
+{
+  check( limit > 0, "limit must be positive" );
+
+  // nfts of the owner in (category, id) order, the balances of the owner name the categories and the event they are stored in
+  inventory_page page;
+  auction_index auctions_table( get_self(), get_self().value );
+  account_index accounts_table( get_self(), owner );
+  for( auto account = accounts_table.lower_bound( from_category ); account != accounts_table.end(); account++ ) {
+    // the tickets of one event, as asked for at check-in
+    if( event.has_value() && account->event != event.value() ) continue;
+
+    const uint64_t nft_category_id = account->nft_category_id;
+    const uint128_t key = (uint128_t(owner) << 64) | nft_category_id;
+    auto nfts_by_owner = nfts_in( account->event ).get_index<"byownercat"_n>();
+    nft_range_index ranges_table( get_self(), account->event );
+    auto ranges_by_owner = ranges_table.get_index<"byownercat"_n>();
+    auto row = nfts_by_owner.lower_bound( key );
+    auto range = ranges_by_owner.lower_bound( key );
+    uint64_t from = nft_category_id == from_category ? from_id : 0;
+
+    // the single rows and the ranges of the owner are both in id order, merged into one list
+    for( ;; ) {
+      const bool in_rows = row != nfts_by_owner.end() && row->get_byownercat() == key;
+      const bool in_ranges = range != ranges_by_owner.end() && range->get_byownercat() == key;
+      if( !in_rows && !in_ranges ) break;
+      if( in_rows && row->id < from ) {
+        row++;
+        continue;
+      }
+      if( in_ranges && range->first_id + range->count <= from ) {
+        range++;
+        continue;
+      }
+
+      const uint64_t range_id = in_ranges ? std::max( range->first_id, from ) : 0;
+      const nft item = in_rows && ( !in_ranges || row->id < range_id ) ? *row++ : range->member( range_id );
+      from = item.id + 1;
+      if( page.items.size() == limit ) {
+        page.next = inventory_cursor{ nft_category_id, item.id };
+        return page;
+      }
+
+      const auto& category = get_category( item.nft_category_id );
+      std::optional<asset> auction_price;
+      if( item.flags & NFT_AUCTIONED ) {
+        auto auction = auctions_table.find( item.id );
+        if( auction != auctions_table.end() ) {
+          auction_price = auction->current_price;
+        }
+      }
+
+      page.items.push_back( inventory_item{ item.id, item.serial_number, account->event, category.nft_category.nft_name,
+                                            category.stats.base_uri, item.relative_uri, item.flags, auction_price } );
+    }
+  }
+  return page;
+}
+
+nfts::ask_page nfts::getasks(uint64_t event, uint64_t from_unit_price, uint64_t from_batch_id, uint32_t limit)
+{
+  check( limit > 0, "limit must be positive" );
+
+  // unexpired asks of the event, cheapest first, asks of the same price in batch id order
+  ask_page page;
+  ask_index asks_table( get_self(), get_self().value );
+  auto asks_by_price = asks_table.get_index<"byeventprice"_n>();
+  const auto now = time_point_sec(current_time_point());
+
+  for( auto itr = asks_by_price.lower_bound( (uint128_t(event) << 64) | from_unit_price ); itr != asks_by_price.end() && itr->event == event; itr++ ) {
+    if( itr->get_unit_price() == from_unit_price && itr->batch_id < from_batch_id ) continue;
+    if( itr->expiration <= now ) continue;
+    if( page.items.size() == limit ) {
+      page.next = ask_cursor{ itr->get_unit_price(), itr->batch_id };
+      break;
+    }
+
+    name nft_name = itr->nft_category_id.has_value() ? get_category( itr->nft_category_id.value() ).nft_category.nft_name : name();
+    page.items.push_back( ask_item{ itr->batch_id, itr->seller, itr->nft_ids, nft_name, itr->ask_price,
+                                    asset( itr->get_unit_price(), itr->ask_price.symbol ), itr->expiration } );
+  }
+  return page;
+}
+
+std::optional<nfts::ask_item> nfts::getnftask(uint64_t nft_id)
+{
+  // the nft row names its ask, nfts listed before that, or still in the legacy table, are not found
+  auto& nfts_table = nfts_in( nft_scope( nft_id ) );
+  auto nft = nfts_table.find( nft_id );
+  if( nft == nfts_table.end() || !(nft->flags & NFT_LISTED) || !nft->listed_in.has_value() ) {
+    return {};
+  }
+
+  ask_index asks_table( get_self(), get_self().value );
+  auto ask = asks_table.find( nft->listed_in.value() );
+  if( ask == asks_table.end() ) {
+    return {};
+  }
+  return ask_item{ ask->batch_id, ask->seller, ask->nft_ids, get_category( nft->nft_category_id ).nft_category.nft_name, ask->ask_price,
+                   asset( ask->get_unit_price(), ask->ask_price.symbol ), ask->expiration };
+}
+
+nfts::bid_page nfts::getbids(uint64_t bidder, uint64_t from_nft_id, uint32_t limit)
+{
+  check( limit > 0, "limit must be positive" );
+
+  // auctions the bidder is currently winning, in nft id order
+  bid_page page;
+  auction_index auctions_table( get_self(), get_self().value );
+  auto auctions_by_bidder = auctions_table.get_index<"bybidder"_n>();
+
+  for( auto itr = auctions_by_bidder.lower_bound( bidder ); itr != auctions_by_bidder.end() && itr->bidder == bidder; itr++ ) {
+    if( itr->nft_id < from_nft_id ) continue;
+    if( page.items.size() == limit ) {
+      page.next = itr->nft_id;
+      break;
+    }
+
+    // nfts still in the legacy table are returned without their metadata
+    bid_item item{ *itr, 0, name() };
+    auto& nfts_table = nfts_in( nft_scope( itr->nft_id ) );
+    auto nft = nfts_table.find( itr->nft_id );
+    if( nft != nfts_table.end() ) {
+      item.serial_number = nft->serial_number;
+      item.nft_name = get_category( nft->nft_category_id ).nft_category.nft_name;
+    }
+    page.items.push_back( item );
+  }
+  return page;
+}
+
+void nfts::checkasset(const asset& amount) {
+  auto sym = amount.symbol;
+  check( sym.precision() == 0, "Symbol must be an int, with precision of 0" );
+  check( amount.amount >= 1, "Amount must be >=1");
+  check( sym.code() == CTT_CODE, "Symbol must be CTT" );
+  check( amount.is_valid(), "Invalid amount");
+}
+
+// Helper function to check the nfts an account would hold of a category, the message is only formatted when the check fails
+void nfts::check_max_per_account(const nft_stat& nft_stats, const uint64_t& quantity, const uint64_t& held)
+{
+  if( quantity > nft_stats.max_per_account || quantity + held > nft_stats.max_per_account ) {
+    check( false, "Every account is able to buy " + to_string(nft_stats.max_per_account) + " NFTs" );
+  }
+}
+
+// Helper function to reserve a block of consecutive nft ids from the sequence kept in the config singleton
+uint64_t nfts::reserve_nft_ids(const uint64_t& count)
+{
+  config_index config_table( get_self(), get_self().value );
+  check( config_table.exists(), "Config table does not exist" );
+  auto config_singleton = config_table.get();
+  init_next_nft_id( config_singleton );
+
+  uint64_t first_id = config_singleton.next_nft_id.value();
+  check( first_id + count > first_id, "No more nft ids available" );
+  config_singleton.next_nft_id.emplace( first_id + count );
+  config_table.set( config_singleton, get_self() );
+
+  return first_id;
+}
+
+// Helper function to start the id sequence of configs created before it existed, after the highest id in use
+void nfts::init_next_nft_id(tokenconfigs& config)
+{
+  if( !config.next_nft_id.has_value() ) {
+    legacy_nft_index legacy_table( get_self(), get_self().value );
+    config.next_nft_id.emplace( std::max( nfts_in( get_self().value ).available_primary_key(), legacy_table.available_primary_key() ) );
+  }
+}
+
+// Helper function to take the id of a new ask from the sequence kept in the config singleton
+uint64_t nfts::reserve_batch_id()
+{
+  config_index config_table( get_self(), get_self().value );
+  check( config_table.exists(), "Config table does not exist" );
+  auto config_singleton = config_table.get();
+  if( !config_singleton.next_batch_id.has_value() ) {
+    // extensions are packed in order, the ones before next_batch_id must be present
+    init_next_nft_id( config_singleton );
+    if( !config_singleton.token_contract.has_value() ) {
+      config_singleton.token_contract.emplace();
+    }
+    // asks listed before the sequence are keyed by their first nft id, the sequence starts after them
+    ask_index asks_table( get_self(), get_self().value );
+    config_singleton.next_batch_id.emplace( asks_table.available_primary_key() );
+  }
+
+  uint64_t batch_id = config_singleton.next_batch_id.value();
+  config_singleton.next_batch_id.emplace( batch_id + 1 );
+  config_table.set( config_singleton, get_self() );
+
+  return batch_id;
+}
+
+// Helper function to mint NFTs for a list of recipients with a single table handle and id reservation
+void nfts::mint(const vector<pair<uint64_t, uint64_t>>& recipients_and_counts, const uint64_t& event, const nft_stat& nft_stats, const uint64_t& quantity, const string& relative_uri, const name& ram_payer)
+{
+  check_event_open( event );
+  auto& nfts_table = nfts_in( event );
+  uint64_t first_id = reserve_nft_ids( quantity );
+  cover_ids( first_id, quantity, event, ram_payer );
+
+  // the uri suffix is only stored when it adds something to the category base_uri
+  std::optional<string> uri;
+  if( !relative_uri.empty() && relative_uri != nft_stats.base_uri ) {
+    uri = relative_uri;
+  }
+
+  // a single nft gets its row right away, larger blocks are stored as a range until their nfts are touched
+  nft_range_index ranges_table( get_self(), event );
+  uint64_t i = 0;
+  for( const auto& [to, count] : recipients_and_counts ) {
+    if( count > 1 ) {
+      auto created = ranges_table.emplace( ram_payer, [&]( auto& r ){
+        r.first_id = first_id + i;
+        r.count = count;
+        r.first_serial = nft_stats.issued_supply.amount + i + 1;
+        r.owner = to;
+        r.nft_category_id = nft_stats.nft_category_id;
+        r.relative_uri = uri;
+      });
+      count_row( "nftranges"_n, ram_payer, event, row_bytes( *created, 1 ) );
+      i += count;
+      continue;
+    }
+
+    auto minted = nfts_table.emplace( ram_payer, [&]( auto& t ){
+      t.id = first_id + i;
+      t.serial_number = nft_stats.issued_supply.amount + i + 1;
+      t.owner = to;
+      t.nft_category_id = nft_stats.nft_category_id;
+      t.flags = 0;
+      t.relative_uri = uri;
+    });
+    count_row( "nftsv2"_n, ram_payer, event, row_bytes( *minted, 1 ) );
+    i++;
+  }
+}
+
+// Helper function to hash a leaf of a drop, see the drop table
+checksum256 nfts::merkle_leaf(const uint64_t& leaf_index, const uint64_t& to, const uint64_t& nft_category_id, const uint64_t& count)
+{
+  char buffer[33];
+  datastream<char*> ds( buffer, sizeof(buffer) );
+  ds << uint8_t(0) << leaf_index << to << nft_category_id << count;
+  return sha256( buffer, sizeof(buffer) );
+}
+
+// Helper function to hash two sibling nodes of a drop
+checksum256 nfts::merkle_node(const checksum256& left, const checksum256& right)
+{
+  char buffer[65];
+  datastream<char*> ds( buffer, sizeof(buffer) );
+  ds << uint8_t(1) << left << right;
+  return sha256( buffer, sizeof(buffer) );
+}
+
+// Helper function to resolve a category and its stats, read once per action
+const nfts::category_stats& nfts::get_category(const uint64_t& nft_category_id)
+{
+  auto cached = category_cache.find( nft_category_id );
+  if( cached != category_cache.end() ) {
+    return cached->second;
+  }
+
+  category_index categories_table( get_self(), get_self().value );
+  const auto& category = categories_table.get( nft_category_id, "NFT category does not exist" );
+  stat_index nfts_stats_table( get_self(), category.event );
+  const auto& nft_stats = nfts_stats_table.get( category.nft_name.value, "A NFT with this name does not exist in this event" );
+
+  return category_cache.emplace( nft_category_id, category_stats{ category, nft_stats } ).first->second;
+}
+
+// Helper function to resolve a category and its stats like get_category, nullptr when either row is gone
+const nfts::category_stats* nfts::find_category(const uint64_t& nft_category_id)
+{
+  auto cached = category_cache.find( nft_category_id );
+  if( cached != category_cache.end() ) {
+    return &cached->second;
+  }
+
+  category_index categories_table( get_self(), get_self().value );
+  auto category = categories_table.find( nft_category_id );
+  if( category == categories_table.end() ) {
+    return nullptr;
+  }
+  stat_index nfts_stats_table( get_self(), category->event );
+  auto nft_stats = nfts_stats_table.find( category->nft_name.value );
+  if( nft_stats == nfts_stats_table.end() ) {
+    return nullptr;
+  }
+
+  return &category_cache.emplace( nft_category_id, category_stats{ *category, *nft_stats } ).first->second;
+}
+
+// Helper function to require the authority of an issuer once per action
+void nfts::require_issuer(const name& issuer)
+{
+  if( find( authorized_issuers.begin(), authorized_issuers.end(), issuer ) == authorized_issuers.end() ) {
+    require_auth( issuer );
+    authorized_issuers.push_back( issuer );
+  }
+}
+
+// Helper function to open the nft table of a scope once per action
+nfts::nft_index& nfts::nfts_in(const uint64_t& scope)
+{
+  return nft_tables.try_emplace( scope, get_self(), scope ).first->second;
+}
+
+// Helper function to refuse new rows in a deleted event, a running purge would leave them behind
+void nfts::check_event_open(const uint64_t& event)
+{
+  event_index events_table( get_self(), get_self().value );
+  check( events_table.find( event ) != events_table.end(), "No event with this id" );
+}
+
+// Helper function to resolve the scope of a NFT from the id block it was minted in
+uint64_t nfts::nft_scope(const uint64_t& nft_id)
+{
+  for( const auto& range : range_cache ) {
+    if( nft_id >= range.first_id && nft_id - range.first_id < range.count ) {
+      return range.event;
+    }
+  }
+
+  range_index ranges_table( get_self(), get_self().value );
+  auto range = ranges_table.upper_bound( nft_id );
+  if( range != ranges_table.begin() ) {
+    range--;
+    if( nft_id - range->first_id < range->count ) {
+      range_cache.push_back( *range );
+      return range->event;
+    }
+  }
+
+  // minted before nfts were scoped by event and not moved yet
+  return get_self().value;
+}
+
+// Helper function to record that a block of ids is stored in the scope of an event, extending the block before it when possible.
+// A new block is paid by whoever pays for the nfts in it
+void nfts::cover_ids(const uint64_t& first_id, const uint64_t& count, const uint64_t& event, const name& ram_payer)
+{
+  range_index ranges_table( get_self(), get_self().value );
+  auto range = ranges_table.upper_bound( first_id );
+  if( range != ranges_table.begin() ) {
+    range--;
+    if( range->event == event && range->first_id + range->count == first_id ) {
+      ranges_table.modify( range, same_payer, [&]( auto& r ){
+        r.count += count;
+      });
+      range_cache.clear();
+      range_cache.push_back( *range );
+      return;
+    }
+  }
+
+  auto created = ranges_table.emplace( ram_payer, [&]( auto& r ){
+    r.first_id = first_id;
+    r.count = count;
+    r.event = event;
+  });
+  count_row( "idranges"_n, ram_payer, event, row_bytes( *created, 0 ) );
+  range_cache.push_back( *created );
+}
+
+// Helper function to find a NFT, moving it first to the scope of its event if it is stored the old way
+const nfts::nft* nfts::find_nft(const uint64_t& nft_id)
+{
+  const uint64_t scope = nft_scope( nft_id );
+  auto& nfts_table = nfts_in( scope );
+  auto itr = nfts_table.find( nft_id );
+  if( scope != get_self().value ) {
+    return itr != nfts_table.end() ? &*itr : split_range( scope, nft_id );
+  }
+
+  if( itr != nfts_table.end() ) {
+    // left for migratescope, which drops it, when the category is gone
+    const auto category = find_category( itr->nft_category_id );
+    if( category == nullptr ) {
+      return nullptr;
+    }
+    const nft row = *itr;
+    count_row( "nftsv2"_n, category->stats.issuer, category->nft_category.event, -row_bytes( row, 1 ) );
+    nfts_table.erase( itr );
+    return &shard_nft( row, category->nft_category.event );
+  }
+
+  legacy_nft_index legacy_table( get_self(), get_self().value );
+  auto legacy = legacy_table.find( nft_id );
+  if( legacy == legacy_table.end() ) {
+    return nullptr;
+  }
+  const auto converted = convert_nft( *legacy );
+  legacy_table.erase( legacy );
+  return converted;
+}
+
+// Helper function to read a NFT, the row lives in the table of nfts_in( nft_scope( nft_id ) )
+const nfts::nft& nfts::get_nft(const uint64_t& nft_id, const char* error)
+{
+  const auto nft = find_nft( nft_id );
+  check( nft != nullptr, error );
+  return *nft;
+}
+
+// Helper function to give a NFT still stored in a range its own row, the rest of the range is kept in up to two ranges
+const nfts::nft* nfts::split_range(const uint64_t& event, const uint64_t& nft_id)
+{
+  nft_range_index ranges_table( get_self(), event );
+  auto range = ranges_table.upper_bound( nft_id );
+  if( range == ranges_table.begin() ) {
+    return nullptr;
+  }
+  range--;
+  const uint64_t before = nft_id - range->first_id;
+  if( before >= range->count ) {
+    return nullptr;
+  }
+
+  // the rows split off would land behind a purge that is done with them
+  check_event_open( event );
+  const nft_range split = *range;
+  const uint64_t after = split.count - before - 1;
+  if( before == 0 ) {
+    count_row( "nftranges"_n, get_self(), event, -row_bytes( split, 1 ) );
+    ranges_table.erase( range );
+  } else {
+    ranges_table.modify( range, same_payer, [&]( auto& r ){
+      r.count = before;
+    });
+  }
+
+  // the issuer may not sign the action that splits the range, so the new rows are paid by the contract
+  if( after > 0 ) {
+    auto created = ranges_table.emplace( get_self(), [&]( auto& r ){
+      r = split;
+      r.first_id = nft_id + 1;
+      r.count = after;
+      r.first_serial = split.first_serial + before + 1;
+    });
+    count_row( "nftranges"_n, get_self(), event, row_bytes( *created, 1 ) );
+  }
+
+  auto created = nfts_in( event ).emplace( get_self(), [&]( auto& t ){
+    t = split.member( nft_id );
+  });
+  count_row( "nftsv2"_n, get_self(), event, row_bytes( *created, 1 ) );
+  return &*created;
+}
+
+// Helper function to write a NFT row in the scope of its event
+const nfts::nft& nfts::shard_nft(const nft& row, const uint64_t& event)
+{
+  auto itr = nfts_in( event ).emplace( get_self(), [&]( auto& t ){
+    t = row;
+  });
+  count_row( "nftsv2"_n, get_self(), event, row_bytes( *itr, 1 ) );
+  cover_ids( row.id, 1, event, get_self() );
+  return *itr;
+}
+
+// Helper function to write the compact row of a legacy NFT, the caller erases the legacy row
+const nfts::nft* nfts::convert_nft(const nft_v1& legacy)
+{
+  stat_index nfts_stats_table( get_self(), legacy.event );
+  auto nft_stats = nfts_stats_table.find( legacy.nft_name.value );
+  if( nft_stats == nfts_stats_table.end() ) {
+    // the category was deleted, no action can use this NFT anymore
+    return nullptr;
+  }
+
+  category_index categories_table( get_self(), get_self().value );
+  if( categories_table.find( nft_stats->nft_category_id ) == categories_table.end() ) {
+    auto created = categories_table.emplace( get_self(), [&]( auto& c ){
+      c.nft_category_id = nft_stats->nft_category_id;
+      c.event = legacy.event;
+      c.nft_name = legacy.nft_name;
+    });
+    count_row( "categories"_n, get_self(), legacy.event, row_bytes( *created, 0 ) );
+  }
+
+  uint8_t flags = 0;
+  // the lock row becomes a flag, locked NFTs without an auction are listed
+  lock_index lockednfts_table( get_self(), get_self().value );
+  auto lockednft = lockednfts_table.find( legacy.id );
+  if( lockednft != lockednfts_table.end() ) {
+    auction_index auctions_table( get_self(), get_self().value );
+    flags |= auctions_table.find( legacy.id ) != auctions_table.end() ? NFT_AUCTIONED : NFT_LISTED;
+    lockednfts_table.erase( lockednft );
+  }
+  if( legacy.shared_with != 0 ) {
+    shared_index shared_table( get_self(), get_self().value );
+    auto created = shared_table.emplace( get_self(), [&]( auto& s ){
+      s.nft_id = legacy.id;
+      s.shared_with = legacy.shared_with;
+    });
+    count_row( "sharednfts"_n, get_self(), legacy.event, row_bytes( *created, 1 ) );
+    flags |= NFT_SHARED;
+  }
+
+  std::optional<string> uri;
+  if( legacy.relative_uri.has_value() && !legacy.relative_uri->empty() && *legacy.relative_uri != nft_stats->base_uri ) {
+    uri = legacy.relative_uri;
+  }
+
+  return &shard_nft( nft{ legacy.id, legacy.serial_number, legacy.owner, nft_stats->nft_category_id, flags, uri, {} }, legacy.event );
+}
+
+// Helper function to add asset balance to user's account
+void nfts::add_balance(const uint64_t& owner, const name& ram_payer, const uint64_t& event, const name& nft_name, const uint64_t& nft_category_id, const asset& quantity )
+{
+  account_index to_acnts( get_self(), owner );
+  auto to = to_acnts.find( nft_category_id );
+  if( to == to_acnts.end() ) {
+    auto created = to_acnts.emplace( ram_payer, [&]( auto& a ){
+      a.nft_category_id = nft_category_id;
+      a.event = event;
+      a.nft_name = nft_name;
+      a.amount = quantity;
+    });
+    count_row( "accounts"_n, ram_payer, event, row_bytes( *created, 0 ) );
+  } else {
+    to_acnts.modify( to, same_payer, [&]( auto& a ){
+      a.amount += quantity;
+    });
+  }
+}
+
+// Helper function to subtract asset balance to user's account
+void nfts::sub_balance(const uint64_t& owner, const uint64_t& nft_category_id, const asset& quantity)
+{
+  account_index from_acnts( get_self(), owner );
+  auto from = from_acnts.find( nft_category_id );
+  check( from->amount.amount >= quantity.amount, "Quantity must be equal or less than account balance" );
+
+  if( from->amount.amount == quantity.amount ) {
+    // balances are always paid by the contract, see changeowner and issue
+    count_row( "accounts"_n, get_self(), from->event, -row_bytes( *from, 0 ) );
+    from_acnts.erase(from);
+  } else {
+    from_acnts.modify( from, same_payer, [&]( auto& a ){
+      a.amount -= quantity;
+    });
+  }
+}
+
+// Helper function to share an nft, or move or re-time an existing share; a share without expiration lasts until unshared
+void nfts::share_nft(shared_index& shared_table, share_expiry_index& expiry_table, const nft& nft, const uint64_t& to, const binary_extension<time_point_sec>& expiration)
+{
+  check( !(nft.flags & NFT_LOCKED), "NFT is locked, it cannot be shared");
+  const auto& category = get_category( nft.nft_category_id );
+  require_issuer( category.stats.issuer ); // ensure that only issuer can call the action
+  const uint64_t event = category.nft_category.event;
+  if( expiration.has_value() ) {
+    check( *expiration > time_point_sec(current_time_point()), "Share expiration must be in the future" );
+  }
+
+  auto shared = shared_table.find( nft.id );
+  const bool had_expiration = shared != shared_table.end() && shared->expiration.has_value();
+  if( shared == shared_table.end() ) {
+    auto created = shared_table.emplace( get_self(), [&]( auto& s ){
+      s.nft_id = nft.id;
+      s.shared_with = to;
+      s.expiration = expiration;
+    });
+    count_row( "sharednfts"_n, get_self(), event, row_bytes( *created, 1 ) );
+    modify_nft( nft, [&]( auto& t ){
+      t.flags |= NFT_SHARED;
+    });
+  } else {
+    shared_table.modify( shared, same_payer, [&]( auto& s ){
+      s.shared_with = to;
+      s.expiration = expiration;
+    });
+  }
+
+  // keep the expiry row in step with the share
+  if( expiration.has_value() ) {
+    if( had_expiration ) {
+      expiry_table.modify( expiry_table.get( nft.id, "Share expiry does not exist" ), same_payer, [&]( auto& e ){
+        e.expiration = *expiration;
+      });
+    } else {
+      auto created = expiry_table.emplace( get_self(), [&]( auto& e ){
+        e.nft_id = nft.id;
+        e.expiration = *expiration;
+      });
+      count_row( "shareexpiry"_n, get_self(), event, row_bytes( *created, 1 ) );
+    }
+  } else if( had_expiration ) {
+    const auto& expiry = expiry_table.get( nft.id, "Share expiry does not exist" );
+    count_row( "shareexpiry"_n, get_self(), event, -row_bytes( expiry, 1 ) );
+    expiry_table.erase( expiry );
+  }
+}
+
+// Helper function to end the share of an nft, if it is shared. The share is looked up before the nft,
+// as get_nft would split an nft that was never shared off its range for nothing
+void nfts::unshare_nft(shared_index& shared_table, share_expiry_index& expiry_table, const uint64_t& nft_id)
+{
+  if( shared_table.find( nft_id ) == shared_table.end() ) {
+    // a legacy row holds its share until get_nft converts it
+    legacy_nft_index legacy_table( get_self(), get_self().value );
+    auto legacy = legacy_table.find( nft_id );
+    if( legacy == legacy_table.end() || legacy->shared_with == 0 ) {
+      return;
+    }
+  }
+
+  const auto& nft = get_nft( nft_id, "NFT does not exist" );
+  const auto& category = get_category( nft.nft_category_id );
+  require_issuer( category.stats.issuer ); // ensure that only issuer can call the action
+  const uint64_t event = category.nft_category.event;
+
+  auto shared = shared_table.find( nft.id );
+  if( shared == shared_table.end() ) {
+    return;
+  }
+  if( shared->expiration.has_value() ) {
+    const auto& expiry = expiry_table.get( nft.id, "Share expiry does not exist" );
+    count_row( "shareexpiry"_n, get_self(), event, -row_bytes( expiry, 1 ) );
+    expiry_table.erase( expiry );
+  }
+  count_row( "sharednfts"_n, get_self(), event, -row_bytes( *shared, 1 ) );
+  shared_table.erase( shared );
+  modify_nft( nft, [&]( auto& t ){
+    t.flags &= ~NFT_SHARED;
+  });
+}
+
+// Helper function to hand the listed nfts of a seller to the buyer, unlocked
+void nfts::fill_ask(const uint64_t& seller, const vector<uint64_t>& nft_ids, const uint64_t& to)
+{
+  // moves and unlocks the nfts in one write each
+  changeowner( seller, to, nft_ids, false, false );
+}
+
+// Helper function to remove sold nfts from an ask, the ask is erased once nothing is left.
+// Callers price the sold nfts first, so the ask must have a unit price
+void nfts::take_from_ask(ask_index& asks_table, const ask& ask, const vector<uint64_t>& nft_ids)
+{
+  vector<uint64_t> sold( nft_ids );
+  sort( sold.begin(), sold.end() );
+  check( adjacent_find( sold.begin(), sold.end() ) == sold.end(), "Duplicate NFT in request" );
+
+  size_t found = count_if( ask.nft_ids.begin(), ask.nft_ids.end(), [&]( const auto& id ){ return binary_search( sold.begin(), sold.end(), id ); } );
+  check( found == sold.size(), "NFT is not part of this listing" );
+
+  const uint64_t event = ask.event, batch_id = ask.batch_id;
+  if( sold.size() == ask.nft_ids.size() ) {
+    count_row( "asks"_n, get_self(), ask.event, -row_bytes( ask, 4 ) );
+    asks_table.erase( ask );
+    market_unlisted( asks_table, event, batch_id, sold.size(), true );
+    return;
+  }
+
+  // the unit price, and so the byeventprice key, stays the same
+  asks_table.modify( ask, same_payer, [&]( auto& a ){
+    a.nft_ids.erase( remove_if( a.nft_ids.begin(), a.nft_ids.end(), [&]( const auto& id ){ return binary_search( sold.begin(), sold.end(), id ); } ), a.nft_ids.end() );
+    a.ask_price.amount -= a.unit_price->amount * int64_t(sold.size());
+  });
+  market_unlisted( asks_table, event, batch_id, sold.size(), false );
+}
+
+// Helper function to hand an ended auction to its winning bidder, or unlock the nft if nobody bid
+std::optional<nfts::sale_payout> nfts::settle_auction(const auction& auction)
+{
+  market_auction_closed( auction );
+  // the category can be gone, deleted before deletestats refused it while auctions were open. the bid then
+  // goes back and the nft stays with the seller, rather than one auction stopping finalize and the crank
+  const auto nft = find_nft( auction.nft_id );
+  const auto category = nft != nullptr ? find_category( nft->nft_category_id ) : nullptr;
+  if ( auction.bidder != 0 && category != nullptr ) {
+    market_sold( auction.event, 1, auction.current_price );
+    // someone has a winning bid for this auction
+    const auto& nft_stats = category->stats;
+    const auto payout = split_sale( auction.seller, nft_stats, auction.current_price );
+    changeowner( auction.seller, auction.bidder, auction.nft_id, false, true );
+    // bids placed before the ledger were never paid for, so there is nothing to hand out
+    if( auction.escrowed.value_or( false ) ) {
+      pay_sale( payout );
+    }
+    return payout;
+  }
+
+  if( auction.bidder != 0 && auction.escrowed.value_or( false ) ) {
+    credit_user( auction.bidder, auction.current_price );
+  }
+  // no sale, unlock nft
+  if( nft != nullptr ) {
+    modify_nft( *nft, [&]( auto& t ){
+      t.flags &= ~NFT_AUCTIONED;
+    });
+  }
+  return std::nullopt;
+}
+
+// Helper function to count a new ask in the market of its event
+void nfts::market_listed(const ask& ask)
+{
+  market_index markets_table( get_self(), get_self().value );
+  auto market = markets_table.find( ask.event );
+  if( market == markets_table.end() ) {
+    return; // event created before markets, see initmarket
+  }
+
+  const asset unit_price( int64_t(ask.get_unit_price()), ask.ask_price.symbol );
+  markets_table.modify( market, same_payer, [&]( auto& m ){
+    m.active_asks++;
+    m.listed_units += ask.nft_ids.size();
+    if( m.active_asks == 1 || unit_price < m.floor_price ) {
+      m.floor_price = unit_price;
+      m.floor_batch_id = ask.batch_id;
+    }
+  });
+}
+
+// Helper function to take nfts off the market of an event, after they left the ask, and the ask itself if it was closed
+void nfts::market_unlisted(ask_index& asks_table, const uint64_t& event, const uint64_t& batch_id, const uint64_t& units, bool closed)
+{
+  market_index markets_table( get_self(), get_self().value );
+  auto market = markets_table.find( event );
+  if( market == markets_table.end() ) {
+    return;
+  }
+
+  // only a closed floor ask moves the floor, to the cheapest ask left
+  std::optional<ask> floor;
+  const bool floor_closed = closed && market->floor_batch_id == batch_id;
+  if( floor_closed ) {
+    auto asks_by_price = asks_table.get_index<"byeventprice"_n>();
+    auto cheapest = asks_by_price.lower_bound( uint128_t(event) << 64 );
+    if( cheapest != asks_by_price.end() && cheapest->event == event ) {
+      floor = *cheapest;
+    }
+  }
+
+  markets_table.modify( market, same_payer, [&]( auto& m ){
+    m.listed_units -= units;
+    if( closed ) {
+      m.active_asks--;
+    }
+    if( floor_closed ) {
+      m.floor_price = floor ? asset( int64_t(floor->get_unit_price()), floor->ask_price.symbol ) : asset( 0, COME_SYMBOL );
+      m.floor_batch_id = floor ? floor->batch_id : 0;
+    }
+  });
+}
+
+// Helper function to count a new auction in the market of its event
+void nfts::market_auction_opened(const uint64_t& event)
+{
+  market_index markets_table( get_self(), get_self().value );
+  auto market = markets_table.find( event );
+  if( market != markets_table.end() ) {
+    markets_table.modify( market, same_payer, [&]( auto& m ){
+      m.open_auctions++;
+    });
+  }
+}
+
+// Helper function to record a standing bid, bids only go up so it can only raise the highest bid
+void nfts::market_bid(const auction& auction, const asset& bid_price)
+{
+  market_index markets_table( get_self(), get_self().value );
+  auto market = markets_table.find( auction.event );
+  if( market == markets_table.end() ) {
+    return;
+  }
+
+  live_bid_index bids_table( get_self(), auction.event );
+  auto live = bids_table.find( auction.nft_id );
+  if( live == bids_table.end() ) {
+    auto created = bids_table.emplace( get_self(), [&]( auto& b ){
+      b.nft_id = auction.nft_id;
+      b.bid_price = bid_price;
+    });
+    count_row( "livebids"_n, get_self(), auction.event, row_bytes( *created, 1 ) );
+  } else {
+    bids_table.modify( live, same_payer, [&]( auto& b ){
+      b.bid_price = bid_price;
+    });
+  }
+
+  if( bid_price > market->highest_bid ) {
+    markets_table.modify( market, same_payer, [&]( auto& m ){
+      m.highest_bid = bid_price;
+      m.highest_bid_nft_id = auction.nft_id;
+    });
+  }
+}
+
+// Helper function to take an ended auction off the market of its event, with its standing bid
+void nfts::market_auction_closed(const auction& auction)
+{
+  market_index markets_table( get_self(), get_self().value );
+  auto market = markets_table.find( auction.event );
+  if( market == markets_table.end() ) {
+    return;
+  }
+
+  std::optional<live_bid> highest;
+  const bool highest_closed = auction.bidder != 0 && market->highest_bid.amount > 0 && market->highest_bid_nft_id == auction.nft_id;
+  if( auction.bidder != 0 ) {
+    live_bid_index bids_table( get_self(), auction.event );
+    auto live = bids_table.find( auction.nft_id );
+    if( live != bids_table.end() ) {
+      count_row( "livebids"_n, get_self(), auction.event, -row_bytes( *live, 1 ) );
+      bids_table.erase( live );
+    }
+    // only the auction with the highest bid moves it, to the highest bid left
+    if( highest_closed ) {
+      auto bids_by_price = bids_table.get_index<"byprice"_n>();
+      if( bids_by_price.begin() != bids_by_price.end() ) {
+        highest = *--bids_by_price.end();
+      }
+    }
+  }
+
+  markets_table.modify( market, same_payer, [&]( auto& m ){
+    m.open_auctions--;
+    if( highest_closed ) {
+      m.highest_bid = highest ? highest->bid_price : asset( 0, COME_SYMBOL );
+      m.highest_bid_nft_id = highest ? highest->nft_id : 0;
+    }
+  });
+}
+
+// Helper function to add a sale to the market of its event
+void nfts::market_sold(const uint64_t& event, const uint64_t& units, const asset& price)
+{
+  market_index markets_table( get_self(), get_self().value );
+  auto market = markets_table.find( event );
+  if( market != markets_table.end() ) {
+    markets_table.modify( market, same_payer, [&]( auto& m ){
+      m.sales += units;
+      m.volume += price;
+    });
+  }
+}
+
+// Helper function to split a sale price between the seller and the issuer. The royalty is
+// rounded down to the smallest unit of the price, the remainder goes to the seller
+nfts::sale_payout nfts::split_sale(const uint64_t& seller, const nft_stat& nft_stats, const asset& price)
+{
+  // categories that migratesplit has not converted yet still hold their share in sale_split
+  const uint16_t royalty_bps = nft_stats.royalty_bps.has_value() ? *nft_stats.royalty_bps : split_to_bps( nft_stats.sale_split );
+
+  const int64_t royalty = int64_t( uint128_t(price.amount) * royalty_bps / BPS_DENOMINATOR );
+  return sale_payout{ seller, nft_stats.issuer, asset( price.amount - royalty, price.symbol ), asset( royalty, price.symbol ) };
+}
+
+// Helper function to convert a legacy sale split, validated to lie in [0, 1], to basis points. The only
+// floating point left, for categories created before royalty_bps
+uint16_t nfts::split_to_bps(const double& sale_split)
+{
+  return uint16_t( sale_split * BPS_DENOMINATOR + 0.5 );
+}
+
+// Helper function to credit the proceeds of a sale to the seller and the royalty to the issuer
+void nfts::pay_sale(const sale_payout& payout)
+{
+  if( payout.proceeds.amount > 0 ) {
+    credit_user( payout.seller, payout.proceeds );
+  }
+  if( payout.royalty.amount > 0 ) {
+    issuer_funds_index royalties_table( get_self(), get_self().value );
+    auto funds = royalties_table.find( payout.issuer.value );
+    if( funds == royalties_table.end() ) {
+      auto created = royalties_table.emplace( get_self(), [&]( auto& f ){
+        f.issuer = payout.issuer;
+        f.balance = payout.royalty;
+      });
+      count_row( "royalties"_n, get_self(), get_self().value, row_bytes( *created, 0 ) );
+    } else {
+      royalties_table.modify( funds, same_payer, [&]( auto& f ){
+        f.balance += payout.royalty;
+      });
+    }
+  }
+}
+
+// Helper function to add COME to the funds of a user
+void nfts::credit_user(const uint64_t& user, const asset& quantity)
+{
+  user_funds_index funds_table( get_self(), get_self().value );
+  auto funds = funds_table.find( user );
+  if( funds == funds_table.end() ) {
+    auto created = funds_table.emplace( get_self(), [&]( auto& f ){
+      f.user = user;
+      f.balance = quantity;
+    });
+    count_row( "userfunds"_n, get_self(), get_self().value, row_bytes( *created, 0 ) );
+  } else {
+    funds_table.modify( funds, same_payer, [&]( auto& f ){
+      f.balance += quantity;
+    });
+  }
+}
+
+// Helper function to take COME from the funds of a user, the row is erased once empty.
+// Users have no account of their own, so every action that spends their funds requires the contract's auth
+void nfts::debit_user(const uint64_t& user, const asset& quantity)
+{
+  user_funds_index funds_table( get_self(), get_self().value );
+  const auto& funds = funds_table.get( user, "No COME deposited for this user" );
+  check( funds.balance >= quantity, "Not enough COME deposited for this user" );
+
+  if( funds.balance == quantity ) {
+    count_row( "userfunds"_n, get_self(), get_self().value, -row_bytes( funds, 0 ) );
+    funds_table.erase( funds );
+  } else {
+    funds_table.modify( funds, same_payer, [&]( auto& f ){
+      f.balance -= quantity;
+    });
+  }
+}
+
+// Helper function to pay out COME from the contract
+void nfts::send_come(const name& to, const asset& quantity, const string& memo)
+{
+  config_index config_table( get_self(), get_self().value );
+  check( config_table.exists(), "Config table does not exist" );
+  const auto token_contract = config_table.get().token_contract;
+  check( token_contract.value_or() != name(), "COME token contract is not configured" );
+
+  action( permission_level{ get_self(), "active"_n }, *token_contract, "transfer"_n,
+          std::make_tuple( get_self(), to, quantity, memo ) ).send();
+}
+
+// Helper function to read the user id a deposit is for, the memo holds nothing else
+uint64_t nfts::parse_user_id(const string& memo)
+{
+  check( !memo.empty() && memo.size() <= 20, "Memo must be the id of the user to credit" );
+  uint64_t user = 0;
+  for( const char c : memo ) {
+    check( c >= '0' && c <= '9', "Memo must be the id of the user to credit" );
+    const uint64_t next = user * 10 + uint64_t(c - '0');
+    check( next / 10 == user, "User id is out of range" );
+    user = next;
+  }
+  return user;
+}
+
+// Helper function to hand an nft to a new owner and return its category. The issuer signs every move but those
+// of auctions, which the contract opens, bids on and settles on its own authority (by_contract)
+const nfts::category_stats& nfts::move_nft(const uint64_t& from, const uint64_t& to, const uint64_t& nft_id, bool istransfer, bool by_contract) {
+  const auto& nft = get_nft( nft_id, "NFT not found");
+
+  const auto& category = get_category( nft.nft_category_id );
+  const auto& nft_stat = category.stats;
+  if( !by_contract ) {
+    require_issuer( nft_stat.issuer ); // ensure that only issuer can call the action
+  }
+
+  if( istransfer ) {
+    check( nft.owner == from, "Must be the owner");
+    check( nft_stat.transferable == true, "Not transferable");
+    check( !(nft.flags & NFT_LOCKED), "NFT is locked, so it cannot transferred");
+  }
+
+  // sales hand over the nft unlocked
+  modify_nft( nft, [&]( auto& t ){
+    t.owner = to;
+    if( !istransfer ) {
+      t.flags &= ~NFT_LOCKED;
+      t.listed_in.reset();
+    }
+  });
+  return category;
+}
+
+// Helper function to hand nfts to a new owner, the moved quantity per nft category is added to moves
+void nfts::move_nfts(const uint64_t& from, const uint64_t& to, const vector<uint64_t>& nft_ids, bool istransfer, bool by_contract, vector<pair<uint64_t, asset>>& moves) {
+  for( auto const& nft_id : nft_ids ) {
+    const auto& nft_stat = move_nft( from, to, nft_id, istransfer, by_contract ).stats;
+
+    auto move = find_if( moves.begin(), moves.end(), [&]( const auto& m ){ return m.first == nft_stat.nft_category_id; } );
+    if( move == moves.end() ) {
+      moves.emplace_back( nft_stat.nft_category_id, asset( 1, nft_stat.max_supply.symbol ) );
+    } else {
+      move->second.amount += 1;
+    }
+  }
+}
+
+void nfts::changeowner(const uint64_t& from, const uint64_t& to, const vector<uint64_t>& nft_ids, bool istransfer, bool by_contract) {
+  // balance moved per nft category, applied once per category after all nfts are moved
+  vector<pair<uint64_t, asset>> moves;
+  move_nfts( from, to, nft_ids, istransfer, by_contract, moves );
+
+  for( auto const& [nft_category_id, quantity] : moves ) {
+    const auto& category = get_category( nft_category_id ).nft_category;
+    sub_balance( from, nft_category_id, quantity );
+    add_balance( to, get_self(), category.event, category.nft_name, nft_category_id, quantity );
+  }
+}
+
+// a single nft, as auctions sell them, needs no list of ids or of balance moves
+void nfts::changeowner(const uint64_t& from, const uint64_t& to, const uint64_t& nft_id, bool istransfer, bool by_contract) {
+  const auto& category = move_nft( from, to, nft_id, istransfer, by_contract );
+  const asset quantity( 1, category.stats.max_supply.symbol );
+  sub_balance( from, category.stats.nft_category_id, quantity );
+  add_balance( to, get_self(), category.nft_category.event, category.nft_category.nft_name, category.stats.nft_category_id, quantity );
+}
+
+// Helper function to count a call of the running action
+void nfts::count_action(const name& action)
+{
+  // actions calling another one count both
+  if( pending_action.action != action && pending_action.calls > 0 ) {
+    save_metrics();
+  }
+  pending_action.action = action;
+  pending_action.calls++;
+}
+
+// Helper function to count a row created (positive bytes) or erased (negative bytes) in a table. Rows of no
+// event, such as COME funds, are counted under the id of the contract, which createnft keeps from events
+void nfts::count_row(const name& table, const name& payer, const uint64_t& event, const int64_t& bytes)
+{
+  auto rows = find_pending( pending_tables, pending_table_count, [&]( const auto& p ){ return p.table == table && p.event == event; } );
+  auto payer_bytes = find_pending( pending_payers, pending_payer_count, [&]( const auto& p ){ return p.payer == payer; } );
+  if( rows == nullptr || payer_bytes == nullptr ) {
+    save_metrics();
+    count_row( table, payer, event, bytes );
+    return;
+  }
+
+  rows->table = table;
+  rows->event = event;
+  if( bytes >= 0 ) {
+    rows->created++;
+  } else {
+    rows->erased++;
+  }
+  rows->billed_bytes += bytes;
+  payer_bytes->payer = payer;
+  payer_bytes->billed_bytes += bytes;
+}
+
+// Helper function to add the pending metrics to their rows, each row is written once
+void nfts::save_metrics()
+{
+  if( pending_action.calls > 0 ) {
+    action_counter_index actions_table( get_self(), get_self().value );
+    auto counter = actions_table.find( pending_action.action.value );
+    if( counter == actions_table.end() ) {
+      actions_table.emplace( get_self(), [&]( auto& c ){
+        c = pending_action;
+      });
+    } else {
+      actions_table.modify( counter, same_payer, [&]( auto& c ){
+        c.calls += pending_action.calls;
+      });
+    }
+    pending_action = action_counter{};
+  }
+
+  for( uint8_t i = 0; i < pending_table_count; i++ ) {
+    const auto& pending = pending_tables[i];
+    table_counter_index counters_table( get_self(), pending.event );
+    auto counter = counters_table.find( pending.table.value );
+    if( counter != counters_table.end() ) {
+      counters_table.modify( counter, same_payer, [&]( auto& c ){
+        c.created += pending.created;
+        c.erased += pending.erased;
+        c.billed_bytes += pending.billed_bytes;
+      });
+      continue;
+    }
+    counters_table.emplace( get_self(), [&]( auto& c ){
+      c = table_counter{ pending.table, pending.created, pending.erased, pending.billed_bytes };
+    });
+    // getmetrics finds the counters of an event through its row
+    event_metrics_index event_metrics_table( get_self(), get_self().value );
+    if( event_metrics_table.find( pending.event ) == event_metrics_table.end() ) {
+      event_metrics_table.emplace( get_self(), [&]( auto& m ){
+        m.event = pending.event;
+      });
+    }
+  }
+  pending_table_count = 0;
+
+  payer_metrics_index payer_metrics_table( get_self(), get_self().value );
+  for( uint8_t i = 0; i < pending_payer_count; i++ ) {
+    const auto& pending = pending_payers[i];
+    auto existing = payer_metrics_table.find( pending.payer.value );
+    if( existing == payer_metrics_table.end() ) {
+      payer_metrics_table.emplace( get_self(), [&]( auto& m ){
+        m = payer_metrics{ pending.payer, pending.billed_bytes };
+      });
+    } else {
+      payer_metrics_table.modify( existing, same_payer, [&]( auto& m ){
+        m.billed_bytes += pending.billed_bytes;
+      });
+    }
+  }
+  pending_payer_count = 0;
+}
+
+// The metrics counted by an action are saved once, when the action is done with the contract
+nfts::~nfts()
+{
+  save_metrics();
+}
@@ -0,0 +1,199 @@
+// Builds the merkle tree of an allow-list drop, see the drop table of the nfts contract.
+//
+// Input is a CSV with one claim per line: user id, nft category id, count. A first line
+// that does not start with a digit is taken as a header and skipped. The leaf index of a
+// claim is its position among the claims, starting at 0.
+//
+// Output is JSON with the root and leaf count to pass to setdrop, and for every leaf the
+// arguments of its claim action:
+//
+//   merkledrop drop.csv > drop.json
+
+#include <array>
+#include <cctype>
+#include <cstdint>
+#include <fstream>
+#include <iostream>
+#include <sstream>
+#include <string>
+#include <vector>
+
+using namespace std;
+
+using digest = array<uint8_t, 32>;
+
+// Plain FIPS 180-4 SHA-256, the contract uses the chain intrinsic
+class sha256 {
+  public:
+    sha256& update(const uint8_t* data, size_t length) {
+      for( size_t i = 0; i < length; i++ ) {
+        block[filled++] = data[i];
+        if( filled == 64 ) {
+          compress();
+          filled = 0;
+        }
+      }
+      bits += uint64_t(length) * 8;
+      return *this;
+    }
+
+    digest finish() {
+      const uint64_t total = bits;
+      const uint8_t pad = 0x80, zero = 0;
+      update( &pad, 1 );
+      while( filled != 56 ) update( &zero, 1 );
+      uint8_t length[8];
+      for( int i = 0; i < 8; i++ ) length[i] = uint8_t(total >> (56 - 8 * i));
+      update( length, 8 );
+
+      digest out;
+      for( int i = 0; i < 8; i++ ) {
+        for( int j = 0; j < 4; j++ ) out[4 * i + j] = uint8_t(h[i] >> (24 - 8 * j));
+      }
+      return out;
+    }
+
+  private:
+    static uint32_t rotr(uint32_t x, int n) { return (x >> n) | (x << (32 - n)); }
+
+    void compress() {
+      static const uint32_t k[64] = {
+        0x428a2f98, 0x71374491, 0xb5c0fbcf, 0xe9b5dba5, 0x3956c25b, 0x59f111f1, 0x923f82a4, 0xab1c5ed5,
+        0xd807aa98, 0x12835b01, 0x243185be, 0x550c7dc3, 0x72be5d74, 0x80deb1fe, 0x9bdc06a7, 0xc19bf174,
+        0xe49b69c1, 0xefbe4786, 0x0fc19dc6, 0x240ca1cc, 0x2de92c6f, 0x4a7484aa, 0x5cb0a9dc, 0x76f988da,
+        0x983e5152, 0xa831c66d, 0xb00327c8, 0xbf597fc7, 0xc6e00bf3, 0xd5a79147, 0x06ca6351, 0x14292967,
+        0x27b70a85, 0x2e1b2138, 0x4d2c6dfc, 0x53380d13, 0x650a7354, 0x766a0abb, 0x81c2c92e, 0x92722c85,
+        0xa2bfe8a1, 0xa81a664b, 0xc24b8b70, 0xc76c51a3, 0xd192e819, 0xd6990624, 0xf40e3585, 0x106aa070,
+        0x19a4c116, 0x1e376c08, 0x2748774c, 0x34b0bcb5, 0x391c0cb3, 0x4ed8aa4a, 0x5b9cca4f, 0x682e6ff3,
+        0x748f82ee, 0x78a5636f, 0x84c87814, 0x8cc70208, 0x90befffa, 0xa4506ceb, 0xbef9a3f7, 0xc67178f2 };
+
+      uint32_t w[64];
+      for( int i = 0; i < 16; i++ ) {
+        w[i] = uint32_t(block[4 * i]) << 24 | uint32_t(block[4 * i + 1]) << 16 | uint32_t(block[4 * i + 2]) << 8 | block[4 * i + 3];
+      }
+      for( int i = 16; i < 64; i++ ) {
+        const uint32_t s0 = rotr( w[i - 15], 7 ) ^ rotr( w[i - 15], 18 ) ^ (w[i - 15] >> 3);
+        const uint32_t s1 = rotr( w[i - 2], 17 ) ^ rotr( w[i - 2], 19 ) ^ (w[i - 2] >> 10);
+        w[i] = w[i - 16] + s0 + w[i - 7] + s1;
+      }
+
+      uint32_t a = h[0], b = h[1], c = h[2], d = h[3], e = h[4], f = h[5], g = h[6], hh = h[7];
+      for( int i = 0; i < 64; i++ ) {
+        const uint32_t t1 = hh + (rotr( e, 6 ) ^ rotr( e, 11 ) ^ rotr( e, 25 )) + ((e & f) ^ (~e & g)) + k[i] + w[i];
+        const uint32_t t2 = (rotr( a, 2 ) ^ rotr( a, 13 ) ^ rotr( a, 22 )) + ((a & b) ^ (a & c) ^ (b & c));
+        hh = g; g = f; f = e; e = d + t1; d = c; c = b; b = a; a = t1 + t2;
+      }
+      h[0] += a; h[1] += b; h[2] += c; h[3] += d; h[4] += e; h[5] += f; h[6] += g; h[7] += hh;
+    }
+
+    uint32_t h[8] = { 0x6a09e667, 0xbb67ae85, 0x3c6ef372, 0xa54ff53a, 0x510e527f, 0x9b05688c, 0x1f83d9ab, 0x5be0cd19 };
+    uint8_t block[64];
+    size_t filled = 0;
+    uint64_t bits = 0;
+};
+
+struct claim {
+  uint64_t to;
+  uint64_t nft_category_id;
+  uint64_t count;
+};
+
+// integers are packed little endian, as the contract serializes them
+static void put(vector<uint8_t>& out, uint64_t value) {
+  for( int i = 0; i < 8; i++ ) out.push_back( uint8_t(value >> (8 * i)) );
+}
+
+static digest leaf_hash(uint64_t leaf_index, const claim& c) {
+  vector<uint8_t> buffer{ 0 };
+  put( buffer, leaf_index );
+  put( buffer, c.to );
+  put( buffer, c.nft_category_id );
+  put( buffer, c.count );
+  return sha256().update( buffer.data(), buffer.size() ).finish();
+}
+
+static digest node_hash(const digest& left, const digest& right) {
+  const uint8_t prefix = 1;
+  return sha256().update( &prefix, 1 ).update( left.data(), left.size() ).update( right.data(), right.size() ).finish();
+}
+
+static string hex(const digest& d) {
+  static const char* digits = "0123456789abcdef";
+  string out;
+  for( auto b : d ) {
+    out.push_back( digits[b >> 4] );
+    out.push_back( digits[b & 0xf] );
+  }
+  return out;
+}
+
+static bool parse(const string& line, claim& c) {
+  stringstream fields( line );
+  string to, category, count;
+  if( !getline( fields, to, ',' ) || !getline( fields, category, ',' ) || !getline( fields, count ) ) return false;
+  try {
+    c.to = stoull( to );
+    c.nft_category_id = stoull( category );
+    c.count = stoull( count );
+  } catch( const exception& ) {
+    return false;
+  }
+  return c.count > 0;
+}
+
+int main(int argc, char** argv) {
+  if( argc != 2 ) {
+    cerr << "usage: " << argv[0] << " <claims.csv>" << endl;
+    return 2;
+  }
+  ifstream in( argv[1] );
+  if( !in ) {
+    cerr << "cannot open " << argv[1] << endl;
+    return 1;
+  }
+
+  vector<claim> claims;
+  string line;
+  for( size_t number = 1; getline( in, line ); number++ ) {
+    if( !line.empty() && line.back() == '\r' ) line.pop_back();
+    if( line.empty() || (number == 1 && !isdigit( (unsigned char)line[0] )) ) continue;
+    claim c;
+    if( !parse( line, c ) ) {
+      cerr << argv[1] << ":" << number << ": expected user id,nft category id,count" << endl;
+      return 1;
+    }
+    claims.push_back( c );
+  }
+  if( claims.empty() ) {
+    cerr << "no claims in " << argv[1] << endl;
+    return 1;
+  }
+
+  // levels[0] are the leaves, the last level holds the root alone
+  vector<vector<digest>> levels( 1 );
+  for( size_t i = 0; i < claims.size(); i++ ) levels[0].push_back( leaf_hash( i, claims[i] ) );
+  while( levels.back().size() > 1 ) {
+    const auto& below = levels.back();
+    vector<digest> level;
+    for( size_t i = 0; i < below.size(); i += 2 ) {
+      level.push_back( node_hash( below[i], i + 1 < below.size() ? below[i + 1] : below[i] ) );
+    }
+    levels.push_back( move( level ) );
+  }
+
+  cout << "{\n  \"merkle_root\": \"" << hex( levels.back()[0] ) << "\",\n  \"leaf_count\": " << claims.size() << ",\n  \"claims\": [";
+  for( size_t i = 0; i < claims.size(); i++ ) {
+    cout << (i ? "," : "") << "\n    {\"leaf_index\": " << i << ", \"to\": " << claims[i].to
+         << ", \"nft_category_id\": " << claims[i].nft_category_id << ", \"count\": " << claims[i].count << ", \"proof\": [";
+    size_t position = i;
+    for( size_t depth = 0; depth + 1 < levels.size(); depth++ ) {
+      const auto& level = levels[depth];
+      const size_t sibling = position ^ 1;
+      cout << (depth ? ", " : "") << "\"" << hex( sibling < level.size() ? level[sibling] : level[position] ) << "\"";
+      position >>= 1;
+    }
+    cout << "]}";
+  }
+  cout << "\n  ]\n}\n";
+  return 0;
+}